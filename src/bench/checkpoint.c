@@ -0,0 +1,112 @@
+/**
+ * @file checkpoint.c
+ * @brief Benchmark: incremental checkpoint cost against dirty-page count
+ *
+ * Dirties N random pages of an anonymous machine, then writes a
+ * checkpoint, for N from 0 up to the whole machine. Reports the cost of
+ * the write traps (first write to each page) and of the checkpoint
+ * itself, per checkpoint and per page, and the bytes added to the log.
+ *
+ * Usage: pccore_bench_checkpoint [log file] [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../pccore/pccore.h"
+#include "../pccore/memory.h"
+#include "../pccore/checkpoint.h"
+
+static PCCORE g_machine;
+
+static unsigned long long NowNanos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+    static const unsigned int dirtyCounts[] = { 0, 1, 4, 16, 64, 256, 0 };
+    const char *path = argc > 1 ? argv[1] : "/tmp/pccore_bench.ckpt";
+    int rounds = argc > 2 ? atoi(argv[2]) : 50;
+    int i, r;
+
+    if (initMachine(&g_machine, MACHINE_ANONYMOUS, NULL) < 0) {
+        return 1;
+    }
+
+    // Some content, so the base record is not empty
+    for (i = 0; i < 0x10000; i++) {
+        g_machine.memory[0xB8000 + (i & 0x3FFF)] = (unsigned char)i;
+    }
+
+    CHECKPOINTLOG *log = openCheckpointLog(&g_machine, path);
+    if (log == NULL) {
+        return 1;
+    }
+    // Measure checkpoints, not compactions
+    log->compact_ratio = 1 << 20;
+
+    printf("Machine: %lu pages of %lu bytes, %d rounds per row%s\n",
+           (unsigned long)log->pages, (unsigned long)log->page_size, rounds,
+           log->sync ? ", fdatasync" : "");
+    printf("%8s %12s %12s %12s %12s\n",
+           "dirty", "trap us", "ckpt us", "us/page", "log KB");
+
+    srand(1);
+    for (i = 0; i < (int)(sizeof(dirtyCounts) / sizeof(dirtyCounts[0])); i++) {
+        unsigned int count = dirtyCounts[i];
+        unsigned long long trapNanos = 0, checkpointNanos = 0;
+        unsigned long long logBefore = log->log_size;
+
+        if (i > 0 && count == 0) {
+            count = (unsigned int)log->pages; // Last row: everything
+        }
+
+        for (r = 0; r < rounds; r++) {
+            unsigned long long start = NowNanos();
+            unsigned int p;
+            for (p = 0; p < count; p++) {
+                size_t page = count == log->pages ? p : (size_t)rand() % log->pages;
+                g_machine.memory[page * log->page_size + (r & 63)] ^= 0x5A;
+            }
+            unsigned long long dirtied = NowNanos();
+            if (writeCheckpoint(log) < 0) {
+                return 1;
+            }
+            unsigned long long done = NowNanos();
+
+            trapNanos += dirtied - start;
+            checkpointNanos += done - dirtied;
+        }
+
+        printf("%8u %12.1f %12.1f %12.2f %12.1f\n", count,
+               trapNanos / 1000.0 / rounds,
+               checkpointNanos / 1000.0 / rounds,
+               count ? checkpointNanos / 1000.0 / rounds / count : 0.0,
+               (log->log_size - logBefore) / 1024.0 / rounds);
+    }
+
+    closeCheckpointLog(log);
+
+    // The log must reproduce the final machine exactly
+    PCCORE restored;
+    memset(&restored, 0, sizeof(restored));
+    if (initMachine(&restored, MACHINE_ANONYMOUS, NULL) < 0) {
+        return 1;
+    }
+    restoreCheckpointLog(&restored, path); // Warm the page cache
+    unsigned long long start = NowNanos();
+    int applied = restoreCheckpointLog(&restored, path);
+    unsigned long long end = NowNanos();
+    int same = memcmp(restored.memory, g_machine.memory, PCCORE_MEMORY_SIZE + PCCORE_PORT_SIZE) == 0;
+    printf("Restore: %d checkpoints in %.1f ms, %s\n", applied, (end - start) / 1e6,
+           same ? "identical" : "MISMATCH");
+
+    freeMachine(&restored);
+    freeMachine(&g_machine);
+    remove(path);
+    return same ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file clock.c
+ * @brief Benchmark: cost of the DOS time services
+ *
+ * Calls each time function a few million times on an anonymous machine
+ * while a second thread advances the machine clock every millisecond,
+ * like a wrapper's timer. clock(), time(), biostime, gettime and INT 1Ah
+ * read the clock with an atomic load; clock_gettime is the host baseline
+ * they replace. Reports ns per call.
+ *
+ * Usage: pccore_bench_clock [million calls]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../pccore/pccore.h"
+#include "../pccore/memory.h"
+#include "../turboc/dos.h"
+#include "../turboc/bios.h"
+
+static PCCORE g_machine;
+static volatile int g_running = 1;
+
+typedef enum {
+    CALL_HOST,
+    CALL_CLOCK,
+    CALL_TIME,
+    CALL_BIOSTIME,
+    CALL_GETTIME,
+    CALL_INT1A,
+    CALL_COUNT
+} CALL;
+
+static const char *callNames[CALL_COUNT] = {
+    "clock_gettime", "clock()", "time()", "biostime(0)", "gettime", "int86 1Ah"
+};
+
+static unsigned long long NowNanos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *TimerThread(void *arg) {
+    (void)arg;
+    while (g_running) {
+        updateMachineClock(&g_machine);
+        usleep(1000);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Makes 'count' calls. Returns a sum of the results so the calls
+ * are not optimized away.
+ */
+static long long Run(CALL call, long count) {
+    long long sum = 0;
+    struct timespec ts;
+    struct time now;
+    union REGS regs;
+    long i;
+
+    for (i = 0; i < count; i++) {
+        switch (call) {
+            case CALL_HOST:
+                clock_gettime(CLOCK_REALTIME, &ts);
+                sum += ts.tv_nsec;
+                break;
+            case CALL_CLOCK:
+                sum += clock();
+                break;
+            case CALL_TIME:
+                sum += time(NULL);
+                break;
+            case CALL_BIOSTIME:
+                sum += biostime(0, 0);
+                break;
+            case CALL_GETTIME:
+                gettime(&now);
+                sum += now.ti_hund;
+                break;
+            default:
+                regs.h.ah = 0x00;
+                int86(0x1A, &regs, &regs);
+                sum += regs.x.dx;
+                break;
+        }
+    }
+    return sum;
+}
+
+int main(int argc, char **argv) {
+    long count = (argc > 1 ? atol(argv[1]) : 10) * 1000000L;
+    long long sum = 0;
+    pthread_t timer;
+    int c;
+
+    if (initMachine(&g_machine, MACHINE_ANONYMOUS, NULL) < 0) {
+        return 1;
+    }
+    bindPCCore(&g_machine);
+    startMachineClock(&g_machine);
+    pthread_create(&timer, NULL, TimerThread, NULL);
+
+    printf("%ld calls per row, clock advanced every 1 ms\n", count);
+    printf("%-14s %10s\n", "call", "ns/call");
+    for (c = 0; c < CALL_COUNT; c++) {
+        unsigned long long start;
+        double nanos;
+
+        Run((CALL)c, count / 10);
+        start = NowNanos();
+        sum += Run((CALL)c, count);
+        nanos = (double)(NowNanos() - start);
+        printf("%-14s %10.2f\n", callNames[c], nanos / count);
+    }
+
+    g_running = 0;
+    pthread_join(timer, NULL);
+    return sum == 42 ? 2 : 0;
+}
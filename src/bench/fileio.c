@@ -0,0 +1,148 @@
+/**
+ * @file fileio.c
+ * @brief Benchmark: DOS file read throughput into guest memory
+ *
+ * Writes a scratch file, then reads it front to back into guest memory
+ * (1000:0000) several times with the page cache warm: by plain read()
+ * as the baseline, by _read on a mapped read-only handle and on a
+ * read-write handle (pread), through intdosx, and in 512-byte reads
+ * served from the read-ahead buffer. Reports MB/s for each.
+ *
+ * Usage: pccore_bench_fileio [file size in MB] [passes] [scratch file]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../pccore/pccore.h"
+#include "../pccore/memory.h"
+#include "../turboc/dos.h"
+#include "../turboc/io.h"
+
+#define CHUNK 0x10000
+#define SMALL_CHUNK 512
+
+static PCCORE g_machine;
+
+typedef enum {
+    READ_HOST,
+    READ_MAPPED,
+    READ_PREAD,
+    READ_INTDOS,
+    READ_HOST_SMALL,
+    READ_AHEAD,
+    READ_COUNT
+} METHOD;
+
+static const char *methodNames[READ_COUNT] = {
+    "read()", "_read, mapped", "_read, pread", "intdosx 3Fh", "read()", "_read, read-ahead"
+};
+
+static unsigned long long NowNanos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Reads the whole file once. Returns the bytes read.
+ */
+static long long ReadFile(METHOD method, const char *path) {
+    unsigned char *guest = (unsigned char *)MK_FP(0x1000, 0);
+    long long total = 0;
+    int n;
+
+    if (method == READ_HOST || method == READ_HOST_SMALL) {
+        int fd = open(path, O_RDONLY);
+        unsigned chunk = method == READ_HOST ? CHUNK : SMALL_CHUNK;
+        while ((n = (int)read(fd, guest, chunk)) > 0) {
+            total += n;
+        }
+        close(fd);
+        return total;
+    }
+
+    int handle = _open(path, method == READ_MAPPED || method == READ_INTDOS ? O_RDONLY : O_RDWR);
+    if (handle < 0) {
+        return -1;
+    }
+    if (method == READ_INTDOS) {
+        // CX is 16 bits: 64 KB less one byte per call
+        union REGS regs;
+        struct SREGS segregs = { 0, 0, 0, 0x1000 };
+        do {
+            regs.h.ah = 0x3F;
+            regs.x.bx = (unsigned short)handle;
+            regs.x.cx = 0xFFFF;
+            regs.x.dx = 0;
+            intdosx(&regs, &regs, &segregs);
+            n = regs.x.cflag ? 0 : regs.x.ax;
+            total += n;
+        } while (n > 0);
+    } else {
+        unsigned chunk = method == READ_AHEAD ? SMALL_CHUNK : CHUNK;
+        while ((n = _read(handle, guest, chunk)) > 0) {
+            total += n;
+        }
+    }
+    _close(handle);
+    return total;
+}
+
+int main(int argc, char **argv) {
+    long long megabytes = argc > 1 ? atoll(argv[1]) : 64;
+    int passes = argc > 2 ? atoi(argv[2]) : 8;
+    const char *path = argc > 3 ? argv[3] : "/tmp/pccore_bench_fileio.dat";
+    unsigned char *block;
+    long long i;
+    int m, p;
+
+    if (initMachine(&g_machine, MACHINE_ANONYMOUS, NULL) < 0) {
+        return 1;
+    }
+    bindPCCore(&g_machine);
+
+    // Scratch file with something other than zeros in it
+    block = (unsigned char *)malloc(1 << 20);
+    FILE *file = fopen(path, "wb");
+    if (block == NULL || file == NULL) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return 1;
+    }
+    for (i = 0; i < (1 << 20); i++) {
+        block[i] = (unsigned char)(i * 131 + 7);
+    }
+    for (i = 0; i < megabytes; i++) {
+        fwrite(block, 1, 1 << 20, file);
+    }
+    fclose(file);
+    free(block);
+
+    printf("%lld MB file, %d passes per row, page cache warm\n", megabytes, passes);
+    printf("%-18s %8s %12s\n", "method", "chunk", "MB/s");
+    for (m = 0; m < READ_COUNT; m++) {
+        unsigned long long start, nanos;
+        long long total = 0;
+
+        ReadFile((METHOD)m, path);
+        start = NowNanos();
+        for (p = 0; p < passes; p++) {
+            total += ReadFile((METHOD)m, path);
+        }
+        nanos = NowNanos() - start;
+        if (total != megabytes * passes * (1 << 20)) {
+            fprintf(stderr, "%s read %lld bytes\n", methodNames[m], total);
+            return 1;
+        }
+        printf("%-18s %8s %12.0f\n", methodNames[m],
+               m == READ_HOST_SMALL || m == READ_AHEAD ? "512 B" : m == READ_INTDOS ? "64 KB-1" : "64 KB",
+               total / 1048576.0 / (nanos / 1e9));
+    }
+
+    unlink(path);
+    return 0;
+}
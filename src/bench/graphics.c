@@ -0,0 +1,239 @@
+/**
+ * @file graphics.c
+ * @brief Benchmark: BGI primitives per second in the CGA graphics modes
+ *
+ * Draws batches of random points, lines, rectangles, circles, ellipses
+ * and arcs into the VRAM of an anonymous machine, in CGAC1 (320x200,
+ * 2 bits per pixel) and CGAHI (640x200, 1 bit per pixel), and reports
+ * the rate of each primitive.
+ *
+ * Then fills the whole screen with a hatch pattern by each fill
+ * function, and by putpixel per pixel as the baseline they are compared
+ * against.
+ *
+ * Last, moves sprites with putimage at random (unaligned) positions and
+ * reports how many fit in one 60 Hz frame, for XOR_PUT (drawn twice:
+ * erase and draw) and COPY_PUT.
+ *
+ * Usage: pccore_bench_graphics [primitives per row] [fills per row] [sprites per row]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../pccore/pccore.h"
+#include "../pccore/memory.h"
+#include "../pccore/cga.h"
+#include "../turboc/graphics.h"
+
+static PCCORE g_machine;
+
+typedef enum {
+    PRIM_PIXEL,
+    PRIM_HLINE,
+    PRIM_LINE,
+    PRIM_RECTANGLE,
+    PRIM_CIRCLE,
+    PRIM_ELLIPSE,
+    PRIM_ARC,
+    PRIM_COUNT
+} PRIMITIVE;
+
+static const char *primitiveNames[PRIM_COUNT] = {
+    "putpixel", "line (horiz)", "line", "rectangle", "circle", "ellipse", "arc"
+};
+
+static unsigned long long NowNanos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void Draw(PRIMITIVE primitive, int maxx, int maxy, int color) {
+    int x = rand() % (maxx + 1), y = rand() % (maxy + 1);
+    int x2 = rand() % (maxx + 1), y2 = rand() % (maxy + 1);
+    int r = 4 + rand() % 60;
+
+    setcolor(color);
+    switch (primitive) {
+        case PRIM_PIXEL:
+            putpixel(x, y, color);
+            break;
+        case PRIM_HLINE:
+            line(x, y, x2, y);
+            break;
+        case PRIM_LINE:
+            line(x, y, x2, y2);
+            break;
+        case PRIM_RECTANGLE:
+            rectangle(x, y, x2, y2);
+            break;
+        case PRIM_CIRCLE:
+            circle(x, y, r);
+            break;
+        case PRIM_ELLIPSE:
+            ellipse(x, y, 0, 360, r, r / 2 + 1);
+            break;
+        default:
+            arc(x, y, 30, 240, r);
+            break;
+    }
+}
+
+typedef enum {
+    FILL_PIXELS,
+    FILL_BAR,
+    FILL_POLY,
+    FILL_ELLIPSE,
+    FILL_FLOOD,
+    FILL_COUNT
+} FILL;
+
+static const char *fillNames[FILL_COUNT] = {
+    "putpixel", "bar", "fillpoly", "fillellipse", "floodfill"
+};
+
+static void Fill(FILL fill, int maxx, int maxy) {
+    int x, y;
+
+    switch (fill) {
+        case FILL_PIXELS: {
+            // What a fill costs one pixel at a time
+            struct fillsettingstype settings;
+            char pattern[8];
+            getfillsettings(&settings);
+            getfillpattern(pattern);
+            for (y = 0; y <= maxy; y++) {
+                for (x = 0; x <= maxx; x++) {
+                    putpixel(x, y, (pattern[y & 7] & (0x80 >> (x & 7))) ? settings.color : 0);
+                }
+            }
+            break;
+        }
+        case FILL_BAR:
+            bar(0, 0, maxx, maxy);
+            break;
+        case FILL_POLY: {
+            int points[] = { 0, 0, maxx, 0, maxx, maxy, 0, maxy };
+            fillpoly(4, points);
+            break;
+        }
+        case FILL_ELLIPSE:
+            fillellipse(maxx / 2, maxy / 2, maxx / 2, maxy / 2);
+            break;
+        default:
+            // Clear, so every round fills the whole screen again
+            clearviewport();
+            floodfill(maxx / 2, maxy / 2, getmaxcolor());
+            break;
+    }
+}
+
+int main(int argc, char **argv) {
+    static const int modes[] = { CGAC1, CGAHI };
+    static const char hatch[8] = { (char)0xFF, (char)0x88, (char)0x88, (char)0x88,
+                                   (char)0xFF, (char)0x88, (char)0x88, (char)0x88 };
+    int count = argc > 1 ? atoi(argv[1]) : 20000;
+    int fills = argc > 2 ? atoi(argv[2]) : 200;
+    int sprites = argc > 3 ? atoi(argv[3]) : 200000;
+    int m, p, i;
+
+    if (initMachine(&g_machine, MACHINE_ANONYMOUS, NULL) < 0) {
+        return 1;
+    }
+    bindPCCore(&g_machine);
+    attachCga(&g_machine);
+
+    printf("%d primitives per row, random positions, radii 4-63\n", count);
+    printf("%-8s %-14s %12s %14s\n", "mode", "primitive", "ns each", "per second");
+
+    for (m = 0; m < (int)(sizeof(modes) / sizeof(modes[0])); m++) {
+        int driver = CGA, mode = modes[m];
+
+        initgraph(&driver, &mode, "");
+        if (graphresult() != grOk) {
+            return 1;
+        }
+        for (p = 0; p < PRIM_COUNT; p++) {
+            unsigned long long start, nanos;
+
+            srand(1);
+            start = NowNanos();
+            for (i = 0; i < count; i++) {
+                Draw((PRIMITIVE)p, getmaxx(), getmaxy(), 1 + i % getmaxcolor());
+            }
+            nanos = NowNanos() - start;
+            printf("%-8s %-14s %12.1f %14.0f\n", mode == CGAHI ? "CGAHI" : "CGAC1",
+                   primitiveNames[p], (double)nanos / count, count * 1e9 / (double)nanos);
+        }
+        closegraph();
+    }
+
+    printf("\n%d full-screen hatch fills per row\n", fills);
+    printf("%-8s %-14s %12s %14s\n", "mode", "fill", "us each", "vs putpixel");
+    for (m = 0; m < (int)(sizeof(modes) / sizeof(modes[0])); m++) {
+        int driver = CGA, mode = modes[m];
+        double baseline = 0;
+
+        initgraph(&driver, &mode, "");
+        setfillpattern(hatch, getmaxcolor());
+        for (p = 0; p < FILL_COUNT; p++) {
+            unsigned long long start = NowNanos(), nanos;
+
+            for (i = 0; i < fills; i++) {
+                Fill((FILL)p, getmaxx(), getmaxy());
+            }
+            nanos = NowNanos() - start;
+            if (p == FILL_PIXELS) {
+                baseline = (double)nanos;
+            }
+            printf("%-8s %-14s %12.1f %13.1fx\n", mode == CGAHI ? "CGAHI" : "CGAC1",
+                   fillNames[p], nanos / 1000.0 / fills, baseline / (double)nanos);
+        }
+        if (graphresult() != grOk) {
+            return 1;
+        }
+        closegraph();
+    }
+
+    printf("\n%d sprites per row, random positions\n", sprites);
+    printf("%-8s %-6s %-9s %12s %14s\n", "mode", "size", "op", "ns each", "per frame");
+    for (m = 0; m < (int)(sizeof(modes) / sizeof(modes[0])); m++) {
+        static const int sizes[] = { 16, 32 };
+        int driver = CGA, mode = modes[m], s, op;
+
+        initgraph(&driver, &mode, "");
+        for (s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+            int size = sizes[s];
+            void *sprite = malloc(imagesize(0, 0, size - 1, size - 1));
+
+            setfillstyle(XHATCH_FILL, getmaxcolor());
+            fillellipse(size / 2, size / 2, size / 2 - 1, size / 2 - 1);
+            getimage(0, 0, size - 1, size - 1, sprite);
+
+            for (op = COPY_PUT; op <= XOR_PUT; op++) {
+                int puts = op == XOR_PUT ? 2 : 1;
+                unsigned long long start, nanos;
+                double each;
+
+                srand(1);
+                start = NowNanos();
+                for (i = 0; i < sprites; i++) {
+                    int x = rand() % (getmaxx() + 2 - size), y = rand() % (getmaxy() + 2 - size);
+                    putimage(x, y, sprite, op);
+                    if (puts == 2) {
+                        putimage(x, y, sprite, op);
+                    }
+                }
+                nanos = NowNanos() - start;
+                each = (double)nanos / sprites;
+                printf("%-8s %2dx%-3d %-9s %12.1f %14.0f\n", mode == CGAHI ? "CGAHI" : "CGAC1",
+                       size, size, op == XOR_PUT ? "XOR x2" : "COPY", each, 1e9 / 60 / each);
+            }
+            free(sprite);
+        }
+        closegraph();
+    }
+    return 0;
+}
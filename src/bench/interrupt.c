@@ -0,0 +1,116 @@
+/**
+ * @file interrupt.c
+ * @brief Benchmark: int86 dispatch through the vector table
+ *
+ * Makes a few million INT calls per row on an anonymous machine: a user
+ * handler installed with setvect, the same with a second handler
+ * chained in front of it, and the built-in INT 1Ah, INT 21h and INT 33h
+ * services through int86, int86x and intr. A plain call of the handler
+ * is the baseline. Reports millions of calls per second and ns per call.
+ *
+ * Usage: pccore_bench_interrupt [million calls]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../pccore/pccore.h"
+#include "../pccore/memory.h"
+#include "../turboc/dos.h"
+
+static PCCORE g_machine;
+static INTERRUPTHANDLER g_previous;
+static unsigned long g_count;
+
+typedef enum {
+    CALL_DIRECT,
+    CALL_USER,
+    CALL_CHAINED,
+    CALL_BIOS_TIME,
+    CALL_DOS_TIME,
+    CALL_MOUSE,
+    CALL_COUNT
+} CALL;
+
+static const char *callNames[CALL_COUNT] = {
+    "direct call", "int86 60h", "int86 61h chain", "int86 1Ah", "int86x 21h/2Ch", "intr 33h/03h"
+};
+
+static unsigned long long NowNanos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void Counter(struct REGPACK *regs) {
+    g_count++;
+    regs->r_ax++;
+}
+
+static void Hook(struct REGPACK *regs) {
+    regs->r_bx++;
+    g_previous(regs);
+}
+
+static void Run(CALL call, long count) {
+    union REGS regs = { { 0 } };
+    struct SREGS segregs = { 0, 0, 0, 0 };
+    struct REGPACK pack = { 0 };
+    long i;
+
+    for (i = 0; i < count; i++) {
+        switch (call) {
+            case CALL_DIRECT:
+                Counter(&pack);
+                break;
+            case CALL_USER:
+                int86(0x60, &regs, &regs);
+                break;
+            case CALL_CHAINED:
+                int86(0x61, &regs, &regs);
+                break;
+            case CALL_BIOS_TIME:
+                regs.h.ah = 0x00;
+                int86(0x1A, &regs, &regs);
+                break;
+            case CALL_DOS_TIME:
+                regs.h.ah = 0x2C;
+                int86x(0x21, &regs, &regs, &segregs);
+                break;
+            default:
+                pack.r_ax = 0x03;
+                intr(0x33, &pack);
+                break;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    long count = (argc > 1 ? atol(argv[1]) : 20) * 1000000L;
+    int c;
+
+    if (initMachine(&g_machine, MACHINE_ANONYMOUS, NULL) < 0) {
+        return 1;
+    }
+    bindPCCore(&g_machine);
+    startMachineClock(&g_machine);
+    setvect(0x60, Counter);
+    setvect(0x61, Counter);
+    g_previous = getvect(0x61);
+    setvect(0x61, Hook);
+
+    printf("%ld calls per row\n", count);
+    printf("%-16s %12s %10s\n", "call", "M calls/s", "ns/call");
+    for (c = 0; c < CALL_COUNT; c++) {
+        unsigned long long start;
+        double nanos;
+
+        Run((CALL)c, count / 10);
+        start = NowNanos();
+        Run((CALL)c, count);
+        nanos = (double)(NowNanos() - start);
+        printf("%-16s %12.1f %10.2f\n", callNames[c], count / nanos * 1000.0, nanos / count);
+    }
+    return g_count == 0;
+}
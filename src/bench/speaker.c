@@ -0,0 +1,118 @@
+/**
+ * @file speaker.c
+ * @brief Benchmark: PC speaker synthesis cost
+ *
+ * Plays a minute of guest time per scenario through sound()/nosound()
+ * on an anonymous machine, advancing the clock 1 ms at a time and
+ * calling advanceSpeaker every 10 ms like a wrapper's timer. The PCM
+ * goes to a WAV file (default /dev/null). Reports the synthesis time
+ * per sample and as a share of one core at SPEAKER_RATE.
+ *
+ * Usage: pccore_bench_speaker [output.wav]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../pccore/pccore.h"
+#include "../pccore/memory.h"
+#include "../pccore/speaker.h"
+#include "../turboc/dos.h"
+
+#define SCENARIO_MS 60000
+#define ADVANCE_MS 10
+
+static PCCORE g_machine;
+
+typedef enum {
+    SCENE_SILENCE,
+    SCENE_TONE,
+    SCENE_MELODY,
+    SCENE_ARPEGGIO,
+    SCENE_ULTRASONIC,
+    SCENE_COUNT
+} SCENE;
+
+static const char *sceneNames[SCENE_COUNT] = {
+    "silence", "440 Hz", "melody 8/s", "arpeggio 1/ms", "25 kHz"
+};
+
+/**
+ * @brief What the program does at guest millisecond 't'.
+ */
+static void Play(SCENE scene, int t) {
+    static const unsigned notes[] = { 262, 294, 330, 349, 392, 440, 494, 523 };
+
+    switch (scene) {
+        case SCENE_TONE:
+            if (t == 0) {
+                sound(440);
+            }
+            break;
+        case SCENE_MELODY:
+            if (t % 125 == 0) {
+                sound(notes[(t / 125) % 8]);
+            } else if (t % 125 == 100) {
+                nosound();
+            }
+            break;
+        case SCENE_ARPEGGIO:
+            sound(notes[t % 8] * 2);
+            break;
+        case SCENE_ULTRASONIC:
+            if (t == 0) {
+                sound(25000);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "/dev/null";
+    SPEAKER *speaker;
+    int s, t;
+
+    if (initMachine(&g_machine, MACHINE_ANONYMOUS, NULL) < 0) {
+        return 1;
+    }
+    bindPCCore(&g_machine);
+    speaker = openSpeaker(&g_machine, path);
+    if (speaker == NULL) {
+        return 1;
+    }
+    advanceSpeaker(speaker, g_machine.time);
+
+    printf("%d s of guest time per row, %d Hz\n", SCENARIO_MS / 1000, SPEAKER_RATE);
+    printf("%-14s %10s %12s %14s\n", "scenario", "changes", "ns/sample", "% of a core");
+
+    for (s = 0; s < SCENE_COUNT; s++) {
+        unsigned long long nanos = speaker->synth_nanos;
+        unsigned long long position = speaker->position;
+        unsigned long changes = speaker->events_queued;
+
+        for (t = 0; t < SCENARIO_MS; t++) {
+            g_machine.time++;
+            Play((SCENE)s, t);
+            if (t % ADVANCE_MS == 0) {
+                advanceSpeaker(speaker, g_machine.time);
+                // Faster than real time: let the writer keep up
+                while (__atomic_load_n(&speaker->ring_head, __ATOMIC_ACQUIRE) -
+                       __atomic_load_n(&speaker->ring_tail, __ATOMIC_ACQUIRE) > SPEAKER_RING_SAMPLES / 2) {
+                    usleep(1000);
+                }
+            }
+        }
+        nosound();
+
+        nanos = speaker->synth_nanos - nanos;
+        position = speaker->position - position;
+        printf("%-14s %10lu %12.2f %13.4f%%\n", sceneNames[s], speaker->events_queued - changes,
+               (double)nanos / position, (double)nanos / (position * (1e9 / SPEAKER_RATE)) * 100.0);
+    }
+
+    closeSpeaker(&g_machine, speaker, g_machine.time, stdout);
+    return 0;
+}
@@ -31,7 +31,8 @@ int dos_main(int argc, char *argv[])
     regs.h.al = 3;
     int86(0x10,&regs,&regs);
 
-    outportb(0x3D8,(char)255);
+    /* 80x25, B/W, blink on */
+    outportb(0x3D8,0x2D);
 
     for(i=0;i<172;i++){
         cga_mem[i] = rand() & 0xFF;
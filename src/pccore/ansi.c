@@ -0,0 +1,270 @@
+#include "ansi.h"
+#include "cga.h" // For the palettes and the mode register bits
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @brief Unicode code points of the CP437 character set (the CGA font).
+ * Control characters 0x01-0x1F and 0x7F use their CP437 glyphs.
+ */
+static const unsigned short g_cp437[256] = {
+    0x0020, 0x263A, 0x263B, 0x2665, 0x2666, 0x2663, 0x2660, 0x2022,
+    0x25D8, 0x25CB, 0x25D9, 0x2642, 0x2640, 0x266A, 0x266B, 0x263C,
+    0x25BA, 0x25C4, 0x2195, 0x203C, 0x00B6, 0x00A7, 0x25AC, 0x21A8,
+    0x2191, 0x2193, 0x2192, 0x2190, 0x221F, 0x2194, 0x25B2, 0x25BC,
+    0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027,
+    0x0028, 0x0029, 0x002A, 0x002B, 0x002C, 0x002D, 0x002E, 0x002F,
+    0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+    0x0038, 0x0039, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F,
+    0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+    0x0048, 0x0049, 0x004A, 0x004B, 0x004C, 0x004D, 0x004E, 0x004F,
+    0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+    0x0058, 0x0059, 0x005A, 0x005B, 0x005C, 0x005D, 0x005E, 0x005F,
+    0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+    0x0068, 0x0069, 0x006A, 0x006B, 0x006C, 0x006D, 0x006E, 0x006F,
+    0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+    0x0078, 0x0079, 0x007A, 0x007B, 0x007C, 0x007D, 0x007E, 0x2302,
+    0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7,
+    0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5,
+    0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9,
+    0x00FF, 0x00D6, 0x00DC, 0x00A2, 0x00A3, 0x00A5, 0x20A7, 0x0192,
+    0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA,
+    0x00BF, 0x2310, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB,
+    0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556,
+    0x2555, 0x2563, 0x2551, 0x2557, 0x255D, 0x255C, 0x255B, 0x2510,
+    0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x255E, 0x255F,
+    0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x2567,
+    0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256B,
+    0x256A, 0x2518, 0x250C, 0x2588, 0x2584, 0x258C, 0x2590, 0x2580,
+    0x03B1, 0x00DF, 0x0393, 0x03C0, 0x03A3, 0x03C3, 0x00B5, 0x03C4,
+    0x03A6, 0x0398, 0x03A9, 0x03B4, 0x221E, 0x03C6, 0x03B5, 0x2229,
+    0x2261, 0x00B1, 0x2265, 0x2264, 0x2320, 0x2321, 0x00F7, 0x2248,
+    0x00B0, 0x2219, 0x00B7, 0x221A, 0x207F, 0x00B2, 0x25A0, 0x00A0
+};
+
+// CGA color index (BGR bit order) to ANSI color index (RGB bit order)
+static const unsigned char g_cgaToAnsi[8] = { 0, 4, 2, 6, 1, 5, 3, 7 };
+
+// Closest 16-color index for each gray level of g_cgaGrayPalette
+static const unsigned char g_grayToAnsi[16] = { 0, 0, 8, 8, 8, 8, 8, 7, 8, 8, 7, 7, 7, 7, 15, 15 };
+
+/**
+ * @brief Appends bytes to the frame buffer (drops them if it is full).
+ */
+static void put(ANSISCREEN* screen, const char* text, size_t length) {
+    if (screen->used + length > sizeof(screen->buffer)) {
+        return;
+    }
+    memcpy(screen->buffer + screen->used, text, length);
+    screen->used += length;
+}
+
+/**
+ * @brief Appends a printf-style formatted string to the frame buffer.
+ */
+static void putf(ANSISCREEN* screen, const char* format, int a, int b, int c) {
+    char text[32];
+    int length = snprintf(text, sizeof(text), format, a, b, c);
+    put(screen, text, (size_t)length);
+}
+
+/**
+ * @brief Appends one CP437 character as UTF-8.
+ */
+static void putChar(ANSISCREEN* screen, unsigned char code) {
+    unsigned int cp = g_cp437[code];
+    char utf8[3];
+
+    if (cp < 0x80) {
+        utf8[0] = (char)cp;
+        put(screen, utf8, 1);
+    } else if (cp < 0x800) {
+        utf8[0] = (char)(0xC0 | (cp >> 6));
+        utf8[1] = (char)(0x80 | (cp & 0x3F));
+        put(screen, utf8, 2);
+    } else {
+        utf8[0] = (char)(0xE0 | (cp >> 12));
+        utf8[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        utf8[2] = (char)(0x80 | (cp & 0x3F));
+        put(screen, utf8, 3);
+    }
+}
+
+/**
+ * @brief Appends one SGR color (foreground or background) for a CGA index.
+ */
+static void putColor(ANSISCREEN* screen, int index, int background, int grayscale) {
+    if (screen->colors == ANSI_TRUECOLOR) {
+        const RgbColor* color = grayscale ? &g_cgaGrayPalette[index] : &g_cga16ColorPalette[index];
+        putf(screen, background ? ";48;2;%d;%d;%d" : ";38;2;%d;%d;%d",
+             color->r, color->g, color->b);
+        return;
+    }
+
+    if (grayscale) {
+        index = g_grayToAnsi[index];
+    } else {
+        index = g_cgaToAnsi[index & 7] | (index & 8);
+    }
+    // 30-37 / 90-97 for the foreground, 40-47 / 100-107 for the background
+    putf(screen, ";%d", (index & 8 ? 90 : 30) + (background ? 10 : 0) + (index & 7), 0, 0);
+}
+
+/**
+ * @brief Moves the terminal cursor to (row, col) with the shortest sequence.
+ */
+static void moveTo(ANSISCREEN* screen, int row, int col) {
+    if (screen->row == row && screen->col == col) {
+        return;
+    }
+
+    if (screen->row == row && screen->col >= 0 && col > screen->col) {
+        // Cursor forward on the same row
+        if (col - screen->col == 1) {
+            put(screen, "\x1b[C", 3);
+        } else {
+            putf(screen, "\x1b[%dC", col - screen->col, 0, 0);
+        }
+    } else if (col == 0 && screen->row >= 0 && row == screen->row + 1) {
+        put(screen, "\r\n", 2);
+    } else {
+        putf(screen, "\x1b[%d;%dH", row + 1, col + 1, 0);
+    }
+
+    screen->row = row;
+    screen->col = col;
+}
+
+void initAnsiScreen(ANSISCREEN* screen, ANSICOLORS colors) {
+    int i;
+
+    screen->colors = colors;
+    for (i = 0; i < ANSI_MAX_COLS * ANSI_MAX_ROWS; i++) {
+        screen->cells[i] = -1;
+    }
+    screen->cols = 0;
+    screen->mode = CGA80x25;
+    screen->mode_reg = 0;
+    screen->row = screen->col = -1;
+    screen->fg = screen->bg = screen->blink = -1;
+    screen->used = 0;
+    screen->frames = screen->changed = screen->bytes = 0;
+}
+
+long emitAnsiFrame(ANSISCREEN* screen, const VIDEOSNAPSHOT* video, int fd) {
+    const int rows = ANSI_MAX_ROWS;
+    int cols;
+    int row, col;
+    size_t sent = 0;
+
+    screen->used = 0;
+    screen->frames++;
+
+    if (video->mode == CGA80x25) {
+        cols = 80;
+    } else if (video->mode == CGA40x25) {
+        cols = 40;
+    } else {
+        // Graphics modes have no text to show; say so once
+        if (screen->cols != 0 || screen->frames == 1) {
+            put(screen, "\x1b[0m\x1b[2J\x1b[H[graphics mode]", 26);
+            screen->cols = 0;
+            screen->mode = video->mode;
+            screen->row = screen->col = -1;
+            screen->fg = screen->bg = screen->blink = -1;
+        }
+        cols = 0;
+    }
+
+    if (cols != 0) {
+        // Palette or blink changes affect every cell: repaint everything
+        if (cols != screen->cols || video->mode_reg != screen->mode_reg) {
+            int i;
+            for (i = 0; i < ANSI_MAX_COLS * ANSI_MAX_ROWS; i++) {
+                screen->cells[i] = -1;
+            }
+            screen->row = screen->col = -1;
+            screen->fg = screen->bg = screen->blink = -1;
+            put(screen, "\x1b[0m\x1b[2J", 8);
+            screen->cols = cols;
+            screen->mode = video->mode;
+            screen->mode_reg = video->mode_reg;
+        }
+
+        int grayscale = video->cga.grayscale;
+        int blink_enabled = video->cga.blink_enabled;
+
+        for (row = 0; row < rows; row++) {
+            for (col = 0; col < cols; col++) {
+                int offset = (video->cga.start + (row * cols + col) * 2) & (PCCORE_VRAM_SIZE - 1);
+                unsigned char code = video->vram[offset];
+                unsigned char attribute = video->vram[offset + 1];
+                int cell = code | (attribute << 8);
+                int* last = &screen->cells[row * ANSI_MAX_COLS + col];
+
+                if (*last == cell) {
+                    continue;
+                }
+                *last = cell;
+                screen->changed++;
+
+                // Same attribute decoding as render80x25
+                int fg = attribute & 0x0F;
+                int bg = blink_enabled ? (attribute >> 4) & 0x07 : (attribute >> 4) & 0x0F;
+                int blink = blink_enabled && (attribute & 0x80);
+
+                moveTo(screen, row, col);
+
+                if (fg != screen->fg || bg != screen->bg || blink != screen->blink) {
+                    if (screen->blink > 0 && !blink) {
+                        // Blink off (25) is not universal; reset, which clears the colors too
+                        put(screen, "\x1b[0", 3);
+                        screen->fg = screen->bg = -1;
+                    } else {
+                        put(screen, "\x1b[", 2);
+                    }
+                    size_t params = screen->used;
+                    if (fg != screen->fg) {
+                        putColor(screen, fg, 0, grayscale);
+                    }
+                    if (bg != screen->bg) {
+                        putColor(screen, bg, 1, grayscale);
+                    }
+                    if (blink && screen->blink <= 0) {
+                        put(screen, ";5", 2);
+                    }
+                    // Each parameter starts with ';'; a leading empty one would mean reset
+                    if (screen->used > params && screen->buffer[params] == ';' &&
+                        screen->buffer[params - 1] == '[') {
+                        memmove(screen->buffer + params, screen->buffer + params + 1,
+                                screen->used - params - 1);
+                        screen->used--;
+                    }
+                    put(screen, "m", 1);
+                    screen->fg = fg;
+                    screen->bg = bg;
+                    screen->blink = blink;
+                }
+
+                putChar(screen, code);
+
+                // The cursor stays on the last column (pending wrap)
+                screen->col = (col + 1 < cols) ? col + 1 : -1;
+            }
+        }
+    }
+
+    // One write per frame; loop only for short writes on a slow tty
+    while (sent < screen->used) {
+        ssize_t done = write(fd, screen->buffer + sent, screen->used - sent);
+        if (done < 0) {
+            return -1;
+        }
+        sent += (size_t)done;
+    }
+
+    screen->bytes += sent;
+    return (long)sent;
+}
@@ -0,0 +1,73 @@
+/*
+ * ansi.h
+ *
+ * Terminal output for the CGA text modes (CGA80x25, CGA40x25).
+ *
+ * Reads the same character/attribute layout as render80x25/render40x25
+ * (from a VIDEOSNAPSHOT), maps CP437 to UTF-8 and the attributes to SGR
+ * colors. Every frame is compared with what was emitted before, and only
+ * the changed cells are written, with the shortest cursor movement
+ * between them. A frame is built in one buffer and sent with one write().
+ */
+
+#ifndef ANSI_H
+#define ANSI_H
+
+#include "pccore.h"
+
+#include <stddef.h>
+
+// Largest text screen
+#define ANSI_MAX_COLS 80
+#define ANSI_MAX_ROWS 25
+
+// Output buffer; a full 80x25 repaint with every cell recolored fits
+#define ANSI_BUFFER_SIZE (ANSI_MAX_COLS * ANSI_MAX_ROWS * 64 + 64)
+
+/**
+ * @brief Color output of the terminal.
+ */
+typedef enum {
+    ANSI_TRUECOLOR, // 24-bit SGR (38;2;r;g;b), exact CGA and grayscale palettes
+    ANSI_16COLOR    // Classic 30-37/90-97 SGR colors
+} ANSICOLORS;
+
+/**
+ * @brief What the terminal currently shows, and the output counters.
+ */
+typedef struct {
+    ANSICOLORS colors;
+
+    // Last emitted screen: character | attribute << 8, -1 = unknown
+    int cells[ANSI_MAX_COLS * ANSI_MAX_ROWS];
+    int cols;               // Columns of the emitted screen (0 = none)
+    VIDEOMODE mode;         // Mode of the emitted screen
+    unsigned char mode_reg; // 0x3D8 of the emitted screen (B/W, blink enable)
+
+    // Terminal state after the last write, -1 = unknown
+    int row, col;
+    int fg, bg, blink;
+
+    char buffer[ANSI_BUFFER_SIZE];
+    size_t used;
+
+    unsigned long frames;   // Frames processed
+    unsigned long changed;  // Cells written
+    unsigned long bytes;    // Bytes written
+} ANSISCREEN;
+
+/**
+ * @brief Resets the screen state so the next frame is a full repaint.
+ */
+void initAnsiScreen(ANSISCREEN* screen, ANSICOLORS colors);
+
+/**
+ * @brief Emits the changes between the last frame and 'video' to 'fd'.
+ *
+ * Graphics modes are not shown; the terminal gets a one-line notice.
+ *
+ * @return Bytes written, or -1 on a write error.
+ */
+long emitAnsiFrame(ANSISCREEN* screen, const VIDEOSNAPSHOT* video, int fd);
+
+#endif // ANSI_H
@@ -0,0 +1,354 @@
+#include "capture.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+// Y4M per-frame header
+static const char g_frameHeader[] = "FRAME\n";
+
+/**
+ * @brief Monotonic clock in nanoseconds, used for conversion timing.
+ */
+static unsigned long long captureNanos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Places one image row on the canvas as planar R, G, B rows.
+ *
+ * Narrow frames are doubled horizontally, wide frames are centered.
+ * Rows outside the image are black.
+ */
+static void composeRow(const IMAGE* image, int y,
+                       unsigned char* restrict r, unsigned char* restrict g,
+                       unsigned char* restrict b) {
+    int top = (CAPTURE_HEIGHT - image->height) / 2;
+    int scale = (image->width * 2 <= CAPTURE_WIDTH) ? 2 : 1;
+    int width = image->width * scale;
+    int left = (CAPTURE_WIDTH - width) / 2;
+    int x;
+
+    if (y < top || y >= top + image->height || width > CAPTURE_WIDTH) {
+        memset(r, 0, CAPTURE_WIDTH);
+        memset(g, 0, CAPTURE_WIDTH);
+        memset(b, 0, CAPTURE_WIDTH);
+        return;
+    }
+
+    // Black bars left and right
+    memset(r, 0, left);
+    memset(g, 0, left);
+    memset(b, 0, left);
+    memset(r + left + width, 0, CAPTURE_WIDTH - left - width);
+    memset(g + left + width, 0, CAPTURE_WIDTH - left - width);
+    memset(b + left + width, 0, CAPTURE_WIDTH - left - width);
+
+    const unsigned char* restrict src = &image->raw[(size_t)(y - top) * image->width * 3];
+    unsigned char* restrict outR = r + left;
+    unsigned char* restrict outG = g + left;
+    unsigned char* restrict outB = b + left;
+
+    // Deinterleave (doubling narrow frames)
+    if (scale == 2) {
+        for (x = 0; x < image->width; x++) {
+            outR[2 * x] = outR[2 * x + 1] = src[3 * x + 0];
+            outG[2 * x] = outG[2 * x + 1] = src[3 * x + 1];
+            outB[2 * x] = outB[2 * x + 1] = src[3 * x + 2];
+        }
+    } else {
+        for (x = 0; x < width; x++) {
+            outR[x] = src[3 * x + 0];
+            outG[x] = src[3 * x + 1];
+            outB[x] = src[3 * x + 2];
+        }
+    }
+}
+
+/**
+ * @brief Full range BT.601 luma for one planar row.
+ *
+ * Plain fixed-point loops over planar rows: GCC and Clang turn these
+ * into SSE2/NEON code at -O2 and above, on every platform we build for.
+ */
+static void lumaRow(const unsigned char* restrict r, const unsigned char* restrict g,
+                    const unsigned char* restrict b, unsigned char* restrict y) {
+    int x;
+    for (x = 0; x < CAPTURE_WIDTH; x++) {
+        // 77 + 150 + 29 = 256, the sum fits in 16 bits
+        y[x] = (unsigned char)((unsigned short)(77 * r[x] + 150 * g[x] + 29 * b[x] + 128) >> 8);
+    }
+}
+
+/**
+ * @brief Full range BT.601 chroma for a pair of planar rows (2x2 average).
+ */
+static void chromaRow(const unsigned char* restrict r0, const unsigned char* restrict g0,
+                      const unsigned char* restrict b0, const unsigned char* restrict r1,
+                      const unsigned char* restrict g1, const unsigned char* restrict b1,
+                      unsigned char* restrict u, unsigned char* restrict v) {
+    int x;
+    for (x = 0; x < CAPTURE_WIDTH / 2; x++) {
+        int sr = r0[2 * x] + r0[2 * x + 1] + r1[2 * x] + r1[2 * x + 1];
+        int sg = g0[2 * x] + g0[2 * x + 1] + g1[2 * x] + g1[2 * x + 1];
+        int sb = b0[2 * x] + b0[2 * x + 1] + b1[2 * x] + b1[2 * x + 1];
+
+        // Sums of four pixels: scale by 1/1024 instead of 1/256.
+        // Rounding with 511 keeps pure blue/red at 255 instead of wrapping.
+        u[x] = (unsigned char)((-43 * sr - 85 * sg + 128 * sb + (128 << 10) + 511) >> 10);
+        v[x] = (unsigned char)((128 * sr - 107 * sg - 21 * sb + (128 << 10) + 511) >> 10);
+    }
+}
+
+/**
+ * @brief Converts an image into an I420 frame on the constant canvas.
+ */
+static void convertY4M(const IMAGE* image, unsigned char* frame) {
+    unsigned char rows[6][CAPTURE_WIDTH];
+    unsigned char* luma = frame;
+    unsigned char* cb = luma + CAPTURE_WIDTH * CAPTURE_HEIGHT;
+    unsigned char* cr = cb + (CAPTURE_WIDTH / 2) * (CAPTURE_HEIGHT / 2);
+    int y;
+
+    for (y = 0; y < CAPTURE_HEIGHT; y += 2) {
+        composeRow(image, y, rows[0], rows[1], rows[2]);
+        composeRow(image, y + 1, rows[3], rows[4], rows[5]);
+
+        lumaRow(rows[0], rows[1], rows[2], luma + y * CAPTURE_WIDTH);
+        lumaRow(rows[3], rows[4], rows[5], luma + (y + 1) * CAPTURE_WIDTH);
+        chromaRow(rows[0], rows[1], rows[2], rows[3], rows[4], rows[5],
+                  cb + (y / 2) * (CAPTURE_WIDTH / 2), cr + (y / 2) * (CAPTURE_WIDTH / 2));
+    }
+}
+
+/**
+ * @brief Converts an image into packed RGB on the constant canvas.
+ */
+static void convertRGB(const IMAGE* image, unsigned char* frame) {
+    unsigned char rows[3][CAPTURE_WIDTH];
+    int y, x;
+
+    for (y = 0; y < CAPTURE_HEIGHT; y++) {
+        unsigned char* out = frame + (size_t)y * CAPTURE_WIDTH * 3;
+        composeRow(image, y, rows[0], rows[1], rows[2]);
+        for (x = 0; x < CAPTURE_WIDTH; x++) {
+            out[3 * x + 0] = rows[0][x];
+            out[3 * x + 1] = rows[1][x];
+            out[3 * x + 2] = rows[2][x];
+        }
+    }
+}
+
+/**
+ * @brief Writes every byte of an iovec array, resuming after short writes.
+ */
+static int writeAll(int fd, struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t done = writev(fd, iov, count);
+        if (done < 0) {
+            return -1;
+        }
+        // Skip what was written
+        while (count > 0 && (size_t)done >= iov->iov_len) {
+            done -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + done;
+            iov->iov_len -= done;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Writer thread: writes every queued frame in one batch.
+ */
+static void* captureWriter(void* arg) {
+    CAPTURE* capture = (CAPTURE*)arg;
+    struct iovec iov[CAPTURE_QUEUE_FRAMES * 2];
+
+    for (;;) {
+        unsigned long tail, count, i;
+        int n = 0;
+
+        pthread_mutex_lock(&capture->lock);
+        while (capture->head == capture->tail && !capture->closing) {
+            pthread_cond_wait(&capture->ready, &capture->lock);
+        }
+        tail = capture->tail;
+        count = capture->head - tail;
+        pthread_mutex_unlock(&capture->lock);
+
+        if (count == 0) {
+            break; // Closing and nothing left
+        }
+
+        for (i = 0; i < count; i++) {
+            if (capture->format == CAPTURE_Y4M) {
+                iov[n].iov_base = (void*)g_frameHeader;
+                iov[n].iov_len = sizeof(g_frameHeader) - 1;
+                n++;
+            }
+            iov[n].iov_base = capture->queue[(tail + i) % CAPTURE_QUEUE_FRAMES];
+            iov[n].iov_len = capture->frame_size;
+            n++;
+        }
+
+        int failed = !capture->failed && writeAll(capture->fd, iov, n) != 0;
+
+        pthread_mutex_lock(&capture->lock);
+        if (failed) {
+            capture->failed = 1;
+        } else if (!capture->failed) {
+            capture->written += count;
+            capture->batches++;
+        }
+        capture->tail = tail + count;
+        pthread_mutex_unlock(&capture->lock);
+    }
+
+    return NULL;
+}
+
+CAPTURE* openCapture(const char* path, CAPTUREFORMAT format, int fps) {
+    CAPTURE* capture = (CAPTURE*)calloc(1, sizeof(CAPTURE));
+    int i;
+
+    if (capture == NULL) {
+        return NULL;
+    }
+
+    capture->format = format;
+    capture->frame_size = (format == CAPTURE_Y4M)
+        ? CAPTURE_WIDTH * CAPTURE_HEIGHT * 3 / 2
+        : CAPTURE_WIDTH * CAPTURE_HEIGHT * 3;
+
+    for (i = 0; i < CAPTURE_QUEUE_FRAMES; i++) {
+        capture->queue[i] = (unsigned char*)malloc(capture->frame_size);
+        if (capture->queue[i] == NULL) {
+            while (i-- > 0) {
+                free(capture->queue[i]);
+            }
+            free(capture);
+            return NULL;
+        }
+    }
+
+    capture->fd = (strcmp(path, "-") == 0)
+        ? dup(STDOUT_FILENO)
+        : open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (capture->fd < 0) {
+        fprintf(stderr, "Cannot open capture output %s\n", path);
+        for (i = 0; i < CAPTURE_QUEUE_FRAMES; i++) {
+            free(capture->queue[i]);
+        }
+        free(capture);
+        return NULL;
+    }
+
+    // A closed pipe must stop the capture, not the emulator
+    signal(SIGPIPE, SIG_IGN);
+
+    if (format == CAPTURE_Y4M) {
+        char header[96];
+        // 640x200 on a 4:3 screen gives 5:12 pixels; the canvas keeps that
+        int length = snprintf(header, sizeof(header),
+                              "YUV4MPEG2 W%d H%d F%d:1 Ip A5:12 C420jpeg\n",
+                              CAPTURE_WIDTH, CAPTURE_HEIGHT, fps > 0 ? fps : 60);
+        if (write(capture->fd, header, length) != length) {
+            capture->failed = 1;
+        }
+    }
+
+    pthread_mutex_init(&capture->lock, NULL);
+    pthread_cond_init(&capture->ready, NULL);
+
+    if (pthread_create(&capture->writer, NULL, captureWriter, capture) != 0) {
+        close(capture->fd);
+        for (i = 0; i < CAPTURE_QUEUE_FRAMES; i++) {
+            free(capture->queue[i]);
+        }
+        free(capture);
+        return NULL;
+    }
+
+    return capture;
+}
+
+void captureFrame(CAPTURE* capture, const IMAGE* image) {
+    unsigned long head;
+    int full;
+
+    if (capture == NULL || image->width == 0 || image->height == 0 ||
+        image->height > CAPTURE_HEIGHT) {
+        return;
+    }
+
+    pthread_mutex_lock(&capture->lock);
+    head = capture->head;
+    full = capture->failed || head - capture->tail >= CAPTURE_QUEUE_FRAMES;
+    capture->frames++;
+    if (full) {
+        capture->dropped++;
+    }
+    pthread_mutex_unlock(&capture->lock);
+
+    if (full) {
+        return;
+    }
+
+    // The slot at 'head' is not touched by the writer until published
+    unsigned long long start = captureNanos();
+    unsigned char* frame = capture->queue[head % CAPTURE_QUEUE_FRAMES];
+    if (capture->format == CAPTURE_Y4M) {
+        convertY4M(image, frame);
+    } else {
+        convertRGB(image, frame);
+    }
+    capture->convert_nanos += captureNanos() - start;
+
+    pthread_mutex_lock(&capture->lock);
+    capture->head = head + 1;
+    pthread_cond_signal(&capture->ready);
+    pthread_mutex_unlock(&capture->lock);
+}
+
+void closeCapture(CAPTURE* capture) {
+    int i;
+
+    if (capture == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&capture->lock);
+    capture->closing = 1;
+    pthread_cond_signal(&capture->ready);
+    pthread_mutex_unlock(&capture->lock);
+    pthread_join(capture->writer, NULL);
+
+    close(capture->fd);
+
+    printf("Capture: %lu frames, %lu written in %lu writes, %lu dropped%s\n",
+           capture->frames, capture->written, capture->batches, capture->dropped,
+           capture->failed ? ", write error" : "");
+    if (capture->frames > capture->dropped) {
+        printf("Capture conversion: %.1f us/frame\n",
+               (double)capture->convert_nanos / (capture->frames - capture->dropped) / 1000.0);
+    }
+
+    pthread_mutex_destroy(&capture->lock);
+    pthread_cond_destroy(&capture->ready);
+    for (i = 0; i < CAPTURE_QUEUE_FRAMES; i++) {
+        free(capture->queue[i]);
+    }
+    free(capture);
+}
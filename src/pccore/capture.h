@@ -0,0 +1,85 @@
+/*
+ * capture.h
+ *
+ * Streams rendered frames to a file or pipe as YUV4MPEG2 or raw RGB.
+ *
+ * Every frame is placed on a constant canvas, so the stream geometry
+ * does not change across VIDEOMODE switches: 352-pixel wide frames
+ * (the 320x200 and 40x25 modes) are doubled horizontally, 672-pixel
+ * wide frames are centered. Both end up with the same pixel aspect.
+ *
+ * Conversion happens on the calling (render) thread; a writer thread
+ * batches finished frames into large writes, so a slow consumer never
+ * blocks rendering. If the queue is full the frame is dropped and counted.
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "pccore.h"
+
+#include <pthread.h>
+
+// Constant output geometry
+#define CAPTURE_WIDTH 704
+#define CAPTURE_HEIGHT 232
+
+// Frames that may wait for the writer thread
+#define CAPTURE_QUEUE_FRAMES 8
+
+/**
+ * @brief Output formats.
+ */
+typedef enum {
+    CAPTURE_Y4M,    // YUV4MPEG2, 4:2:0 full range (C420jpeg)
+    CAPTURE_RGB     // Headerless packed 24-bit RGB
+} CAPTUREFORMAT;
+
+/**
+ * @brief An open capture stream.
+ */
+typedef struct {
+    int fd;
+    CAPTUREFORMAT format;
+    size_t frame_size;                          // Bytes per converted frame
+
+    unsigned char* queue[CAPTURE_QUEUE_FRAMES]; // Converted frames
+    unsigned long head;                         // Next slot to fill (producer)
+    unsigned long tail;                         // Next slot to write (writer)
+
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    int closing;
+    int failed;                                 // Write error, stop capturing
+
+    unsigned long frames;                       // Frames queued
+    unsigned long written;                      // Frames written
+    unsigned long dropped;                      // Frames dropped, queue full
+    unsigned long batches;                      // write calls
+    unsigned long long convert_nanos;           // Time spent converting
+} CAPTURE;
+
+/**
+ * @brief Opens a capture stream and starts its writer thread.
+ *
+ * @param path   Output file or FIFO. "-" writes to stdout.
+ * @param format Output format.
+ * @param fps    Frame rate written into the Y4M header.
+ * @return The stream, or NULL on error.
+ */
+CAPTURE* openCapture(const char* path, CAPTUREFORMAT format, int fps);
+
+/**
+ * @brief Converts a rendered image and queues it for writing.
+ * Never waits for the writer thread.
+ */
+void captureFrame(CAPTURE* capture, const IMAGE* image);
+
+/**
+ * @brief Writes the queued frames, stops the writer thread and closes the stream.
+ * Prints the capture counters.
+ */
+void closeCapture(CAPTURE* capture);
+
+#endif // CAPTURE_H
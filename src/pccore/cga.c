@@ -1,36 +1,182 @@
 #include "cga.h"
+#include "iobus.h"
+
+#include <string.h>
+
+/**
+ * @brief Video mode selected by the Mode Control Register (0x3D8).
+ */
+static VIDEOMODE decodeMode(unsigned char mode_reg) {
+    if (mode_reg & CGA_MODE_640) {
+        return CGA640x200x1;
+    }
+    if (mode_reg & CGA_MODE_GRAPHICS) {
+        return (mode_reg & CGA_MODE_BW) ? CGA320x200x2g : CGA320x200x2;
+    }
+    return (mode_reg & CGA_MODE_80COL) ? CGA80x25 : CGA40x25;
+}
+
+/**
+ * @brief The 320x200 4-color palette (logic from cga_win.c).
+ */
+static void decode320x200x2(CGASTATE* cga, unsigned char color_reg) {
+    // Index 0 is always the border/background color (bits 0-3)
+    int background = color_reg & 0x0F;
+
+    // Check bit 4 (0x10) for intensity.
+    int intensityOffset = (color_reg & 0x10) ? 8 : 0; /* 0 or +8 */
+
+    // Check bit 5 (0x20) for palette select
+    // Palette 0 base: Green[2], Red[4], Brown[6]
+    // Palette 1 base: Cyan[3], Magenta[5], Light Gray[7]
+    int first = (color_reg & 0x20) ? 3 : 2;
+
+    cga->palette[0] = g_cga16ColorPalette[background];
+    cga->palette[1] = g_cga16ColorPalette[first + intensityOffset];
+    cga->palette[2] = g_cga16ColorPalette[first + 2 + intensityOffset];
+    cga->palette[3] = g_cga16ColorPalette[first + 4 + intensityOffset];
+    cga->border = cga->palette[0];
+}
+
+/**
+ * @brief The 320x200 "Mode 5" palette, selected by the B/W bit (0x04) of
+ * 0x3D8: the Grayscale palette for pixel values 1-3, and the background
+ * converted to its luma.
+ */
+static void decode320x200x2g(CGASTATE* cga, unsigned char color_reg) {
+    RgbColor background = g_cga16ColorPalette[color_reg & 0x0F];
+    // Simple Luma conversion for grayscale
+    unsigned char luma = (unsigned char)((0.299f * background.r) +
+                                         (0.587f * background.g) +
+                                         (0.114f * background.b));
+
+    background.r = background.g = background.b = luma;
+    cga->palette[0] = background;
+    cga->palette[1] = g_cgaGrayscalePalette[1];
+    cga->palette[2] = g_cgaGrayscalePalette[2];
+    cga->palette[3] = g_cgaGrayscalePalette[3];
+    cga->border = background;
+}
+
+void decodeCga(PCCORE* pccore) {
+    unsigned char mode_reg = pccore->port[CGA_MODE_CONTROL_PORT];
+    unsigned char color_reg = pccore->port[CGA_COLOR_REGISTER_PORT];
+    CGASTATE* cga = &pccore->cga;
+
+    memset(cga, 0, sizeof(CGASTATE));
+    pccore->mode = decodeMode(mode_reg);
+    cga->blink_enabled = (mode_reg & CGA_MODE_BLINK) != 0;
+    cga->grayscale = (mode_reg & CGA_MODE_BW) != 0;
+    cga->start = ((((unsigned int)pccore->crtc[CGA_CRTC_START_HIGH] & 0x3F) << 8) |
+                  pccore->crtc[CGA_CRTC_START_LOW]) * 2 & (PCCORE_VRAM_SIZE - 1);
+
+    // Video signal off: everything stays black
+    if ((mode_reg & CGA_MODE_ENABLE) == 0) {
+        return;
+    }
+
+    switch (pccore->mode) {
+    case CGA320x200x2:
+        decode320x200x2(cga, color_reg);
+        break;
+    case CGA320x200x2g:
+        decode320x200x2g(cga, color_reg);
+        break;
+    case CGA640x200x1:
+        // Bits 0-3 set the border AND the foreground color.
+        // Background (pixel 0) is always black.
+        cga->palette[0] = g_cga16ColorPalette[0];
+        cga->palette[1] = g_cga16ColorPalette[color_reg & 0x0F];
+        cga->border = cga->palette[1];
+        break;
+    default:
+        // Text: B/W selects the gray version of the 16 colors
+        memcpy(cga->palette, cga->grayscale ? g_cgaGrayPalette : g_cga16ColorPalette,
+               sizeof(cga->palette));
+        cga->border = cga->palette[color_reg & 0x0F];
+        break;
+    }
+}
+
+/**
+ * @brief 0x3D8 / 0x3D9 written: switch mode and colors now, not per frame.
+ */
+static void writeCgaRegister(PCCORE* pccore, unsigned int port, unsigned char value) {
+    decodeCga(pccore);
+    notifyVideoChange(pccore);
+}
+
+/**
+ * @brief 0x3D5 written: loads the CRTC register selected through 0x3D4.
+ */
+static void writeCrtcRegister(PCCORE* pccore, unsigned int port, unsigned char value) {
+    unsigned int index = pccore->port[CGA_CRTC_INDEX_PORT] & 0x1F;
+
+    if (index >= PCCORE_CRTC_REGISTERS) {
+        return;
+    }
+    pccore->crtc[index] = value;
+    if (index == CGA_CRTC_START_HIGH || index == CGA_CRTC_START_LOW) {
+        decodeCga(pccore);
+        notifyVideoChange(pccore);
+    }
+}
+
+/**
+ * @brief 0x3DA read: retrace status derived from the millisecond clock.
+ *
+ * Frames are 60 Hz; roughly the first 1.25 ms of each one is vertical
+ * retrace. Horizontal retrace is far shorter than the clock resolution,
+ * so bit 0 toggles on every read outside vertical retrace, which lets
+ * loops that wait for either edge of it finish.
+ */
+static unsigned char readCgaStatus(PCCORE* pccore, unsigned int port) {
+    long long phase = (pccore->time * 60) % 1000;
+    unsigned char status;
+
+    if (phase < 75) {
+        status = CGA_STATUS_VRETRACE | CGA_STATUS_RETRACE;
+    } else {
+        status = (pccore->port[port] ^ CGA_STATUS_RETRACE) & CGA_STATUS_RETRACE;
+    }
+    pccore->port[port] = status;
+    return status;
+}
+
+void attachCga(PCCORE* pccore) {
+    setPortHandlers(pccore, CGA_CRTC_DATA_PORT, 1, NULL, writeCrtcRegister);
+    setPortHandlers(pccore, CGA_MODE_CONTROL_PORT, 2, NULL, writeCgaRegister);
+    setPortHandlers(pccore, CGA_STATUS_PORT, 1, readCgaStatus, NULL);
+    decodeCga(pccore);
+}
 
 /**
  * @brief Renders the 320x200 4-color mode. (Full Implementation)
  *
- * Reads from pccore->memory (at 0xB8000) and pccore->port (at 0x3D9),
- * interprets the 2-bit pixel data, maps it to the 4-color
- * palette, and writes the final 24-bit RGB values into image->raw.
+ * Reads the snapshot of VRAM (0xB8000), interprets the 2-bit pixel
+ * data, maps it to the 4-color palette decoded from 0x3D9, and writes
+ * the final 24-bit RGB values into image->raw.
  *
  * This logic is adapted from the WM_PAINT handler in cga_win.c.
  *
  * @param image  Pointer to the output image buffer.
- * @param pccore A const pointer to the PC core state.
+ * @param video  A const pointer to the video snapshot.
  */
-void render320x200x2(IMAGE* image, PCCORE pccore) {
+void render320x200x2(IMAGE* image, const VIDEOSNAPSHOT* video) {
     int y, x;
     int is_odd, scanline_index, bank_offset, line_offset, byte_index, bit_shift;
     unsigned char pixel_byte;
     int palette_index;
     
-    // Array to hold the 4 active palette indexes (0=BG, 1,2,3=FG)
-    int active_palette_indexes[4];
+    // The 4 active colors (0=BG, 1,2,3=FG), decoded when 0x3D9 was written
+    const RgbColor* active_palette = video->cga.palette;
     
     // Pointer to the start of the output RGB buffer
     unsigned char* out_pixel = image->raw;
     
     // Pointer to the start of the CGA video RAM
     // (Assuming it's at 0xB8000 in the main memory map)
-    unsigned char* vram = &pccore.memory[CGA_VIDEO_RAM_START];
-    
-    // Get the color register value from the I/O ports
-    // (Assuming it's at 0x3D9)
-    unsigned char color_reg = pccore.port[CGA_COLOR_REGISTER_PORT];
+    const unsigned char* vram = video->vram;
 
     // --- Add border definitions ---
     const int border_size = 16;
@@ -44,34 +190,10 @@ void render320x200x2(IMAGE* image, PCCORE pccore) {
     image->height = final_height;
     image->aspect_ratio = 1.2f;
 
-    // 2. Calculate Active Palette (logic from cga_win.c)
-    
-    // Index 0 is always the border/background color (bits 0-3)
-    active_palette_indexes[0] = color_reg & 0x0F;
-
-    // Check bit 4 (0x10) for intensity.
-    int intensityOffset = (color_reg & 0x10) ? 8 : 0; /* 0 or +8 */
-
-    // Check bit 5 (0x20) for palette select
-    if ((color_reg & 0x20) == 0) /* Palette 0 */
-    {
-        /* Base: Green[2], Red[4], Brown[6] */
-        active_palette_indexes[1] = 2 + intensityOffset;
-        active_palette_indexes[2] = 4 + intensityOffset;
-        active_palette_indexes[3] = 6 + intensityOffset;
-    }
-    else /* Palette 1 */
-    {
-        /* Base: Cyan[3], Magenta[5], Light Gray[7] */
-        active_palette_indexes[1] = 3 + intensityOffset;
-        active_palette_indexes[2] = 5 + intensityOffset;
-        active_palette_indexes[3] = 7 + intensityOffset;
-    }
-
-    // 3. Get the border color
-    const RgbColor* border_color = &g_cga16ColorPalette[active_palette_indexes[0]];
+    // 2. Get the border color
+    const RgbColor* border_color = &video->cga.border;
 
-    // 4. Render pixels with border
+    // 3. Render pixels with border
     for (y = 0; y < final_height; y++)
     {
         for (x = 0; x < final_width; x++)
@@ -107,11 +229,8 @@ void render320x200x2(IMAGE* image, PCCORE pccore) {
                 bit_shift = (3 - (cga_x % 4)) * 2; /* 6, 4, 2, or 0 */
                 palette_index = (pixel_byte >> bit_shift) & 0x03;
 
-                // Get the final 16-color index from our active palette
-                int final_color_index = active_palette_indexes[palette_index];
-
-                // Get the final RGB color
-                const RgbColor* final_color = &g_cga16ColorPalette[final_color_index];
+                // Get the final RGB color from the active palette
+                const RgbColor* final_color = &active_palette[palette_index];
 
                 // Write the 24-bit RGB pixel to the raw image buffer
                 // (Assuming image->raw is tightly packed, [R,G,B,R,G,B...])
@@ -126,16 +245,16 @@ void render320x200x2(IMAGE* image, PCCORE pccore) {
 /**
  * @brief Renders the 640x200 2-color mode. (Full Implementation)
  *
- * Reads from pccore->memory (at 0xB8000) and pccore->port (at 0x3D9),
- * interprets the 1-bit pixel data, maps it to the 2-color
- * palette, and writes the final 24-bit RGB values into image->raw.
+ * Reads the snapshot of VRAM (0xB8000), interprets the 1-bit pixel
+ * data, maps it to the 2-color palette decoded from 0x3D9, and writes
+ * the final 24-bit RGB values into image->raw.
  *
  * This implementation also adds a 16-pixel border.
  *
  * @param image  Pointer to the output image buffer.
- * @param pccore A const pointer to the PC core state.
+ * @param video  A const pointer to the video snapshot.
  */
-void render640x200x1(IMAGE* image, PCCORE pccore) {
+void render640x200x1(IMAGE* image, const VIDEOSNAPSHOT* video) {
     int y, x;
     int is_odd, scanline_index, bank_offset, line_offset, byte_index, bit_shift;
     unsigned char pixel_byte;
@@ -152,23 +271,18 @@ void render640x200x1(IMAGE* image, PCCORE pccore) {
     unsigned char* out_pixel = image->raw;
 
     // Pointer to the start of the CGA video RAM
-    unsigned char* vram = &pccore.memory[CGA_VIDEO_RAM_START];
-
-    // Get the color register value from the I/O ports
-    unsigned char color_reg = pccore.port[CGA_COLOR_REGISTER_PORT];
+    const unsigned char* vram = video->vram;
 
     // 1. Set the output image dimensions
     image->width = final_width;
     image->height = final_height;
     image->aspect_ratio = 2.4f;
 
-    // 2. Determine palette for 640x200 mode
-    // Bits 0-3 set the border AND the foreground color.
-    // Background (pixel 0) is always black.
-    int color_index = color_reg & 0x0F;
-    const RgbColor* border_color = &g_cga16ColorPalette[color_index];
-    const RgbColor* foreground_color = &g_cga16ColorPalette[color_index];
-    const RgbColor* background_color = &g_cga16ColorPalette[0]; // Index 0 is Black
+    // 2. Palette for 640x200 mode, decoded when 0x3D9 was written:
+    // the border and the foreground share a color, the background is black
+    const RgbColor* border_color = &video->cga.border;
+    const RgbColor* foreground_color = &video->cga.palette[1];
+    const RgbColor* background_color = &video->cga.palette[0];
 
     // 3. Render pixels with border
     for (y = 0; y < final_height; y++)
@@ -219,45 +333,33 @@ void render640x200x1(IMAGE* image, PCCORE pccore) {
 }
 
 /**
- * @brief Renders the 320x200 "Mode 5" (Switches between Grayscale/Cyan-Red-White).
+ * @brief Renders the 320x200 "Mode 5" (Grayscale).
  *
  * This function handles the 320x200 mode when the Black & White bit (Bit 2) 
- * in the Mode Control Register (0x3D8) is set. The actual palette depends 
- * on whether we are emulating a dedicated monochrome display (Grayscale)
- * or standard RGB output (Cyan/Red/White).
+ * in the Mode Control Register (0x3D8) is set; with the bit clear the
+ * mode is the standard Mode 4 (render320x200x2).
  *
- * Logic:
- * If Bit 2 (B/W enable) of 0x3D8 is set:
- * - The foreground palette (indices 1, 2, 3) is fixed.
- * - We use the *Grayscale* palette for emulation (as per initial request).
- * If Bit 2 (B/W enable) of 0x3D8 is NOT set:
- * - The behavior reverts to standard Mode 4.
- *
- * For simplicity and to satisfy the prompt, we will use the **B/W bit (0x04)** * of **0x3D8** to choose between the Grayscale and Cyan-Red-White palettes.
+ * The foreground palette (indices 1, 2, 3) is the fixed Grayscale
+ * palette, and the background is its luma. The palette is decoded when
+ * 0x3D8 or 0x3D9 is written (see decodeCga).
  *
  * @param image  Pointer to the output image buffer.
- * @param pccore A const pointer to the PC core state.
+ * @param video  A const pointer to the video snapshot.
  */
-void render320x200x2g(IMAGE* image, PCCORE pccore) {
+void render320x200x2g(IMAGE* image, const VIDEOSNAPSHOT* video) {
     int y, x;
     int is_odd, scanline_index, bank_offset, line_offset, byte_index, bit_shift;
     unsigned char pixel_byte;
     int palette_index;
     
-    // Palette array for the 4 active colors
-    RgbColor active_palette[4];
+    // The 4 active colors, decoded when 0x3D8 or 0x3D9 was written
+    const RgbColor* active_palette = video->cga.palette;
     
     // Pointer to the start of the output RGB buffer
     unsigned char* out_pixel = image->raw;
     
     // Pointer to the start of the CGA video RAM
-    unsigned char* vram = &pccore.memory[CGA_VIDEO_RAM_START];
-    
-    // Get the color register value from Port 0x3D9 (Background/Border Color)
-    unsigned char color_reg = pccore.port[CGA_COLOR_REGISTER_PORT];
-
-    // Get the mode control register from Port 0x3D8
-    unsigned char mode_reg = pccore.port[CGA_MODE_CONTROL_PORT];
+    const unsigned char* vram = video->vram;
 
     // --- Add border definitions ---
     const int border_size = 16;
@@ -271,51 +373,10 @@ void render320x200x2g(IMAGE* image, PCCORE pccore) {
     image->height = final_height;
     image->aspect_ratio = 1.2f;
 
-    // 2. Determine Palette and Background
-    
-    // Pointer to the fixed 3-color palette (indices 1, 2, 3)
-    const RgbColor* fixed_palette;
-
-    // Check Bit 2 (0x04) of 0x3D8. If set, this usually enables B/W mode.
-    // We use this bit to select between the two requested palettes.
-    if (mode_reg & 0x04) {
-        // B/W bit IS set (Mode 5): Use Grayscale Emulation
-        fixed_palette = g_cgaGrayscalePalette;
-    } else {
-        // B/W bit IS NOT set: Use the fixed Cyan-Red-White RGB palette 
-        // (This simulates the fixed palette often seen when this mode is 
-        // incorrectly activated or on specific hardware configurations).
-        fixed_palette = g_cgaCyanRedWhitePalette;
-    }
-
-    // Color 0: Background/Border Color (from 0x3D9 bits 0-3)
-    int bg_index = color_reg & 0x0F;
-    RgbColor bg_color_rgb = g_cga16ColorPalette[bg_index];
-
-    // If B/W mode is active (mode_reg & 0x04), convert background/border to grayscale
-    if (mode_reg & 0x04) {
-        // Simple Luma conversion for grayscale
-        unsigned char bg_luma = (unsigned char)((0.299f * bg_color_rgb.r) + 
-                                                (0.587f * bg_color_rgb.g) + 
-                                                (0.114f * bg_color_rgb.b));
-        active_palette[0].r = bg_luma;
-        active_palette[0].g = bg_luma;
-        active_palette[0].b = bg_luma;
-    } else {
-        // If not in B/W mode, use the full RGB background color
-        active_palette[0] = bg_color_rgb;
-    }
-
-    // Set the foreground colors (indices 1, 2, 3) from the selected fixed palette
-    active_palette[1] = fixed_palette[1];
-    active_palette[2] = fixed_palette[2];
-    active_palette[3] = fixed_palette[3];
-
+    // 2. Set the border color (which is index 0)
+    const RgbColor* border_color = &video->cga.border;
 
-    // 3. Set the border color (which is index 0)
-    const RgbColor* border_color = &active_palette[0];
-
-    // 4. Render pixels
+    // 3. Render pixels
     for (y = 0; y < final_height; y++)
     {
         for (x = 0; x < final_width; x++)
@@ -366,14 +427,14 @@ void render320x200x2g(IMAGE* image, PCCORE pccore) {
  * @brief Renders the 40x25 B/W text mode (Mode 0) with support for blinking.
  *
  * Blinking is enabled globally by Bit 5 of the Mode Select Register (3D8).
- * The current blink phase is provided by the pccore.blink (0 or 1).
- * If blinking is enabled and active (pccore.blink == 1), any character with
+ * The current blink phase is provided by the video->blink (0 or 1).
+ * If blinking is enabled and active (video->blink == 1), any character with
  * attribute Bit 7 set will have its foreground color replaced by its background color.
  *
  * @param image  Pointer to the output image buffer.
- * @param pccore A const pointer to the PC core state.
+ * @param video  A const pointer to the video snapshot.
  */
-void render40x25(IMAGE* image, PCCORE pccore) {
+void render40x25(IMAGE* image, const VIDEOSNAPSHOT* video) {
     // --- Constants and Setup ---
     const int COLS = 40;
     const int ROWS = 25;
@@ -387,36 +448,23 @@ void render40x25(IMAGE* image, PCCORE pccore) {
     const int final_height = active_height + (border_size * 2);
     
     // Pointer to video RAM (starts at 0xB8000)
-    unsigned char* vram = &pccore.memory[CGA_VIDEO_RAM_START];
+    const unsigned char* vram = video->vram;
     
     // Pointer to output buffer
     unsigned char* out_pixel = image->raw;
     
-    // Get the Color Select Register (3D9)
-    unsigned char color_reg = pccore.port[CGA_COLOR_REGISTER_PORT];
-    
-    // Get the Mode Select Register (3D8)
-    unsigned char mode_reg = pccore.port[CGA_MODE_CONTROL_PORT];
-
-    // Check bit 2 (0x04) of 3D9 - Color Burst Enable/Disable
-    // 0 = Color burst enabled (use color palette), 1 = Color burst disabled (grayscale)
-    int use_grayscale = (mode_reg & 0x04) ? 1 : 0;
-    
-    // Select the appropriate palette
-    const RgbColor* palette = use_grayscale ? g_cgaGrayPalette : g_cga16ColorPalette;
-    
-    // Get border color from 3D9 register (bits 0-3)
-    int border_color_index = color_reg & 0x0F;
-    const RgbColor* border_color = &palette[border_color_index];
+    // Color or gray palette and border, decoded when 3D8/3D9 were written
+    const RgbColor* palette = video->cga.palette;
+    const RgbColor* border_color = &video->cga.border;
     
     // --- Blinking Logic Initialization ---
     
-    // Check 3D8 Bit 5 (0x20) - 1 = blinking on, 0 = 16-color background
-    int global_blink_enabled = (mode_reg & 0x20) != 0;
+    // 3D8 Bit 5 (0x20) - 1 = blinking on, 0 = 16-color background
+    int global_blink_enabled = video->cga.blink_enabled;
     
     // Determine if the blink effect should be applied for this frame
     // This is true if global blink is enabled AND the core's blink phase is 1.
-    int blink_active_this_frame = global_blink_enabled && (pccore.blink == 1);
+    int blink_active_this_frame = global_blink_enabled && (video->blink == 1);
     
     // Set image dimensions
     image->width = final_width;
@@ -446,8 +494,10 @@ void render40x25(IMAGE* image, PCCORE pccore) {
                 int pixel_x_in_char = cga_x % CHAR_WIDTH;
                 int pixel_y_in_char = cga_y % CHAR_HEIGHT;
                 
-                // Calculate offset in video RAM (2 bytes per character)
-                int vram_offset = (char_row * COLS + char_col) * 2;
+                // Calculate offset in video RAM (2 bytes per character),
+                // from the CRTC start address
+                int vram_offset = (video->cga.start + (char_row * COLS + char_col) * 2) &
+                                  (PCCORE_VRAM_SIZE - 1);
                 
                 // Get character code and attribute
                 unsigned char char_code = vram[vram_offset];
@@ -510,9 +560,9 @@ void render40x25(IMAGE* image, PCCORE pccore) {
  * - Mode Control Register (0x3D8) Bit 2 (0x04): 1 = B/W, 0 = Color.
  *
  * @param image  Pointer to the output image buffer.
- * @param pccore A const pointer to the PC core state.
+ * @param video  A const pointer to the video snapshot.
  */
-void render80x25(IMAGE* image, PCCORE pccore) {
+void render80x25(IMAGE* image, const VIDEOSNAPSHOT* video) {
     // --- Constants and Setup ---
     const int COLS = 80;
     const int ROWS = 25;
@@ -526,38 +576,24 @@ void render80x25(IMAGE* image, PCCORE pccore) {
     const int final_height = active_height + (border_size * 2);
     
     // Pointer to video RAM (starts at 0xB8000)
-    unsigned char* vram = &pccore.memory[CGA_VIDEO_RAM_START];
+    const unsigned char* vram = video->vram;
     
     // Pointer to output buffer
     unsigned char* out_pixel = image->raw;
     
-    // Get the Color Select Register (0x3D9)
-    unsigned char color_reg = pccore.port[CGA_COLOR_REGISTER_PORT];
-    
-    // Get the Mode Select Register (0x3D8)
-    unsigned char mode_reg = pccore.port[CGA_MODE_CONTROL_PORT];
-
-    // --- Palette Selection (Controlled by 0x3D8 Bit 2) ---
-    // Check Bit 2 (0x04) of 0x3D8: 1 = B/W (Grayscale), 0 = Color
-    int use_grayscale = (mode_reg & 0x04) ? 1 : 0;
-    
-    // Select the appropriate palette
-    // Note: The original code in cga.h suggests 3D9 controls color burst. 
-    // This implementation follows the 3D8 Bit 2 control as commonly documented 
-    // for B/W mode selection (Mode 0, 1). We use the g_cgaGrayPalette for grayscale.
-    const RgbColor* palette = use_grayscale ? g_cgaGrayPalette : g_cga16ColorPalette;
-    
-    // Get border color from 3D9 register (bits 0-3)
-    int border_color_index = color_reg & 0x0F;
-    const RgbColor* border_color = &palette[border_color_index];
+    // --- Palette Selection (0x3D8 Bit 2: 1 = B/W, 0 = Color) ---
+    // Decoded when 3D8/3D9 were written: the 16 colors (or their
+    // g_cgaGrayPalette versions) and the border color from 3D9 bits 0-3
+    const RgbColor* palette = video->cga.palette;
+    const RgbColor* border_color = &video->cga.border;
     
     // --- Blinking Logic Initialization (Controlled by 0x3D8 Bit 5) ---
     
-    // Check 3D8 Bit 5 (0x20) - 1 = blinking on, 0 = 16-color background
-    int global_blink_enabled = (mode_reg & 0x20) != 0;
+    // 3D8 Bit 5 (0x20) - 1 = blinking on, 0 = 16-color background
+    int global_blink_enabled = video->cga.blink_enabled;
     
     // Determine if the blink effect should be applied for this frame
-    int blink_active_this_frame = global_blink_enabled && (pccore.blink == 1);
+    int blink_active_this_frame = global_blink_enabled && (video->blink == 1);
     
     // Set image dimensions
     image->width = final_width;
@@ -588,8 +624,9 @@ void render80x25(IMAGE* image, PCCORE pccore) {
                 int pixel_y_in_char = cga_y % CHAR_HEIGHT;
                 
                 // Calculate offset in video RAM (2 bytes per character)
-                // Offset = (row * COLS + col) * 2
-                int vram_offset = (char_row * COLS + char_col) * 2;
+                // Offset = start + (row * COLS + col) * 2, from the CRTC start address
+                int vram_offset = (video->cga.start + (char_row * COLS + char_col) * 2) &
+                                  (PCCORE_VRAM_SIZE - 1);
                 
                 // Get character code and attribute
                 unsigned char char_code = vram[vram_offset];
@@ -36,6 +36,33 @@
 //  | | `--------- 1 = blink, 0 = no blink
 //  `------------ unused
 
+// 3D8 bits
+#define CGA_MODE_80COL 0x01
+#define CGA_MODE_GRAPHICS 0x02
+#define CGA_MODE_BW 0x04
+#define CGA_MODE_ENABLE 0x08
+#define CGA_MODE_640 0x10
+#define CGA_MODE_BLINK 0x20
+
+#define CGA_CRTC_INDEX_PORT 0x3D4
+#define CGA_CRTC_DATA_PORT 0x3D5
+// 6845 CRT controller: write a register number (0-17) to 3D4, then its
+// value to 3D5. Only the start address changes the picture here.
+
+// CRTC registers: start address of the display, in words (14 bits)
+#define CGA_CRTC_START_HIGH 0x0C
+#define CGA_CRTC_START_LOW 0x0D
+
+#define CGA_STATUS_PORT 0x3DA
+// Standard PC I/O port for CGA Status Register (read only)
+// |7|6|5|4|3|2|1|0|  3DA Status Register
+//  | | | | | | | `---- 1 = horizontal or vertical retrace (memory safe to touch)
+//  | | | | `-------- 1 = vertical retrace
+//  `--------------- unused
+
+#define CGA_STATUS_RETRACE 0x01
+#define CGA_STATUS_VRETRACE 0x08
+
 #define CGA_MONO_CONTROL_PORT 0x3B8
 // Standard PC I/O port for BW CRT Control Port
 // |7|6|5|4|3|2|1|0|  3B8 CRT Control Port
@@ -53,13 +80,6 @@
 
 // --- Static CGA Palette ---
 
-// Helper structure for a simple 24-bit RGB color
-typedef struct {
-    unsigned char r;
-    unsigned char g;
-    unsigned char b;
-} RgbColor;
-
 /**
  * @brief Full 16-color CGA palette lookup table.
  * (Adapted from g_cga16ColorPalette in cga_win.c)
@@ -125,45 +145,51 @@ static const RgbColor g_cgaGrayscalePalette[4] = {
     {255, 255, 255}    /* 3: White */
 };
 
+// --- CGA Registers ---
+
 /**
- * @brief Fixed palette for 320x200 B/W mode (Mode 5) - Standard RGB output.
- * Colors 1, 2, and 3 are fixed to Cyan, Red, White.
+ * @brief Registers the CGA port handlers (0x3D5, 0x3D8, 0x3D9 and 0x3DA)
+ * on the I/O bus and decodes the current register values.
+ *
+ * Call it once the machine is mapped, and again after pccore->port has
+ * been replaced behind the bus' back (a restored checkpoint).
  */
-static const RgbColor g_cgaCyanRedWhitePalette[4] = {
-    {0, 0, 0},         /* 0: Placeholder for Background/Border (Handled by 0x3D9) */
-    {0, 170, 170},     /* 1: Cyan (from 16-color index 3) */
-    {170, 0, 0},       /* 2: Red (from 16-color index 4) */
-    {255, 255, 255}    /* 3: White (from 16-color index 15) */
-};
+void attachCga(PCCORE* pccore);
+
+/**
+ * @brief Derives pccore->mode and pccore->cga from 0x3D8, 0x3D9 and the
+ * CRTC start address.
+ */
+void decodeCga(PCCORE* pccore);
 
 // --- Function Prototypes for CGA Modes ---
 
 /**
  * @brief Renders the 320x200 4-color mode.
- * Reads from pccore->memory and writes to image->raw.
+ * Reads the VRAM snapshot and writes to image->raw.
  *
  * @param image  Pointer to the output image buffer.
- * @param pccore A const pointer to the PC core state.
+ * @param video  A const pointer to the video snapshot.
  */
-void render320x200x2(IMAGE* image, PCCORE pccore);
+void render320x200x2(IMAGE* image, const VIDEOSNAPSHOT* video);
 
 /**
- * @brief Renders the 320x200 4-color "Mode 5" (Switches between Grayscale/Cyan-Red-White).
- * Reads from pccore->memory, pccore->port 0x3D9 and 0x3D8.
+ * @brief Renders the 320x200 4-color "Mode 5" (Grayscale).
+ * Reads the VRAM snapshot and the palette decoded from 0x3D9 and 0x3D8.
  *
  * @param image  Pointer to the output image buffer.
- * @param pccore A const pointer to the PC core state.
+ * @param video  A const pointer to the video snapshot.
  */
-void render320x200x2g(IMAGE* image, PCCORE pccore);
+void render320x200x2g(IMAGE* image, const VIDEOSNAPSHOT* video);
 
 /**
  * @brief Renders the 640x200 2-color mode.
- * Reads from pccore->memory and writes to image->raw.
+ * Reads the VRAM snapshot and writes to image->raw.
  *
  * @param image  Pointer to the output image buffer.
- * @param pccore A const pointer to the PC core state.
+ * @param video  A const pointer to the video snapshot.
  */
-void render640x200x1(IMAGE* image, PCCORE pccore);
+void render640x200x1(IMAGE* image, const VIDEOSNAPSHOT* video);
 
 /**
  * @brief Renders the 40x25 B/W text mode (Mode 0).
@@ -181,9 +207,9 @@ void render640x200x1(IMAGE* image, PCCORE pccore);
  * - Bit 2 set (color burst disabled): Use grayscale palette (B/W composite mode)
  *
  * @param image  Pointer to the output image buffer.
- * @param pccore A const pointer to the PC core state.
+ * @param video  A const pointer to the video snapshot.
  */
-void render40x25(IMAGE* image, PCCORE pccore);
+void render40x25(IMAGE* image, const VIDEOSNAPSHOT* video);
 
 /**
  * @brief Renders the 80x25 text mode (Mode 1) with support for blinking and B/W selection.
@@ -199,8 +225,8 @@ void render40x25(IMAGE* image, PCCORE pccore);
  * - Mode Control Register (0x3D8) Bit 2 (0x04): 1 = B/W, 0 = Color.
  *
  * @param image  Pointer to the output image buffer.
- * @param pccore A const pointer to the PC core state.
+ * @param video  A const pointer to the video snapshot.
  */
-void render80x25(IMAGE* image, PCCORE pccore);
+void render80x25(IMAGE* image, const VIDEOSNAPSHOT* video);
 
 #endif // CGA_H
\ No newline at end of file
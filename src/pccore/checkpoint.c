@@ -0,0 +1,510 @@
+#include "checkpoint.h"
+#include "memory.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+#ifdef __APPLE__
+#define fdatasync fsync
+#endif
+
+// Pages per writev() call when writing page data
+#define CHECKPOINT_IOV_PAGES 64
+
+// The logs whose machines the trap handler tracks. Slots are read by
+// the handler without locking; logsLock orders opens and closes.
+static CHECKPOINTLOG* openLogs[CHECKPOINT_MAX_LOGS];
+static int openLogCount = 0;
+static pthread_mutex_t logsLock = PTHREAD_MUTEX_INITIALIZER;
+static struct sigaction previousHandler;
+
+static unsigned long long checkpointNanos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief The open log tracking the machine that holds 'address'.
+ * Safe to call from the trap handler.
+ */
+static CHECKPOINTLOG* findLog(const unsigned char* address) {
+    int i;
+
+    for (i = 0; i < CHECKPOINT_MAX_LOGS; i++) {
+        CHECKPOINTLOG* log = __atomic_load_n(&openLogs[i], __ATOMIC_ACQUIRE);
+        if (log != NULL && address >= log->data &&
+            address < log->data + log->pages * log->page_size) {
+            return log;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Write trap: the first write to a protected page since the
+ * last checkpoint. Marks the page and lets the write through.
+ */
+static void writeTrap(int sig, siginfo_t* info, void* context) {
+    unsigned char* address = (unsigned char*)info->si_addr;
+    CHECKPOINTLOG* log = findLog(address);
+
+    if (log != NULL) {
+        size_t page = (size_t)(address - log->data) / log->page_size;
+        // Unprotect before marking: if a checkpoint protects the page in
+        // between, the write simply traps again and is marked then
+        mprotect(log->data + page * log->page_size, log->page_size, PROT_READ | PROT_WRITE);
+        __atomic_store_n(&log->dirty[page], 1, __ATOMIC_RELEASE);
+        return;
+    }
+
+    // Not ours (a guard page, or a real crash): let the previous handler decide
+    if (previousHandler.sa_flags & SA_SIGINFO) {
+        previousHandler.sa_sigaction(sig, info, context);
+    } else if (previousHandler.sa_handler != SIG_IGN && previousHandler.sa_handler != SIG_DFL) {
+        previousHandler.sa_handler(sig);
+    } else {
+        // Returning faults again with the default action
+        signal(SIGSEGV, SIG_DFL);
+    }
+}
+
+/**
+ * @brief Starts tracking a log's machine; the first log installs the trap.
+ * @return 0, or -1 if the machine already has a log or every slot is taken.
+ */
+static int addLog(CHECKPOINTLOG* log) {
+    int i, result = -1;
+
+    pthread_mutex_lock(&logsLock);
+    if (findLog(log->data) != NULL) {
+        fprintf(stderr, "A checkpoint log is already open for this machine\n");
+    } else {
+        for (i = 0; i < CHECKPOINT_MAX_LOGS && result < 0; i++) {
+            if (openLogs[i] == NULL) {
+                if (openLogCount++ == 0) {
+                    struct sigaction action;
+                    memset(&action, 0, sizeof(action));
+                    action.sa_sigaction = writeTrap;
+                    action.sa_flags = SA_SIGINFO | SA_RESTART;
+                    sigemptyset(&action.sa_mask);
+                    sigaction(SIGSEGV, &action, &previousHandler);
+                }
+                __atomic_store_n(&openLogs[i], log, __ATOMIC_RELEASE);
+                result = 0;
+            }
+        }
+        if (result < 0) {
+            fprintf(stderr, "Too many open checkpoint logs\n");
+        }
+    }
+    pthread_mutex_unlock(&logsLock);
+    return result;
+}
+
+/**
+ * @brief Stops tracking a log's machine (already writable again); the
+ * last log removes the trap.
+ */
+static void removeLog(CHECKPOINTLOG* log) {
+    int i;
+
+    pthread_mutex_lock(&logsLock);
+    for (i = 0; i < CHECKPOINT_MAX_LOGS; i++) {
+        if (openLogs[i] == log) {
+            __atomic_store_n(&openLogs[i], NULL, __ATOMIC_RELEASE);
+            if (--openLogCount == 0) {
+                sigaction(SIGSEGV, &previousHandler, NULL);
+            }
+        }
+    }
+    pthread_mutex_unlock(&logsLock);
+}
+
+/**
+ * @brief write() that finishes short writes.
+ */
+static int writeFully(int fd, const void* buffer, size_t length) {
+    const char* bytes = (const char*)buffer;
+    while (length > 0) {
+        ssize_t done = write(fd, bytes, length);
+        if (done < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        bytes += done;
+        length -= (size_t)done;
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes one record for the pages listed in log->index.
+ *
+ * The pages must already be write-protected, so the copy is stable.
+ */
+static int writeRecord(CHECKPOINTLOG* log, int fd, unsigned int count, int full) {
+    CHECKPOINTRECORD record;
+    unsigned int trailer[2];
+    struct iovec iov[CHECKPOINT_IOV_PAGES];
+    unsigned int i, n;
+
+    record.magic = CHECKPOINT_RECORD_MAGIC;
+    record.seq = ++log->seq;
+    record.pages = count;
+    record.full = (unsigned int)full;
+
+    if (writeFully(fd, &record, sizeof(record)) != 0 ||
+        writeFully(fd, log->index, count * sizeof(unsigned int)) != 0) {
+        return -1;
+    }
+
+    // Page data straight from guest memory, in batches
+    for (i = 0; i < count; i += n) {
+        size_t length = 0;
+        ssize_t done;
+
+        for (n = 0; n < CHECKPOINT_IOV_PAGES && i + n < count; n++) {
+            iov[n].iov_base = log->data + (size_t)log->index[i + n] * log->page_size;
+            iov[n].iov_len = log->page_size;
+            length += log->page_size;
+        }
+        done = writev(fd, iov, (int)n);
+        if (done < 0 && errno == EINTR) {
+            n = 0;
+            continue;
+        }
+        if (done != (ssize_t)length) {
+            // Rare short write: finish page by page
+            size_t skip = done > 0 ? (size_t)done : 0;
+            unsigned int j;
+            if (done < 0) {
+                return -1;
+            }
+            for (j = 0; j < n; j++) {
+                if (skip >= log->page_size) {
+                    skip -= log->page_size;
+                    continue;
+                }
+                if (writeFully(fd, (char*)iov[j].iov_base + skip, log->page_size - skip) != 0) {
+                    return -1;
+                }
+                skip = 0;
+            }
+        }
+    }
+
+    trailer[0] = CHECKPOINT_TRAILER_MAGIC;
+    trailer[1] = record.seq;
+    if (writeFully(fd, trailer, sizeof(trailer)) != 0) {
+        return -1;
+    }
+    if (log->sync && fdatasync(fd) != 0) {
+        return -1;
+    }
+
+    log->log_size += sizeof(record) + count * (sizeof(unsigned int) + log->page_size) + sizeof(trailer);
+    log->pages_written += count;
+    return 0;
+}
+
+/**
+ * @brief Protects every page and writes a full record of the non-zero ones.
+ */
+static int writeFullRecord(CHECKPOINTLOG* log, int fd) {
+    static const unsigned char zero[64] = {0};
+    unsigned int count = 0;
+    size_t page, offset;
+
+    recordMachineState(log->pccore);
+    memset(log->dirty, 0, log->pages);
+    mprotect(log->data, log->pages * log->page_size, PROT_READ);
+
+    for (page = 0; page < log->pages; page++) {
+        const unsigned char* bytes = log->data + page * log->page_size;
+        for (offset = 0; offset < log->page_size; offset += sizeof(zero)) {
+            if (memcmp(bytes + offset, zero, sizeof(zero)) != 0) {
+                log->index[count++] = (unsigned int)page;
+                break;
+            }
+        }
+    }
+    return writeRecord(log, fd, count, 1);
+}
+
+/**
+ * @brief Creates a log file and writes its header.
+ */
+static int createLogFile(CHECKPOINTLOG* log, const char* path) {
+    CHECKPOINTHEADER header;
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.page_size = (unsigned int)log->page_size;
+    header.pages = (unsigned int)log->pages;
+    if (writeFully(fd, &header, sizeof(header)) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    log->log_size = sizeof(header);
+    return fd;
+}
+
+CHECKPOINTLOG* openCheckpointLog(PCCORE* pccore, const char* path) {
+    CHECKPOINTLOG* log;
+
+    log = (CHECKPOINTLOG*)calloc(1, sizeof(CHECKPOINTLOG));
+    if (log == NULL) {
+        return NULL;
+    }
+    log->pccore = pccore;
+    log->data = pccore->memory;
+    log->page_size = (size_t)sysconf(_SC_PAGESIZE);
+    log->pages = pccore->map.data_size / log->page_size;
+    log->compact_ratio = CHECKPOINT_COMPACT_RATIO;
+    log->sync = getenv("PCCORE_CHECKPOINT_SYNC") != NULL;
+    log->dirty = (unsigned char*)calloc(log->pages, 1);
+    log->index = (unsigned int*)malloc(log->pages * sizeof(unsigned int));
+    snprintf(log->path, sizeof(log->path), "%s", path);
+
+    if (log->dirty == NULL || log->index == NULL) {
+        free(log->dirty);
+        free(log->index);
+        free(log);
+        return NULL;
+    }
+
+    log->fd = -1;
+
+    // Install the trap before anything is protected
+    if (addLog(log) != 0) {
+        free(log->dirty);
+        free(log->index);
+        free(log);
+        return NULL;
+    }
+
+    // Written like a compaction, so an existing log (perhaps the one
+    // this machine was restored from) is replaced only once complete
+    if (compactCheckpointLog(log) != 0) {
+        mprotect(log->data, log->pages * log->page_size, PROT_READ | PROT_WRITE);
+        removeLog(log);
+        free(log->dirty);
+        free(log->index);
+        free(log);
+        return NULL;
+    }
+    log->compactions = 0;
+    log->checkpoints++;
+    return log;
+}
+
+/**
+ * @brief compactCheckpointLog on a machine already held.
+ */
+static int compactLog(CHECKPOINTLOG* log) {
+    char temp[sizeof(log->path) + 8];
+    int fd;
+
+    snprintf(temp, sizeof(temp), "%s.tmp", log->path);
+    fd = createLogFile(log, temp);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // A full record of the current machine replaces the whole history
+    if (writeFullRecord(log, fd) != 0 || fdatasync(fd) != 0 ||
+        rename(temp, log->path) != 0) {
+        perror(temp);
+        close(fd);
+        unlink(temp);
+        return -1;
+    }
+
+    if (log->fd >= 0) {
+        close(log->fd);
+    }
+    log->fd = fd;
+    log->compactions++;
+    return 0;
+}
+
+long writeCheckpoint(CHECKPOINTLOG* log) {
+    unsigned long long start = checkpointNanos();
+    unsigned int count = 0;
+    size_t page;
+
+    // One moment of the program: nothing changes until resumeMachine
+    if (!pauseMachine(log->pccore, CHECKPOINT_PAUSE_NS)) {
+        log->skipped++;
+        return 0;
+    }
+
+    // The state page is only dirtied when the mode or the CRTC changed
+    if (log->pccore->map.state->mode != log->pccore->mode ||
+        memcmp(log->pccore->map.state->crtc, log->pccore->crtc, sizeof(log->pccore->crtc)) != 0) {
+        recordMachineState(log->pccore);
+    }
+
+    // Protect first, then copy: writes after resumeMachine trap into the
+    // next checkpoint
+    for (page = 0; page < log->pages; page++) {
+        if (__atomic_load_n(&log->dirty[page], __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&log->dirty[page], 0, __ATOMIC_RELAXED);
+            mprotect(log->data + page * log->page_size, log->page_size, PROT_READ);
+            log->index[count++] = (unsigned int)page;
+        }
+    }
+
+    if (count > 0 && writeRecord(log, log->fd, count, 0) != 0) {
+        resumeMachine(log->pccore);
+        perror(log->path);
+        return -1;
+    }
+    log->checkpoints++;
+
+    if (log->log_size > (unsigned long long)log->compact_ratio * log->pages * log->page_size &&
+        compactLog(log) != 0) {
+        resumeMachine(log->pccore);
+        return -1;
+    }
+    resumeMachine(log->pccore);
+
+    log->nanos += checkpointNanos() - start;
+    return (long)count;
+}
+
+int compactCheckpointLog(CHECKPOINTLOG* log) {
+    int result;
+
+    if (!pauseMachine(log->pccore, CHECKPOINT_PAUSE_NS)) {
+        fprintf(stderr, "%s: the program did not reach an idle point\n", log->path);
+        return -1;
+    }
+    result = compactLog(log);
+    resumeMachine(log->pccore);
+    return result;
+}
+
+void closeCheckpointLog(CHECKPOINTLOG* log) {
+    if (log == NULL) {
+        return;
+    }
+
+    writeCheckpoint(log);
+
+    // Stop tracking: make everything writable, then drop the trap
+    mprotect(log->data, log->pages * log->page_size, PROT_READ | PROT_WRITE);
+    removeLog(log);
+
+    if (log->checkpoints > 0) {
+        printf("Checkpoints: %lu written (%lu skipped), %lu pages, %lu compactions, %.1f us/checkpoint\n",
+               log->checkpoints, log->skipped, log->pages_written, log->compactions,
+               (double)log->nanos / log->checkpoints / 1000.0);
+    }
+
+    close(log->fd);
+    free(log->dirty);
+    free(log->index);
+    free(log);
+}
+
+int restoreCheckpointLog(PCCORE* pccore, const char* path) {
+    CHECKPOINTHEADER header;
+    CHECKPOINTRECORD record;
+    unsigned int trailer[2];
+    unsigned int* index = NULL;
+    unsigned char* pages = NULL;
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t machinePages = pccore->map.data_size / pageSize;
+    int applied = 0;
+    unsigned int i;
+    FILE* file = fopen(path, "rb");
+
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.page_size != pageSize || header.pages != machinePages) {
+        fprintf(stderr, "%s is not a checkpoint log for this machine\n", path);
+        fclose(file);
+        return -1;
+    }
+
+    index = (unsigned int*)malloc(machinePages * sizeof(unsigned int));
+    pages = (unsigned char*)malloc(machinePages * pageSize);
+    if (index == NULL || pages == NULL) {
+        free(index);
+        free(pages);
+        fclose(file);
+        return -1;
+    }
+
+    // Read a whole record before applying it, so a torn tail changes nothing
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        if (record.magic != CHECKPOINT_RECORD_MAGIC || record.pages > machinePages ||
+            fread(index, sizeof(unsigned int), record.pages, file) != record.pages ||
+            fread(pages, pageSize, record.pages, file) != record.pages ||
+            fread(trailer, sizeof(trailer), 1, file) != 1 ||
+            trailer[0] != CHECKPOINT_TRAILER_MAGIC || trailer[1] != record.seq) {
+            break;
+        }
+
+        if (record.full) {
+            memset(pccore->memory, 0, pccore->map.data_size);
+        }
+        for (i = 0; i < record.pages; i++) {
+            if (index[i] < machinePages) {
+                memcpy(pccore->memory + (size_t)index[i] * pageSize, pages + (size_t)i * pageSize, pageSize);
+            }
+        }
+        applied++;
+    }
+
+    free(index);
+    free(pages);
+    fclose(file);
+
+    restoreMachineState(pccore);
+    return applied;
+}
+
+void prepareGuestWrite(void* address, size_t length) {
+    unsigned char* start = (unsigned char*)address;
+    CHECKPOINTLOG* log = findLog(start);
+    size_t first, last, page;
+
+    if (log == NULL || length == 0) {
+        return;
+    }
+
+    first = (size_t)(start - log->data) / log->page_size;
+    last = (size_t)(start + length - 1 - log->data) / log->page_size;
+    if (last >= log->pages) {
+        last = log->pages - 1;
+    }
+    for (page = first; page <= last; page++) {
+        log->dirty[page] = 1;
+    }
+    mprotect(log->data + first * log->page_size, (last - first + 1) * log->page_size,
+             PROT_READ | PROT_WRITE);
+}
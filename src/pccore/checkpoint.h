@@ -0,0 +1,141 @@
+/*
+ * checkpoint.h
+ *
+ * Incremental checkpoints of a machine (memory, ports and MACHINESTATE,
+ * see memory.h) to an append-only delta log.
+ *
+ * While a log is open, the machine is write-protected page by page. The
+ * first write to a page after a checkpoint traps (SIGSEGV), marks the
+ * page dirty and makes it writable again, so a checkpoint only has to
+ * write the pages touched since the previous one.
+ *
+ * A checkpoint is taken while the DOS thread is held at an idle point
+ * (pauseMachine), so every record is the machine at one moment of the
+ * program, never pages from before a write mixed with pages from after
+ * it. If the program does not reach an idle point (delay()) within
+ * CHECKPOINT_PAUSE_NS, the checkpoint is skipped; its pages stay dirty
+ * and go into the next one.
+ *
+ * Log layout:
+ *
+ *   CHECKPOINTHEADER
+ *   record*:  CHECKPOINTRECORD, page index[pages], page data[pages], trailer
+ *
+ * The first record is a full image (all non-zero pages). A record only
+ * counts once its trailer is on disk, so a crash mid-write loses at most
+ * the last checkpoint. When the log grows past compact_ratio times the
+ * machine size it is rewritten as a single full record.
+ *
+ * Each machine can have one log open, up to CHECKPOINT_MAX_LOGS machines
+ * per process; the trap handler finds the log by the faulting address.
+ * Code that fills guest memory with a system call (read() into guest
+ * memory) must call prepareGuestWrite() first: the kernel does not raise
+ * the trap for its own writes, it fails them with EFAULT.
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "pccore.h"
+
+#define CHECKPOINT_MAGIC "PCCKPT\0\1"
+#define CHECKPOINT_RECORD_MAGIC 0x54504B43u  // "CKPT"
+#define CHECKPOINT_TRAILER_MAGIC 0x454E4F44u // "DONE"
+
+// Default log size, in machine sizes, that triggers compaction
+#define CHECKPOINT_COMPACT_RATIO 4
+
+// How long a checkpoint waits for the DOS thread to reach an idle point
+#define CHECKPOINT_PAUSE_NS 50000000ULL
+
+// Machines with an open log at the same time
+#define CHECKPOINT_MAX_LOGS 64
+
+/**
+ * @brief Start of a log file.
+ */
+typedef struct {
+    char magic[8];                  // CHECKPOINT_MAGIC
+    unsigned int page_size;
+    unsigned int pages;             // Pages in the machine
+} CHECKPOINTHEADER;
+
+/**
+ * @brief Start of one checkpoint.
+ */
+typedef struct {
+    unsigned int magic;             // CHECKPOINT_RECORD_MAGIC
+    unsigned int seq;               // Checkpoint number
+    unsigned int pages;             // Pages that follow
+    unsigned int full;              // 1 if pages not listed are zero
+} CHECKPOINTRECORD;
+
+/**
+ * @brief An open delta log.
+ */
+typedef struct {
+    PCCORE* pccore;
+    int fd;
+    char path[1024];
+
+    unsigned char* data;            // pccore->memory
+    size_t page_size;
+    size_t pages;
+    unsigned char* dirty;           // One byte per page, set by the trap
+    unsigned int* index;            // Scratch: dirty page numbers
+
+    unsigned int seq;
+    unsigned long long log_size;    // Bytes in the log
+    int compact_ratio;
+    int sync;                       // fdatasync() every checkpoint
+
+    unsigned long checkpoints;
+    unsigned long skipped;          // No idle point within CHECKPOINT_PAUSE_NS
+    unsigned long pages_written;
+    unsigned long compactions;
+    unsigned long long nanos;       // Time spent in writeCheckpoint
+} CHECKPOINTLOG;
+
+/**
+ * @brief Creates a log with a full record and starts tracking writes.
+ * An existing file at 'path' is replaced once the new log is complete.
+ * @return The log, or NULL on error.
+ */
+CHECKPOINTLOG* openCheckpointLog(PCCORE* pccore, const char* path);
+
+/**
+ * @brief Appends the pages dirtied since the last checkpoint, with the
+ * DOS thread held at an idle point. Compacts the log when it has grown
+ * past compact_ratio.
+ * @return Pages written (0 if the checkpoint was skipped, see
+ * 'skipped'), or -1 on error.
+ */
+long writeCheckpoint(CHECKPOINTLOG* log);
+
+/**
+ * @brief Rewrites the log as one full record of the current machine,
+ * with the DOS thread held at an idle point.
+ * @return 0 on success, -1 on error or if it never went idle.
+ */
+int compactCheckpointLog(CHECKPOINTLOG* log);
+
+/**
+ * @brief Writes a last checkpoint, stops tracking, prints the counters
+ * and closes the log.
+ */
+void closeCheckpointLog(CHECKPOINTLOG* log);
+
+/**
+ * @brief Replays a log into a machine set up by initMachine.
+ * Incomplete trailing records are ignored.
+ * @return Checkpoints applied (the device state is restored), or -1.
+ */
+int restoreCheckpointLog(PCCORE* pccore, const char* path);
+
+/**
+ * @brief Makes guest memory writable for a system call that fills it.
+ * Does nothing when no log tracks that memory.
+ */
+void prepareGuestWrite(void* address, size_t length);
+
+#endif // CHECKPOINT_H
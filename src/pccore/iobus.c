@@ -0,0 +1,43 @@
+#include "iobus.h"
+
+void setPortHandlers(PCCORE* pccore, unsigned int first, unsigned int count,
+                     PORTREADER reader, PORTWRITER writer) {
+    unsigned int port;
+
+    for (port = first; port < first + count && port < PCCORE_BUS_PORTS; port++) {
+        __atomic_store_n(&pccore->bus.readers[port], reader, __ATOMIC_RELEASE);
+        __atomic_store_n(&pccore->bus.writers[port], writer, __ATOMIC_RELEASE);
+    }
+}
+
+unsigned char readPort(PCCORE* pccore, unsigned int port) {
+    PORTREADER reader = NULL;
+
+    port &= PCCORE_PORT_SIZE - 1;
+    if (port < PCCORE_BUS_PORTS) {
+        reader = __atomic_load_n(&pccore->bus.readers[port], __ATOMIC_ACQUIRE);
+    }
+    return reader != NULL ? reader(pccore, port) : pccore->port[port];
+}
+
+void writePort(PCCORE* pccore, unsigned int port, unsigned char value) {
+    PORTWRITER writer = NULL;
+
+    port &= PCCORE_PORT_SIZE - 1;
+    pccore->port[port] = value;
+    if (port < PCCORE_BUS_PORTS) {
+        writer = __atomic_load_n(&pccore->bus.writers[port], __ATOMIC_ACQUIRE);
+    }
+    if (writer != NULL) {
+        writer(pccore, port, value);
+    }
+}
+
+unsigned int readPortWord(PCCORE* pccore, unsigned int port) {
+    return readPort(pccore, port) | (readPort(pccore, port + 1) << 8);
+}
+
+void writePortWord(PCCORE* pccore, unsigned int port, unsigned int value) {
+    writePort(pccore, port, (unsigned char)(value & 0xFF));
+    writePort(pccore, port + 1, (unsigned char)((value >> 8) & 0xFF));
+}
@@ -0,0 +1,39 @@
+/*
+ * iobus.h
+ *
+ * The I/O port bus behind inportb()/outportb().
+ *
+ * Every port has an optional read and write handler, looked up in the
+ * machine's flat table (pccore->bus) indexed by the port number, so each
+ * machine has its own devices. A write always stores the byte in
+ * pccore->port[] first (so images and checkpoints keep the registers) and
+ * then calls the write handler, which decodes it into device state. A
+ * read returns the read handler's value, or pccore->port[] if there is
+ * none. Ports without handlers behave like plain memory, as before.
+ *
+ * Word accesses follow OUT DX,AX / IN AX,DX: the low byte goes to 'port',
+ * the high byte to 'port + 1'.
+ */
+
+#ifndef IOBUS_H
+#define IOBUS_H
+
+#include "pccore.h"
+
+/**
+ * @brief Installs handlers for 'count' ports of 'pccore' starting at
+ * 'first' (PORTREADER and PORTWRITER are in pccore.h). NULL restores the
+ * plain-memory behaviour for that direction. Other machines are not
+ * affected. Safe while the DOS thread runs, but a handler it has already
+ * looked up may still be called once.
+ */
+void setPortHandlers(PCCORE* pccore, unsigned int first, unsigned int count,
+                     PORTREADER reader, PORTWRITER writer);
+
+unsigned char readPort(PCCORE* pccore, unsigned int port);
+void writePort(PCCORE* pccore, unsigned int port, unsigned char value);
+
+unsigned int readPortWord(PCCORE* pccore, unsigned int port);
+void writePortWord(PCCORE* pccore, unsigned int port, unsigned int value);
+
+#endif // IOBUS_H
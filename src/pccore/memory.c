@@ -0,0 +1,225 @@
+#include "memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+/**
+ * @brief Bytes between the guard pages (the part an image file holds).
+ */
+static size_t machineDataSize(size_t page) {
+    size_t state = (sizeof(MACHINESTATE) + page - 1) / page * page;
+    return PCCORE_MEMORY_SIZE + PCCORE_PORT_SIZE + state;
+}
+
+/**
+ * @brief Points memory, port and the state at their parts of 'data'.
+ */
+static void placeMachine(PCCORE* pccore, unsigned char* data) {
+    pccore->memory = data;
+    pccore->port = data + PCCORE_MEMORY_SIZE;
+    pccore->map.state = (MACHINESTATE*)(data + PCCORE_MEMORY_SIZE + PCCORE_PORT_SIZE);
+}
+
+/**
+ * @brief Checks that a mapped image was saved by this version.
+ */
+static int validImage(const MACHINESTATE* state) {
+    return memcmp(state->magic, PCCORE_IMAGE_MAGIC, sizeof(state->magic)) == 0 &&
+           state->version == PCCORE_IMAGE_VERSION &&
+           state->memory_size == PCCORE_MEMORY_SIZE &&
+           state->port_size == PCCORE_PORT_SIZE;
+}
+
+void recordMachineState(PCCORE* pccore) {
+    MACHINESTATE* state = pccore->map.state;
+
+    memcpy(state->magic, PCCORE_IMAGE_MAGIC, sizeof(state->magic));
+    state->version = PCCORE_IMAGE_VERSION;
+    state->memory_size = PCCORE_MEMORY_SIZE;
+    state->port_size = PCCORE_PORT_SIZE;
+    state->mode = pccore->mode;
+    state->blink = pccore->blink;
+    state->time = pccore->time;
+    memcpy(state->crtc, pccore->crtc, sizeof(state->crtc));
+}
+
+int restoreMachineState(PCCORE* pccore) {
+    if (!validImage(pccore->map.state)) {
+        return 0;
+    }
+    pccore->mode = pccore->map.state->mode;
+    pccore->blink = pccore->map.state->blink;
+    memcpy(pccore->crtc, pccore->map.state->crtc, sizeof(pccore->crtc));
+    return 1;
+}
+
+#ifdef _WIN32
+
+int initMachine(PCCORE* pccore, MACHINEBACKING backing, const char* path) {
+    size_t size = machineDataSize(4096);
+    unsigned char* data = (unsigned char*)calloc(1, size);
+
+    if (data == NULL) {
+        fprintf(stderr, "Cannot allocate guest memory\n");
+        return -1;
+    }
+    if (backing != MACHINE_ANONYMOUS) {
+        fprintf(stderr, "Machine images are not supported on this platform, ignoring %s\n", path);
+    }
+    pccore->map.base = data;
+    pccore->map.size = size;
+    pccore->map.data_size = size;
+    pccore->map.fd = -1;
+    pccore->map.shared = 0;
+    placeMachine(pccore, data);
+    return 0;
+}
+
+int saveMachine(PCCORE* pccore) {
+    return -1;
+}
+
+void freeMachine(PCCORE* pccore) {
+    free(pccore->map.base);
+    memset(&pccore->map, 0, sizeof(MACHINEMAP));
+    pccore->memory = NULL;
+    pccore->port = NULL;
+}
+
+#else
+
+int initMachine(PCCORE* pccore, MACHINEBACKING backing, const char* path) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t dataSize = machineDataSize(page);
+    size_t size = dataSize + 2 * page;
+    int fd = -1;
+    int resume = 0;
+    unsigned char* data;
+
+    // Reserve the whole range inaccessible, then map the data over the middle
+    unsigned char* base = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        perror("Cannot reserve guest memory");
+        return -1;
+    }
+
+    if (backing == MACHINE_ANONYMOUS) {
+        data = mmap(base + page, dataSize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    } else {
+        struct stat info;
+
+        fd = open(path, backing == MACHINE_SHARED ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+        if (fd < 0 || fstat(fd, &info) != 0) {
+            perror(path);
+            goto fail;
+        }
+
+        if ((size_t)info.st_size == dataSize) {
+            resume = 1;
+        } else if (info.st_size == 0 && backing == MACHINE_SHARED) {
+            // New image: sparse, so untouched memory costs no disk space
+            if (ftruncate(fd, (off_t)dataSize) != 0) {
+                perror(path);
+                goto fail;
+            }
+        } else {
+            fprintf(stderr, "%s is not a machine image\n", path);
+            goto fail;
+        }
+
+        // A private view is copy-on-write: the image file is never written
+        data = mmap(base + page, dataSize, PROT_READ | PROT_WRITE,
+                    (backing == MACHINE_SHARED ? MAP_SHARED : MAP_PRIVATE) | MAP_FIXED, fd, 0);
+    }
+
+    if (data == MAP_FAILED) {
+        perror("Cannot map guest memory");
+        goto fail;
+    }
+
+    pccore->map.base = base;
+    pccore->map.size = size;
+    pccore->map.data_size = dataSize;
+    pccore->map.fd = fd;
+    pccore->map.shared = backing == MACHINE_SHARED;
+    placeMachine(pccore, data);
+
+    if (!resume) {
+        return 0;
+    }
+
+    if (!restoreMachineState(pccore)) {
+        // Created but never saved: start fresh
+        if (backing == MACHINE_PRIVATE) {
+            fprintf(stderr, "%s was never saved\n", path);
+            freeMachine(pccore);
+            return -1;
+        }
+        memset(data, 0, dataSize);
+        return 0;
+    }
+    return 1;
+
+fail:
+    if (fd >= 0) {
+        close(fd);
+    }
+    munmap(base, size);
+    return -1;
+}
+
+int saveMachine(PCCORE* pccore) {
+    if (!pccore->map.shared) {
+        return -1;
+    }
+
+    recordMachineState(pccore);
+
+    // Memory is already in the file; only dirty pages are written out
+    if (msync(pccore->memory, pccore->map.data_size, MS_SYNC) != 0) {
+        perror("Cannot save machine image");
+        return -1;
+    }
+    return 0;
+}
+
+void freeMachine(PCCORE* pccore) {
+    if (pccore->map.base != NULL) {
+        munmap(pccore->map.base, pccore->map.size);
+    }
+    if (pccore->map.fd >= 0) {
+        close(pccore->map.fd);
+    }
+    memset(&pccore->map, 0, sizeof(MACHINEMAP));
+    pccore->map.fd = -1;
+    pccore->memory = NULL;
+    pccore->port = NULL;
+}
+
+#endif
+
+int initMachineFromEnv(PCCORE* pccore) {
+    const char* image = getenv("PCCORE_IMAGE");
+    const char* resume = getenv("PCCORE_RESUME");
+
+    if (image != NULL) {
+        return initMachine(pccore, MACHINE_SHARED, image);
+    }
+    if (resume != NULL) {
+        return initMachine(pccore, MACHINE_PRIVATE, resume);
+    }
+    return initMachine(pccore, MACHINE_ANONYMOUS, NULL);
+}
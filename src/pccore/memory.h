@@ -0,0 +1,87 @@
+/*
+ * memory.h
+ *
+ * Guest memory, I/O ports and device state in one page-aligned mapping.
+ *
+ * Layout (every part a whole number of pages):
+ *
+ *   [guard page][memory PCCORE_MEMORY_SIZE][ports PCCORE_PORT_SIZE][MACHINESTATE][guard page]
+ *
+ * The guard pages are PROT_NONE, so running off either end of the
+ * machine (a bad MK_FP or a runaway pointer) faults at once instead of
+ * corrupting the host heap.
+ *
+ * Everything between the guard pages can be backed by an image file:
+ *
+ *   MACHINE_ANONYMOUS  Private zero-filled memory (the default)
+ *   MACHINE_SHARED     The file is the machine: every write lands in it,
+ *                      saveMachine() only records the device state and
+ *                      msyncs. The file is created if it does not exist.
+ *   MACHINE_PRIVATE    Copy-on-write view of a saved image: resumes in
+ *                      the time of one mmap, and the image is never
+ *                      modified, so many sessions can start from it.
+ *
+ * On Windows the region is allocated with calloc (no guards, no images).
+ */
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include "pccore.h"
+
+#define PCCORE_IMAGE_MAGIC "PCCORE\0\1"
+#define PCCORE_IMAGE_VERSION 3 // 2: 0x3D8 selects the video mode, 3: CRTC registers
+
+/**
+ * @brief How the machine is backed.
+ */
+typedef enum {
+    MACHINE_ANONYMOUS,
+    MACHINE_SHARED,
+    MACHINE_PRIVATE
+} MACHINEBACKING;
+
+/**
+ * @brief Maps memory, ports and device state for a zeroed PCCORE.
+ *
+ * @param pccore  The core; memory, port and map are set.
+ * @param backing How the machine is backed.
+ * @param path    Image file for MACHINE_SHARED / MACHINE_PRIVATE.
+ * @return 1 if a saved image was resumed (pccore->mode and the device
+ *         state are restored), 0 for a fresh machine, -1 on error.
+ */
+int initMachine(PCCORE* pccore, MACHINEBACKING backing, const char* path);
+
+/**
+ * @brief Chooses the backing from the environment: PCCORE_IMAGE=file
+ * for MACHINE_SHARED, PCCORE_RESUME=file for MACHINE_PRIVATE.
+ */
+int initMachineFromEnv(PCCORE* pccore);
+
+/**
+ * @brief Records the device state and flushes a MACHINE_SHARED image.
+ *
+ * Memory is captured as it is at the time of the call; call it while
+ * the DOS thread is idle (in delay() or finished) for a consistent image.
+ *
+ * @return 0 on success, -1 on error or if there is no image to write.
+ */
+int saveMachine(PCCORE* pccore);
+
+/**
+ * @brief Copies the device state (mode, blink, time, CRTC) into MACHINESTATE.
+ */
+void recordMachineState(PCCORE* pccore);
+
+/**
+ * @brief Restores the device state from a valid MACHINESTATE.
+ * @return 1 if restored, 0 if the state was never recorded.
+ */
+int restoreMachineState(PCCORE* pccore);
+
+/**
+ * @brief Unmaps the machine and closes the image file.
+ */
+void freeMachine(PCCORE* pccore);
+
+#endif // MEMORY_H
@@ -0,0 +1,129 @@
+#include "mouse.h"
+
+// Default graphics cursor of the Microsoft driver: an arrow with its
+// hot spot at the tip. Screen mask (AND) and cursor mask (XOR), bit 15
+// is the leftmost pixel.
+static const unsigned short arrowScreenMask[16] = {
+    0x3FFF, 0x1FFF, 0x0FFF, 0x07FF, 0x03FF, 0x01FF, 0x00FF, 0x007F,
+    0x003F, 0x001F, 0x01FF, 0x10FF, 0x30FF, 0xF87F, 0xF87F, 0xFC3F
+};
+static const unsigned short arrowCursorMask[16] = {
+    0x0000, 0x4000, 0x6000, 0x7000, 0x7800, 0x7C00, 0x7E00, 0x7F00,
+    0x7F80, 0x7FC0, 0x7C00, 0x4600, 0x0600, 0x0300, 0x0300, 0x0180
+};
+
+/*
+ * publish - Replaces the pointer state; bumps the update count.
+ */
+static void publish(PCCORE* pccore, int x, int y, unsigned buttons) {
+    unsigned long long host = __atomic_load_n(&pccore->mouse.host, __ATOMIC_RELAXED);
+    unsigned long long updates = (MOUSE_HOST_UPDATES(host) + 1) & 0xFFFFFF;
+
+    host = (unsigned long long)(x & 0xFFFF) | ((unsigned long long)(y & 0xFFFF) << 16) |
+           ((unsigned long long)(buttons & 0xFF) << 32) | (updates << 40);
+    __atomic_store_n(&pccore->mouse.host, host, __ATOMIC_RELEASE);
+}
+
+void moveMouse(PCCORE* pccore, int x, int y) {
+    unsigned long long host = __atomic_load_n(&pccore->mouse.host, __ATOMIC_RELAXED);
+
+    if (x != MOUSE_HOST_X(host) || y != MOUSE_HOST_Y(host)) {
+        publish(pccore, x, y, MOUSE_HOST_BUTTONS(host));
+    }
+}
+
+void moveMouseOnImage(PCCORE* pccore, int x, int y, int width, int height) {
+    int activeWidth = width - 2 * MOUSE_IMAGE_BORDER;
+    int activeHeight = height - 2 * MOUSE_IMAGE_BORDER;
+
+    if (activeWidth <= 0 || activeHeight <= 0) {
+        return;
+    }
+    // Outside the active area the driver's limits take over
+    x = (x - MOUSE_IMAGE_BORDER) * MOUSE_WIDTH / activeWidth;
+    y = (y - MOUSE_IMAGE_BORDER) * MOUSE_HEIGHT / activeHeight;
+    moveMouse(pccore, x < -32768 ? -32768 : x > 32767 ? 32767 : x,
+              y < -32768 ? -32768 : y > 32767 ? 32767 : y);
+}
+
+void setMouseButton(PCCORE* pccore, int button, int down) {
+    unsigned long long host = __atomic_load_n(&pccore->mouse.host, __ATOMIC_RELAXED);
+    unsigned buttons = MOUSE_HOST_BUTTONS(host);
+    unsigned bit = 1u << button;
+
+    if (button < 0 || button >= MOUSE_BUTTONS || ((buttons & bit) != 0) == (down != 0)) {
+        return;
+    }
+    // Count first: whoever sees the new buttons also sees the count
+    if (down) {
+        __atomic_add_fetch(&pccore->mouse.presses[button], 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_add_fetch(&pccore->mouse.releases[button], 1, __ATOMIC_RELAXED);
+    }
+    publish(pccore, MOUSE_HOST_X(host), MOUSE_HOST_Y(host), down ? buttons | bit : buttons & ~bit);
+}
+
+void mousePosition(const PCCORE* pccore, unsigned long long host, int* x, int* y) {
+    const MOUSESTATE* mouse = &pccore->mouse;
+    int px = MOUSE_HOST_X(host) + __atomic_load_n(&mouse->offset_x, __ATOMIC_RELAXED);
+    int py = MOUSE_HOST_Y(host) + __atomic_load_n(&mouse->offset_y, __ATOMIC_RELAXED);
+    int minX = __atomic_load_n(&mouse->min_x, __ATOMIC_RELAXED);
+    int maxX = __atomic_load_n(&mouse->max_x, __ATOMIC_RELAXED);
+    int minY = __atomic_load_n(&mouse->min_y, __ATOMIC_RELAXED);
+    int maxY = __atomic_load_n(&mouse->max_y, __ATOMIC_RELAXED);
+
+    *x = px < minX ? minX : px > maxX ? maxX : px;
+    *y = py < minY ? minY : py > maxY ? maxY : py;
+}
+
+int mouseCursor(const PCCORE* pccore, int* x, int* y) {
+    if (!__atomic_load_n(&pccore->mouse.reset, __ATOMIC_ACQUIRE) ||
+        __atomic_load_n(&pccore->mouse.cursor, __ATOMIC_RELAXED) != 0) {
+        return 0;
+    }
+    mousePosition(pccore, __atomic_load_n(&pccore->mouse.host, __ATOMIC_ACQUIRE), x, y);
+    return 1;
+}
+
+void drawMouseCursor(IMAGE* image, const VIDEOSNAPSHOT* video) {
+    int activeWidth = image->width - 2 * MOUSE_IMAGE_BORDER;
+    int activeHeight = image->height - 2 * MOUSE_IMAGE_BORDER;
+    int left, top, width, height, row, column, i;
+
+    // Limits may reach past the screen; nothing to draw there
+    if (!video->mouse_visible || activeWidth <= 0 || activeHeight <= 0 ||
+        video->mouse_x < 0 || video->mouse_y < 0 ||
+        video->mouse_x >= MOUSE_WIDTH || video->mouse_y >= MOUSE_HEIGHT) {
+        return;
+    }
+
+    if (video->mode == CGA80x25 || video->mode == CGA40x25) {
+        // Text: the character cell under the cursor, colors inverted
+        int columns = video->mode == CGA80x25 ? 80 : 40;
+        width = activeWidth / columns;
+        height = activeHeight / 25;
+        left = MOUSE_IMAGE_BORDER + video->mouse_x / (MOUSE_WIDTH / columns) * width;
+        top = MOUSE_IMAGE_BORDER + video->mouse_y / (MOUSE_HEIGHT / 25) * height;
+        for (row = top; row < top + height && row < image->height; row++) {
+            unsigned char* pixel = image->raw + ((size_t)row * image->width + left) * 3;
+            for (i = 0; i < width * 3; i++) {
+                pixel[i] = (unsigned char)~pixel[i];
+            }
+        }
+        return;
+    }
+
+    // Graphics: the arrow, one mask bit per screen pixel
+    left = MOUSE_IMAGE_BORDER + video->mouse_x * activeWidth / MOUSE_WIDTH;
+    top = MOUSE_IMAGE_BORDER + video->mouse_y * activeHeight / MOUSE_HEIGHT;
+    for (row = 0; row < 16 && top + row < image->height; row++) {
+        for (column = 0; column < 16 && left + column < image->width; column++) {
+            unsigned char* pixel = image->raw + ((size_t)(top + row) * image->width + left + column) * 3;
+            int keep = (arrowScreenMask[row] >> (15 - column)) & 1;
+            int invert = (arrowCursorMask[row] >> (15 - column)) & 1;
+            for (i = 0; i < 3; i++) {
+                pixel[i] = (unsigned char)((keep ? pixel[i] : 0) ^ (invert ? 0xFF : 0));
+            }
+        }
+    }
+}
@@ -0,0 +1,77 @@
+/*
+ * mouse.h
+ *
+ * The mouse as the wrappers see it: pointer motion and buttons go into
+ * pccore.mouse.host, one 64-bit word replaced with a single atomic store,
+ * so motion coalesces and the DOS thread reads the newest state with one
+ * atomic load, however many events arrived. Presses and releases are
+ * also counted per button, so a click between two reads is not lost.
+ *
+ * Positions are in mouse coordinates, 640x200 in every CGA mode, as the
+ * INT 33h driver (int33.h) reports them. The pointer maps onto the
+ * screen absolutely; the driver adds its own offset and limits.
+ *
+ * The cursor is not drawn into video RAM: takeSnapshot records where it
+ * is (mouseCursor) and renderSnapshot draws it over the picture, so the
+ * program never has to hide it around its own drawing.
+ */
+
+#ifndef MOUSE_H
+#define MOUSE_H
+
+#include "pccore.h"
+
+#define MOUSE_WIDTH 640
+#define MOUSE_HEIGHT 200
+
+// Border renderSnapshot puts around the active area (see cga.c)
+#define MOUSE_IMAGE_BORDER 16
+
+// Button bits (BX of INT 33h AX=03h)
+#define MOUSE_LEFT 0x01
+#define MOUSE_RIGHT 0x02
+#define MOUSE_MIDDLE 0x04
+
+// Fields of pccore.mouse.host
+#define MOUSE_HOST_X(host) ((int)(short)((host) & 0xFFFF))
+#define MOUSE_HOST_Y(host) ((int)(short)(((host) >> 16) & 0xFFFF))
+#define MOUSE_HOST_BUTTONS(host) ((unsigned)(((host) >> 32) & 0xFF))
+#define MOUSE_HOST_UPDATES(host) ((unsigned)((host) >> 40))
+
+/**
+ * @brief Moves the pointer to (x, y) in mouse coordinates. Input thread.
+ */
+void moveMouse(PCCORE* pccore, int x, int y);
+
+/**
+ * @brief Moves the pointer to pixel (x, y) of a rendered image of
+ * 'width' x 'height' pixels, border included. Input thread.
+ */
+void moveMouseOnImage(PCCORE* pccore, int x, int y, int width, int height);
+
+/**
+ * @brief Presses ('down' = 1) or releases a button: 0 left, 1 right,
+ * 2 middle. Input thread.
+ */
+void setMouseButton(PCCORE* pccore, int button, int down);
+
+/**
+ * @brief Where the driver puts the cursor for the pointer state 'host':
+ * the pointer plus the driver's offset, within its limits.
+ */
+void mousePosition(const PCCORE* pccore, unsigned long long host, int* x, int* y);
+
+/**
+ * @brief Where the cursor is drawn (render thread).
+ * @return 1 if it is shown, 0 if hidden ('x' and 'y' then untouched).
+ */
+int mouseCursor(const PCCORE* pccore, int* x, int* y);
+
+/**
+ * @brief Draws the snapshot's cursor over a rendered image: the arrow
+ * of the default graphics cursor, or an inverted character cell in text
+ * modes.
+ */
+void drawMouseCursor(IMAGE* image, const VIDEOSNAPSHOT* video);
+
+#endif // MOUSE_H
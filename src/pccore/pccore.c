@@ -1,63 +1,295 @@
 #include "pccore.h" // For IMAGE, PCCORE, VIDEOMODE, and render() prototype
 #include "cga.h"    // For render320x200x2 and render640x200x1 prototypes
+#include "mouse.h"  // For the cursor overlay
 
 #include <stdio.h> // For placeholder debug messages
+#include <string.h> // For memcpy, memcmp
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// The machine each thread runs (see bindPCCore)
+static __thread PCCORE* boundPCCore = NULL;
+
+/**
+ * @brief Monotonic clock in nanoseconds, used for snapshot timing.
+ */
+static unsigned long long monotonicNanos(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (unsigned long long)(count.QuadPart * (1000000000.0 / freq.QuadPart));
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/**
+ * @brief Copies VRAM and the video registers from the live core.
+ */
+static void copyVideo(const PCCORE* pccore, VIDEOSNAPSHOT* video) {
+    memcpy(video->vram, &pccore->memory[PCCORE_VRAM_START], PCCORE_VRAM_SIZE);
+    video->mode_reg = pccore->port[CGA_MODE_CONTROL_PORT];
+    video->color_reg = pccore->port[CGA_COLOR_REGISTER_PORT];
+    video->mode = pccore->mode;
+    video->cga = pccore->cga;
+    video->blink = pccore->blink;
+    video->mouse_visible = mouseCursor(pccore, &video->mouse_x, &video->mouse_y);
+}
+
+static int sameVideo(const VIDEOSNAPSHOT* a, const VIDEOSNAPSHOT* b) {
+    return a->mode == b->mode &&
+           a->mode_reg == b->mode_reg &&
+           a->color_reg == b->color_reg &&
+           memcmp(&a->cga, &b->cga, sizeof(CGASTATE)) == 0 &&
+           memcmp(a->vram, b->vram, PCCORE_VRAM_SIZE) == 0;
+}
+
+int takeSnapshot(PCCORE* pccore) {
+    // Two scratch copies: the current attempt and the previous one
+    VIDEOSNAPSHOT* scratch = pccore->snapshot_scratch;
+    SNAPSHOTSTATS* stats = &pccore->snapshot_stats;
+    unsigned long long start = monotonicNanos();
+    int attempt;
+    int found = -1;
+    int result = 1;
+
+    for (attempt = 0; attempt < SNAPSHOT_MAX_RETRIES; attempt++) {
+        VIDEOSNAPSHOT* copy = &scratch[attempt & 1];
+
+        // Once two copies differed, the DOS thread is actively writing:
+        // give it a short while to reach an idle point
+        unsigned int before = __atomic_load_n(&pccore->seq, __ATOMIC_ACQUIRE);
+        while (attempt > 1 && (before & 1) &&
+               monotonicNanos() - start < SNAPSHOT_WAIT_NS) {
+            before = __atomic_load_n(&pccore->seq, __ATOMIC_ACQUIRE);
+        }
+
+        copyVideo(pccore, copy);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        unsigned int after = __atomic_load_n(&pccore->seq, __ATOMIC_RELAXED);
+
+        // DOS thread idle for the whole copy: consistent
+        if ((before & 1) == 0 && before == after) {
+            stats->idle++;
+            found = attempt & 1;
+            break;
+        }
+
+        // DOS thread never went idle, but nothing moved between two copies.
+        // This is best effort: a descheduled writer also looks stable.
+        if (attempt > 0 && sameVideo(&scratch[0], &scratch[1])) {
+            stats->stable++;
+            found = attempt & 1;
+            break;
+        }
+
+        if (attempt > 0) {
+            stats->retries++;
+        }
+    }
+
+    stats->frames++;
+
+    if (found < 0) {
+        stats->torn++;
+        // Never freeze the picture for good if the program writes non-stop
+        if (++pccore->snapshot_stale < SNAPSHOT_MAX_STALE) {
+            stats->nanos += monotonicNanos() - start;
+            return 0;
+        }
+        found = (attempt - 1) & 1;
+        result = 2;
+    }
+
+    pccore->snapshot_stale = 0;
+    memcpy(&pccore->snapshot, &scratch[found], sizeof(VIDEOSNAPSHOT));
+    stats->nanos += monotonicNanos() - start;
+    return result;
+}
+
+void beginVideoUpdate(PCCORE* pccore) {
+    // Odd first, then look for a pause: pauseMachine sets 'pause' first,
+    // then looks at 'seq', so one of the two always sees the other
+    for (;;) {
+        __atomic_add_fetch(&pccore->seq, 1, __ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&pccore->pause, __ATOMIC_SEQ_CST)) {
+            return;
+        }
+        // Paused: back to idle until resumeMachine
+        __atomic_add_fetch(&pccore->seq, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&pccore->pause, __ATOMIC_ACQUIRE)) {
+        }
+    }
+}
+
+int pauseMachine(PCCORE* pccore, unsigned long long timeout_ns) {
+    unsigned long long start = monotonicNanos();
+
+    __atomic_store_n(&pccore->pause, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&pccore->seq, __ATOMIC_SEQ_CST) & 1) {
+        if (monotonicNanos() - start >= timeout_ns) {
+            resumeMachine(pccore);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void resumeMachine(PCCORE* pccore) {
+    __atomic_store_n(&pccore->pause, 0, __ATOMIC_RELEASE);
+}
+
+void endVideoUpdate(PCCORE* pccore) {
+    __atomic_add_fetch(&pccore->seq, 1, __ATOMIC_RELEASE);
+    notifyVideoChange(pccore);
+}
+
+void setVideoListener(PCCORE* pccore, VIDEOLISTENER listener) {
+    __atomic_store_n(&pccore->video_listener, listener, __ATOMIC_RELEASE);
+}
+
+void notifyVideoChange(PCCORE* pccore) {
+    VIDEOLISTENER listener = __atomic_load_n(&pccore->video_listener, __ATOMIC_ACQUIRE);
+    if (listener != NULL && !__atomic_exchange_n(&pccore->video_changed, 1, __ATOMIC_ACQ_REL)) {
+        listener(pccore);
+    }
+}
+
+int consumeVideoChange(PCCORE* pccore) {
+    return __atomic_exchange_n(&pccore->video_changed, 0, __ATOMIC_ACQ_REL);
+}
+
+void startMachineClock(PCCORE* pccore) {
+    MACHINECLOCK* clock = &pccore->clock;
+#ifdef _WIN32
+    FILETIME now;
+    TIME_ZONE_INFORMATION zone;
+    ULARGE_INTEGER ticks;
+    DWORD daylight = GetTimeZoneInformation(&zone);
+
+    // 100 ns units since 1601
+    GetSystemTimeAsFileTime(&now);
+    ticks.LowPart = now.dwLowDateTime;
+    ticks.HighPart = now.dwHighDateTime;
+    clock->wall_ms = (long long)(ticks.QuadPart / 10000ULL) - 11644473600000LL;
+    clock->local_offset_ms = -60000LL * (zone.Bias + (daylight == TIME_ZONE_ID_DAYLIGHT ? zone.DaylightBias : 0));
+#else
+    struct timespec now;
+    struct tm local;
+    time_t seconds;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    clock->wall_ms = (long long)now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+    seconds = now.tv_sec;
+    localtime_r(&seconds, &local);
+    clock->local_offset_ms = (long long)local.tm_gmtoff * 1000LL;
+#endif
+    clock->mono_ns = monotonicNanos();
+    __atomic_store_n(&pccore->time, clock->wall_ms, __ATOMIC_RELAXED);
+}
+
+long long updateMachineClock(PCCORE* pccore) {
+    long long now = pccore->clock.wall_ms +
+                    (long long)((monotonicNanos() - pccore->clock.mono_ns) / 1000000ULL);
+    __atomic_store_n(&pccore->time, now, __ATOMIC_RELAXED);
+    return now;
+}
+
+void bindPCCore(PCCORE* pccore) {
+    boundPCCore = pccore;
+}
+
+PCCORE* currentPCCore(void) {
+    return boundPCCore;
+}
+
+void printSnapshotStats(const PCCORE* pccore) {
+    const SNAPSHOTSTATS* stats = &pccore->snapshot_stats;
+    if (stats->frames == 0) {
+        return;
+    }
+    printf("Snapshots: %lu frames, %lu idle, %lu stable, %lu retries, %lu torn\n",
+           stats->frames, stats->idle, stats->stable, stats->retries, stats->torn);
+    printf("Snapshot cost: %.2f us/frame\n",
+           (double)stats->nanos / stats->frames / 1000.0);
+}
 
 /**
  * @brief Renders the PC core's memory into an image buffer.
  *
- * This function reads the state of the PC (especially its video memory,
- * based on the current 'mode') and renders the corresponding
- * graphical output into the provided IMAGE structure.
+ * Takes a consistent snapshot of the video state and renders it.
+ * If the snapshot is torn, the previous snapshot is rendered again.
+ *
+ * @param image  A pointer to the IMAGE structure to be filled with
+ * pixel data.
+ * @param pccore The PC core to render from.
+ */
+void render(IMAGE* image, PCCORE* pccore) {
+    if (image == NULL || pccore == NULL) {
+        return; // Safety check: do nothing if image is null
+    }
+
+    takeSnapshot(pccore);
+    renderSnapshot(image, &pccore->snapshot);
+}
+
+/**
+ * @brief Renders a video snapshot into an image buffer.
  *
  * This implementation acts as a dispatcher, calling the
- * appropriate rendering function based on the current video mode.
+ * appropriate rendering function based on the snapshot video mode.
  *
- * @param image  A pointer to the IMAGE structure to be filled with
+ * @param image A pointer to the IMAGE structure to be filled with
  * pixel data.
- * @param pccore The current state of the PC core to render from.
- * (Passed by value as per pccore.h)
+ * @param video The snapshot to render from.
  */
-void render(IMAGE* image, PCCORE pccore) {
+void renderSnapshot(IMAGE* image, const VIDEOSNAPSHOT* video) {
     if (image == NULL) {
         return; // Safety check: do nothing if image is null
     }
 
     // Dispatch to the correct rendering function based on the mode.
-    // We pass a pointer to pccore to the sub-functions
-    // to avoid copying the large struct again.
-    switch (pccore.mode) {
+    switch (video->mode) {
         case CGA320x200x2:
             // Call the specific function for 320x200x2 mode
-            render320x200x2(image, pccore);
+            render320x200x2(image, video);
             break;
 
         case CGA320x200x2g:
             // Call the specific function for 320x200x2 gray mode
-            render320x200x2g(image, pccore);
+            render320x200x2g(image, video);
             break;
 
         case CGA640x200x1:
             // Call the specific function for 640x200x1 mode
-            render640x200x1(image, pccore);
+            render640x200x1(image, video);
             break;
 
         case CGA80x25:
             // Call the specific function for 640x200x1 mode
-            render80x25(image, pccore);
+            render80x25(image, video);
             break;
 
         case CGA40x25:
             // Call the specific function for 640x200x1 mode
-            render40x25(image, pccore);
+            render40x25(image, video);
             break;
 
         default:
             // Handle unknown or unsupported mode
             // We can clear the image or just log an error.
-            printf("Unknown video mode requested: %d\n", pccore.mode);
+            printf("Unknown video mode requested: %d\n", video->mode);
             image->width = 0;
             image->height = 0;
-            break;
+            return;
     }
+
+    drawMouseCursor(image, video);
 }
@@ -7,6 +7,8 @@
 
 #include "bda.h"
 
+#include <stddef.h>
+
 // Header guard to prevent multiple inclusions
 #ifndef PCCORE_H
 #define PCCORE_H
@@ -15,8 +17,27 @@
 
 // Define buffer sizes for clarity
 #define IMAGE_RAW_BUFFER_SIZE (640 * 480 * 3 * 2)
-#define PCCORE_MEMORY_SIZE (1000 * 1000)
-#define PCCORE_PORT_SIZE 65535
+// Guest memory covers every address MK_FP can form (FFFF:FFFF = 0x10FFEF),
+// ports the full 16-bit I/O space. Both are whole pages (see memory.h).
+#define PCCORE_MEMORY_SIZE 0x110000
+#define PCCORE_PORT_SIZE 0x10000
+
+// CGA video RAM window captured by each snapshot (both 8 KB banks)
+#define PCCORE_VRAM_START 0xB8000
+#define PCCORE_VRAM_SIZE 0x4000
+
+// Ports that can have device handlers (iobus.h): the ISA decodes 10 bits
+#define PCCORE_BUS_PORTS 0x400
+
+// Registers R0-R17 of the 6845 CRT controller
+#define PCCORE_CRTC_REGISTERS 18
+
+// Snapshot attempts per frame before the previous image is kept, the
+// number of consecutive torn frames after which the latest copy is shown
+// anyway, and how long the renderer may wait for the DOS thread to go idle
+#define SNAPSHOT_MAX_RETRIES 4
+#define SNAPSHOT_MAX_STALE 8
+#define SNAPSHOT_WAIT_NS 500000
 
 // --- Enumerations ---
 
@@ -53,47 +74,442 @@ typedef struct {
     float aspect_ratio; // Pixel or display aspect ratio
 } IMAGE;
 
+// Helper structure for a simple 24-bit RGB color
+typedef struct {
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+} RgbColor;
+
+/**
+ * @brief Video state derived from the CGA registers.
+ *
+ * Decoded by the 0x3D8/0x3D9 port handlers when a register is written
+ * (see attachCga in cga.h), so the renderers only look colors up.
+ */
+typedef struct {
+    int blink_enabled;          // 3D8 bit 5: attribute bit 7 blinks instead of bright background
+    int grayscale;              // 3D8 bit 2: color burst off
+    RgbColor border;            // Border color
+    // Text modes: the 16 attribute colors. 320x200: pixel values 0-3.
+    // 640x200: pixel values 0-1. All black while the video signal is off.
+    RgbColor palette[16];
+    // Text modes: VRAM byte offset of the top left cell, from the CRTC
+    // start address (registers 0Ch/0Dh); the screen wraps at 16 KB
+    unsigned int start;
+} CGASTATE;
+
+/**
+ * @brief A consistent copy of the video state.
+ *
+ * Taken by the render thread at the start of every frame so the
+ * renderers never see VRAM half-way through a DOS-side update.
+ */
+typedef struct {
+    // Copy of the CGA video RAM (0xB8000 - 0xBBFFF)
+    unsigned char vram[PCCORE_VRAM_SIZE];
+
+    // Mode Control Register (0x3D8)
+    unsigned char mode_reg;
+
+    // Color Select Register (0x3D9)
+    unsigned char color_reg;
+
+    // Video mode at the time of the snapshot
+    VIDEOMODE mode;
+
+    // Colors decoded from the registers above
+    CGASTATE cga;
+
+    // Blink phase at the time of the snapshot
+    int blink;
+
+    // Mouse cursor (INT 33h), drawn over the picture by renderSnapshot
+    int mouse_visible;
+    int mouse_x, mouse_y;       // 640x200 mouse coordinates
+} VIDEOSNAPSHOT;
+
+/**
+ * @brief Counters describing how snapshots were obtained.
+ */
+typedef struct {
+    unsigned long frames;       // Snapshots requested
+    unsigned long idle;         // Consistent on the first copy (DOS thread idle)
+    unsigned long stable;       // DOS thread busy, but two copies matched
+    unsigned long retries;      // Extra copies taken
+    unsigned long torn;         // No stable copy found in SNAPSHOT_MAX_RETRIES
+    unsigned long long nanos;   // Total time spent taking snapshots
+} SNAPSHOTSTATS;
+
+/**
+ * @brief Device state kept in the mapping next to memory and ports, so a
+ * file-backed machine can be resumed from its image (see memory.h).
+ */
+typedef struct {
+    char magic[8];              // PCCORE_IMAGE_MAGIC once saved
+    unsigned int version;       // PCCORE_IMAGE_VERSION
+    unsigned int memory_size;   // PCCORE_MEMORY_SIZE
+    unsigned int port_size;     // PCCORE_PORT_SIZE
+    VIDEOMODE mode;             // pccore.mode at the last save
+    int blink;                  // pccore.blink at the last save
+    long long time;             // pccore.time at the last save
+    unsigned char crtc[PCCORE_CRTC_REGISTERS]; // pccore.crtc at the last save
+} MACHINESTATE;
+
+/**
+ * @brief The page-aligned region holding memory, ports and MACHINESTATE.
+ */
+typedef struct {
+    unsigned char* base;        // Start of the mapping (a guard page)
+    size_t size;                // Whole mapping, guard pages included
+    size_t data_size;           // Memory, ports and state (between the guards)
+    int fd;                     // Image file, -1 if anonymous
+    int shared;                 // Writes go to the image file
+    MACHINESTATE* state;
+} MACHINEMAP;
+
+/**
+ * @brief Text window of the Turbo C console functions (conio.c), in
+ * 0-based screen coordinates.
+ */
+typedef struct {
+    unsigned char left, top, right, bottom;
+    unsigned char attribute;    // Used by putch, cputs, cprintf, clrscr...
+    unsigned char columns;      // Screen width it was set for, 0 = not yet
+} TEXTWINDOW;
+
+/**
+ * @brief State of the Turbo C graphics library (graphics.c). Positions
+ * are screen coordinates; the viewport is inclusive.
+ */
+typedef struct {
+    int active;                 // Between initgraph and closegraph
+    int driver, mode;           // BGI driver and mode (CGA, CGAC0..CGAHI)
+    int result;                 // Returned and reset by graphresult
+    int text_mode;              // BIOS mode closegraph goes back to
+    int color, bkcolor;
+    int x, y;                   // Current position, viewport-relative
+    int vp_left, vp_top, vp_right, vp_bottom, vp_clip;
+    int line_style, thickness;
+    unsigned short line_pattern;
+    int write_mode;             // COPY_PUT or XOR_PUT, for lines
+    int fill_style, fill_color;
+    unsigned char fill_user[8];     // setfillpattern's pattern
+    unsigned short fill_rows[8];    // Fill pattern per line (y & 7) for rasterSpan
+} GRAPHSTATE;
+
+/**
+ * @brief The machine's time base (see startMachineClock). Written by the
+ * wrapper before the DOS thread starts, except for the BIOS fields.
+ */
+typedef struct {
+    long long wall_ms;          // Wall clock (Unix milliseconds) at the anchor
+    unsigned long long mono_ns; // Monotonic clock at the anchor
+    long long local_offset_ms;  // Local time minus UTC at the anchor
+    long long bios_adjust_ms;   // Added to the BIOS tick count (INT 1Ah AH=01h)
+    long long bios_day;         // Day of the last tick count read, for the midnight flag
+} MACHINECLOCK;
+
+/**
+ * @brief Mouse event handler (INT 33h AX=0Ch, see int33.h): the condition
+ * bits that occurred, the buttons down and the cursor position.
+ */
+typedef void (*MOUSEHANDLER)(unsigned events, unsigned buttons, int x, int y);
+
+#define MOUSE_BUTTONS 3
+
+/**
+ * @brief The mouse (mouse.h). 'host' is written by the wrapper's input
+ * thread only, the driver fields by the DOS thread only; the renderer
+ * reads both with atomic loads.
+ */
+typedef struct {
+    // Pointer x and y (16 bits each, 640x200 mouse coordinates), buttons
+    // (8 bits) and an update count (24 bits), replaced as a whole
+    unsigned long long host;
+    unsigned int presses[MOUSE_BUTTONS];    // Counts per button: left, right, middle
+    unsigned int releases[MOUSE_BUTTONS];
+
+    // Driver state (int33.c)
+    int reset;                  // AX=00h has run
+    int cursor;                 // Shown when 0 (AX=01h/02h)
+    int offset_x, offset_y;     // Cursor position minus pointer position (AX=04h)
+    int min_x, max_x, min_y, max_y;
+    int mickey_x, mickey_y;     // Pointer at the last AX=0Bh
+    unsigned int call_mask;     // AX=0Ch
+    MOUSEHANDLER handler;
+    unsigned long long handler_host;        // 'host' at the last handler call
+    unsigned int handler_presses[MOUSE_BUTTONS];
+    unsigned int handler_releases[MOUSE_BUTTONS];
+} MOUSESTATE;
+
+// DOS file handles per machine (FILES=20), the first five being the
+// standard devices
+#define DOS_FILES 20
+
+/**
+ * @brief A DOS file handle (int21.c) and the host file behind it.
+ */
+typedef struct {
+    int open;                   // Handle in use
+    int fd;                     // Host descriptor
+    int access;                 // 0 read, 1 write, 2 both (AL of function 3Dh)
+    long long position;         // File pointer
+    const unsigned char* map;   // Whole file mapped (read-only handles), NULL if not
+    long long map_size;
+    unsigned char* buffer;      // Read-ahead for small reads, allocated on first use
+    long long buffer_start;     // File offset of buffer[0]
+    int buffer_length;          // Valid bytes, 0 = empty
+} DOSFILE;
+
+typedef struct PCCORE PCCORE;
+typedef struct SPEAKER SPEAKER;
+
+/**
+ * @brief An interrupt handler (setvect, see dos.h): a native function
+ * working on the whole register set, in place.
+ */
+struct REGPACK;
+typedef void (*INTERRUPTHANDLER)(struct REGPACK* regs);
+
+/**
+ * @brief Called on the DOS thread when the video state of 'pccore' may
+ * have changed.
+ */
+typedef void (*VIDEOLISTENER)(PCCORE* pccore);
+
+/**
+ * @brief Returns the value a device presents on 'port' (iobus.h).
+ */
+typedef unsigned char (*PORTREADER)(PCCORE* pccore, unsigned int port);
+
+/**
+ * @brief Reacts to a byte written to 'port' (already in pccore->port[]).
+ */
+typedef void (*PORTWRITER)(PCCORE* pccore, unsigned int port, unsigned char value);
+
+/**
+ * @brief A machine's port handlers, one entry per port. NULL (the
+ * default) means plain memory. Only the 10-bit ISA range can have
+ * handlers; the ports above it are always plain memory.
+ */
+typedef struct {
+    PORTREADER readers[PCCORE_BUS_PORTS];
+    PORTWRITER writers[PCCORE_BUS_PORTS];
+} PORTBUS;
+
 /**
  * @brief Represents the core state of a PC.
  *
  * This structure holds the main memory, I/O port state,
- * and current operating modes.
+ * and current operating modes. A process can run any number of them;
+ * the Turbo C functions work on the one bound to the calling thread
+ * (see bindPCCore).
  */
-typedef struct {
-    // Main system memory
-    unsigned char memory[PCCORE_MEMORY_SIZE];
+struct PCCORE {
+    // Main system memory (PCCORE_MEMORY_SIZE bytes, set up by initMachine)
+    unsigned char* memory;
+
+    // I/O port address space (PCCORE_PORT_SIZE bytes, set up by initMachine)
+    unsigned char* port;
 
-    // I/O port address space
-    unsigned char port[PCCORE_PORT_SIZE];
+    // Where memory and port live
+    MACHINEMAP map;
 
-    // Current video mode. See the VIDEOMODE enum.
+    // Device handlers of this machine's ports (iobus.h)
+    PORTBUS bus;
+
+    // Current video mode, decoded from 0x3D8. See the VIDEOMODE enum.
     VIDEOMODE mode;
 
+    // Colors decoded from 0x3D8/0x3D9 on every write
+    CGASTATE cga;
+
+    // 6845 CRTC registers, written through 0x3D4/0x3D5 (cga.c)
+    unsigned char crtc[PCCORE_CRTC_REGISTERS];
+
+    // Console window and attribute (conio.c)
+    TEXTWINDOW text;
+
+    // BGI colors, position, viewport and styles (graphics.c)
+    GRAPHSTATE graph;
+
+    // DOS file handles (int21.c)
+    DOSFILE files[DOS_FILES];
+
+    // PC speaker output (speaker.h), NULL if sound is not recorded
+    SPEAKER* speaker;
+
+    // Mouse pointer and driver (mouse.h, int33.c)
+    MOUSESTATE mouse;
+
+    // Interrupt vectors set with setvect (dos.c), NULL = the built-in handler
+    INTERRUPTHANDLER vectors[256];
+
     // Last key pressed or keyboard state
     int key;
 
     // Blinking status for cursor
     int blink;    
 
-    // Time in millisec
-    long long time;       
-} PCCORE;
+    // Time in millisec: Unix wall clock at the anchor of 'clock' plus the
+    // monotonic time since. Written by updateMachineClock on the wrapper's
+    // timer; the Turbo C time functions only load it.
+    long long time;
+
+    // Time base behind 'time'
+    MACHINECLOCK clock;
+
+    // Video update sequence. Odd while the DOS thread may be writing
+    // VRAM, even while it waits in delay() or has not started yet.
+    unsigned int seq;
+
+    // Set by pauseMachine: the DOS thread waits in beginVideoUpdate
+    // until resumeMachine clears it
+    int pause;
+
+    // Last consistent video snapshot (owned by the render thread)
+    VIDEOSNAPSHOT snapshot;
+
+    // Number of torn frames in a row (owned by the render thread)
+    int snapshot_stale;
+
+    // Snapshot counters (owned by the render thread)
+    SNAPSHOTSTATS snapshot_stats;
+
+    // Scratch copies for takeSnapshot (owned by the render thread)
+    VIDEOSNAPSHOT snapshot_scratch[2];
+
+    // Called by notifyVideoChange, and whether a change is pending
+    VIDEOLISTENER video_listener;
+    int video_changed;
+};
 
 // --- Function Prototypes ---
 
 /**
  * @brief Renders the PC core's memory into an image buffer.
  *
- * This function reads the state of the PC (especially its video memory,
- * based on the current 'mode') and renders the corresponding
- * graphical output into the provided IMAGE structure.
+ * This function takes a consistent snapshot of the PC video state
+ * (see takeSnapshot) and renders the corresponding graphical output
+ * into the provided IMAGE structure.
  *
  * @param image  A pointer to the IMAGE structure to be filled with
  * pixel data.
- * @param pccore The current state of the PC core to render from.
+ * @param pccore The PC core to render from.
+ */
+void render(IMAGE* image, PCCORE* pccore);
+
+/**
+ * @brief Renders a previously taken video snapshot into an image buffer.
+ *
+ * @param image A pointer to the IMAGE structure to be filled.
+ * @param video The snapshot to render.
  */
-void render(IMAGE* image, PCCORE pccore);
+void renderSnapshot(IMAGE* image, const VIDEOSNAPSHOT* video);
 
-PCCORE pccore;
+/**
+ * @brief Captures VRAM and the video registers without blocking the DOS thread.
+ *
+ * Works like the reader side of a seqlock: if the DOS thread was idle
+ * (even 'seq') for the whole copy, the copy is consistent. Otherwise a
+ * second copy is taken; if both match, nothing is moving. If they differ,
+ * the renderer waits up to SNAPSHOT_WAIT_NS for an idle window. If that does not
+ * happen within SNAPSHOT_MAX_RETRIES, the frame counts as torn and
+ * pccore->snapshot keeps the previous image.
+ *
+ * pccore->snapshot_stale counts torn frames in a row. The picture is
+ * never frozen for good: on the SNAPSHOT_MAX_STALE-th torn frame the
+ * latest copy is shown anyway, even though it may mix old and new
+ * writes, and the counter starts over.
+ *
+ * @param pccore The PC core to capture.
+ * @return 1 if pccore->snapshot was updated with a consistent copy,
+ * 2 if it was updated with a possibly torn copy after SNAPSHOT_MAX_STALE
+ * torn frames, 0 if the frame was torn and the previous image kept.
+ */
+int takeSnapshot(PCCORE* pccore);
+
+/**
+ * @brief Marks the start of a DOS-side video update (seq becomes odd).
+ * Called on the DOS thread when it resumes after an idle point. While
+ * the machine is paused, waits for resumeMachine first.
+ */
+void beginVideoUpdate(PCCORE* pccore);
+
+/**
+ * @brief Holds the DOS thread at an idle point (even 'seq'), so another
+ * thread can read guest memory and ports as one moment of the program.
+ * Returns at once if the DOS thread is idle or not running, and waits
+ * up to 'timeout_ns' otherwise. One caller at a time.
+ *
+ * @return 1 if the machine is held (call resumeMachine), 0 on timeout.
+ */
+int pauseMachine(PCCORE* pccore, unsigned long long timeout_ns);
+
+/**
+ * @brief Lets a machine held by pauseMachine go on.
+ */
+void resumeMachine(PCCORE* pccore);
+
+/**
+ * @brief Marks the end of a DOS-side video update (seq becomes even).
+ * Called on the DOS thread when it enters an idle point such as delay().
+ */
+void endVideoUpdate(PCCORE* pccore);
+
+/**
+ * @brief Installs the function notifyVideoChange() calls (NULL removes it).
+ */
+void setVideoListener(PCCORE* pccore, VIDEOLISTENER listener);
+
+/**
+ * @brief Reports a possible video change: the end of a DOS-side update,
+ * a mode switch or a CGA register write.
+ *
+ * Edge-triggered: the listener runs only for the first change after the
+ * last consumeVideoChange(), so a program calling delay(1) in a loop
+ * does not wake the renderer a thousand times a second.
+ */
+void notifyVideoChange(PCCORE* pccore);
+
+/**
+ * @brief Clears the pending change. Called by the renderer before it
+ * takes a snapshot.
+ *
+ * @return 1 if a change was reported since the last call.
+ */
+int consumeVideoChange(PCCORE* pccore);
+
+/**
+ * @brief Prints the snapshot counters and the average cost per frame.
+ */
+void printSnapshotStats(const PCCORE* pccore);
+
+/**
+ * @brief Anchors the machine clock: takes the wall clock and the local
+ * time offset once, and sets pccore->time. Call it once, before the DOS
+ * thread starts.
+ */
+void startMachineClock(PCCORE* pccore);
+
+/**
+ * @brief Sets pccore->time from the monotonic clock (one atomic store),
+ * so it never jumps with changes to the wall clock.
+ * @return The new time.
+ */
+long long updateMachineClock(PCCORE* pccore);
+
+/**
+ * @brief Makes 'pccore' the machine the calling thread runs: the one
+ * the Turbo C functions (MK_FP, bioskey, outportb, delay...) work on.
+ * Call it on the DOS thread before dos_main. NULL unbinds.
+ */
+void bindPCCore(PCCORE* pccore);
+
+/**
+ * @brief The machine bound to the calling thread, NULL if none.
+ */
+PCCORE* currentPCCore(void);
 
 #endif // PCCORE_H
\ No newline at end of file
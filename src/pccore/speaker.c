@@ -0,0 +1,372 @@
+#include "speaker.h"
+#include "iobus.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+// Canonical 44-byte WAV header: RIFF, fmt and data chunks
+#define WAV_HEADER_SIZE 44
+
+// How long the writer sleeps when the ring is empty
+#define SPEAKER_WRITER_SLEEP_NS 10000000L
+
+/**
+ * @brief Monotonic clock in nanoseconds, used for synthesis timing.
+ */
+static unsigned long long speakerNanos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void putLE(unsigned char* p, unsigned int value, int bytes) {
+    int i;
+    for (i = 0; i < bytes; i++) {
+        p[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+/**
+ * @brief Builds the WAV header for 'data_size' bytes of PCM.
+ */
+static void wavHeader(unsigned char* header, unsigned int data_size) {
+    memcpy(header, "RIFF", 4);
+    putLE(header + 4, 36 + data_size, 4);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    putLE(header + 16, 16, 4);                      // fmt chunk size
+    putLE(header + 20, 1, 2);                       // PCM
+    putLE(header + 22, 1, 2);                       // Mono
+    putLE(header + 24, SPEAKER_RATE, 4);
+    putLE(header + 28, SPEAKER_RATE * 2, 4);        // Bytes per second
+    putLE(header + 32, 2, 2);                       // Bytes per frame
+    putLE(header + 34, 16, 2);                      // Bits per sample
+    memcpy(header + 36, "data", 4);
+    putLE(header + 40, data_size, 4);
+}
+
+/**
+ * @brief The residual that rounds off a unit step at phase 0, for a
+ * phase 't' moving 'dt' per sample (PolyBLEP).
+ */
+static double polyBlep(double t, double dt) {
+    if (t < dt) {
+        t /= dt;
+        return t + t - t * t - 1.0;
+    }
+    if (t > 1.0 - dt) {
+        t = (t - 1.0) / dt;
+        return t * t + t + t + 1.0;
+    }
+    return 0.0;
+}
+
+void synthesizeSquare(short* samples, int count, double* phase, double step) {
+    double t = *phase;
+    int i;
+
+    if (step <= 0.0) {
+        memset(samples, 0, (size_t)count * sizeof(short));
+        return;
+    }
+
+    for (i = 0; i < count; i++) {
+        double value = t < 0.5 ? 1.0 : -1.0;
+        double fall = t + 0.5;
+
+        // Rising edge at 0, falling edge at 0.5
+        value += polyBlep(t, step);
+        value -= polyBlep(fall >= 1.0 ? fall - 1.0 : fall, step);
+        samples[i] = (short)(value * SPEAKER_AMPLITUDE);
+
+        t += step;
+        if (t >= 1.0) {
+            t -= 1.0;
+        }
+    }
+    *phase = t;
+}
+
+/**
+ * @brief The tone the speaker plays: the PIT divisor, or 0 if the gate
+ * or the data bit is off, or the mode is not a square wave.
+ */
+static unsigned int speakerTone(PCCORE* pccore, const SPEAKER* speaker) {
+    if ((pccore->port[SPEAKER_PORT] & (SPEAKER_GATE | SPEAKER_DATA)) != (SPEAKER_GATE | SPEAKER_DATA) ||
+        (speaker->mode & 3) != 3) {
+        return 0;
+    }
+    return speaker->divisor != 0 ? speaker->divisor : 0x10000;
+}
+
+/**
+ * @brief Queues a tone change, stamped with the guest time. Never waits:
+ * if the synthesizer is that far behind, the change is dropped.
+ */
+static void queueTone(PCCORE* pccore, SPEAKER* speaker) {
+    unsigned int tone = speakerTone(pccore, speaker);
+    unsigned long head = speaker->event_head;
+
+    if (tone == speaker->sounding) {
+        return;
+    }
+    if (head - __atomic_load_n(&speaker->event_tail, __ATOMIC_ACQUIRE) >= SPEAKER_EVENT_QUEUE) {
+        speaker->events_dropped++;
+        return;
+    }
+    speaker->sounding = tone;
+    speaker->events[head % SPEAKER_EVENT_QUEUE].time = __atomic_load_n(&pccore->time, __ATOMIC_RELAXED);
+    speaker->events[head % SPEAKER_EVENT_QUEUE].divisor = tone;
+    speaker->events_queued++;
+    __atomic_store_n(&speaker->event_head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Decodes writes to 0x42, 0x43 and 0x61.
+ */
+static void speakerPortWriter(PCCORE* pccore, unsigned int port, unsigned char value) {
+    SPEAKER* speaker = __atomic_load_n(&pccore->speaker, __ATOMIC_ACQUIRE);
+
+    if (speaker == NULL) {
+        return;
+    }
+
+    switch (port) {
+        case PIT_CONTROL_PORT:
+            // Channel 2 only; access 0 latches the count and changes nothing
+            if ((value >> 6) != 2 || ((value >> 4) & 3) == 0) {
+                return;
+            }
+            speaker->access = (value >> 4) & 3;
+            speaker->mode = (value >> 1) & 7;
+            speaker->high_next = 0;
+            break;
+        case PIT_CHANNEL2_PORT:
+            if (speaker->access == 1) {
+                speaker->divisor = value;
+            } else if (speaker->access == 2) {
+                speaker->divisor = (unsigned int)value << 8;
+            } else if (!speaker->high_next) {
+                // The count loads once both bytes are in
+                speaker->latch = value;
+                speaker->high_next = 1;
+                return;
+            } else {
+                speaker->divisor = speaker->latch | ((unsigned int)value << 8);
+                speaker->high_next = 0;
+            }
+            break;
+        default:
+            break;
+    }
+    queueTone(pccore, speaker);
+}
+
+/**
+ * @brief Synthesizes one block, applying the events that fall inside it.
+ * Returns 0 if the ring had no room and the block was dropped.
+ */
+static int synthesizeBlock(SPEAKER* speaker) {
+    short block[SPEAKER_BLOCK_SAMPLES];
+    unsigned long long end = speaker->position + SPEAKER_BLOCK_SAMPLES;
+    unsigned long tail = speaker->event_tail;
+    unsigned long head = __atomic_load_n(&speaker->event_head, __ATOMIC_ACQUIRE);
+    int done = 0;
+
+    while (done < SPEAKER_BLOCK_SAMPLES) {
+        int until = SPEAKER_BLOCK_SAMPLES;
+        const SPEAKEREVENT* event = NULL;
+
+        if (tail != head) {
+            long long at;
+
+            event = &speaker->events[tail % SPEAKER_EVENT_QUEUE];
+            at = (event->time - speaker->start) * SPEAKER_RATE / 1000;
+            if (at >= (long long)end) {
+                event = NULL;
+            } else if (at > (long long)(speaker->position + done)) {
+                until = (int)(at - (long long)speaker->position);
+            } else {
+                until = done;
+            }
+        }
+
+        synthesizeSquare(block + done, until - done, &speaker->phase, speaker->step);
+        done = until;
+
+        if (event != NULL) {
+            double frequency = event->divisor != 0 ? (double)PIT_CLOCK_HZ / event->divisor : 0.0;
+
+            // Silent, or too high to sample
+            speaker->step = frequency < SPEAKER_RATE / 2 ? frequency / SPEAKER_RATE : 0.0;
+            tail++;
+        }
+    }
+    __atomic_store_n(&speaker->event_tail, tail, __ATOMIC_RELEASE);
+    speaker->position = end;
+    speaker->blocks++;
+
+    unsigned long ringHead = speaker->ring_head;
+    unsigned long room = SPEAKER_RING_SAMPLES -
+                         (ringHead - __atomic_load_n(&speaker->ring_tail, __ATOMIC_ACQUIRE));
+    if (room < SPEAKER_BLOCK_SAMPLES) {
+        speaker->blocks_dropped++;
+        return 0;
+    }
+
+    // SPEAKER_BLOCK_SAMPLES divides the ring: a block never wraps
+    memcpy(&speaker->ring[ringHead % SPEAKER_RING_SAMPLES], block, sizeof(block));
+    __atomic_store_n(&speaker->ring_head, ringHead + SPEAKER_BLOCK_SAMPLES, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/**
+ * @brief Synthesizes whole blocks until sample 'target' is covered.
+ */
+static void synthesizeUntil(SPEAKER* speaker, long long target) {
+    unsigned long long start;
+
+    if (target <= (long long)speaker->position) {
+        return;
+    }
+    start = speakerNanos();
+    while ((long long)speaker->position < target) {
+        synthesizeBlock(speaker);
+    }
+    speaker->synth_nanos += speakerNanos() - start;
+}
+
+void advanceSpeaker(SPEAKER* speaker, long long now) {
+    long long target;
+
+    if (speaker == NULL) {
+        return;
+    }
+    if (speaker->start < 0) {
+        // Sample 0 is the first time the clock thread reports
+        speaker->start = now;
+    }
+    // Whole blocks only; the rest waits for the next call
+    target = (now - SPEAKER_LATENCY_MS - speaker->start) * SPEAKER_RATE / 1000;
+    synthesizeUntil(speaker, target - target % SPEAKER_BLOCK_SAMPLES);
+}
+
+/**
+ * @brief Writer thread: drains the ring into the file.
+ */
+static void* speakerWriter(void* arg) {
+    SPEAKER* speaker = (SPEAKER*)arg;
+    struct timespec pause = { 0, SPEAKER_WRITER_SLEEP_NS };
+
+    for (;;) {
+        unsigned long tail = speaker->ring_tail;
+        unsigned long head = __atomic_load_n(&speaker->ring_head, __ATOMIC_ACQUIRE);
+
+        if (head == tail) {
+            if (__atomic_load_n(&speaker->closing, __ATOMIC_ACQUIRE) &&
+                head == __atomic_load_n(&speaker->ring_head, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+            nanosleep(&pause, NULL);
+            continue;
+        }
+
+        // Up to the end of the ring; the rest on the next pass
+        unsigned long count = head - tail;
+        unsigned long offset = tail % SPEAKER_RING_SAMPLES;
+        if (count > SPEAKER_RING_SAMPLES - offset) {
+            count = SPEAKER_RING_SAMPLES - offset;
+        }
+        if (!speaker->failed) {
+            size_t bytes = count * sizeof(short);
+            if (write(speaker->fd, &speaker->ring[offset], bytes) == (ssize_t)bytes) {
+                speaker->written += bytes;
+            } else {
+                speaker->failed = 1;
+            }
+        }
+        __atomic_store_n(&speaker->ring_tail, tail + count, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+SPEAKER* openSpeaker(PCCORE* pccore, const char* path) {
+    SPEAKER* speaker = (SPEAKER*)calloc(1, sizeof(SPEAKER));
+    unsigned char header[WAV_HEADER_SIZE];
+
+    if (speaker == NULL) {
+        return NULL;
+    }
+
+    speaker->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (speaker->fd < 0) {
+        fprintf(stderr, "Cannot open audio output %s\n", path);
+        free(speaker);
+        return NULL;
+    }
+
+    // Sizes are filled in by closeSpeaker
+    wavHeader(header, 0);
+    if (write(speaker->fd, header, sizeof(header)) != (ssize_t)sizeof(header)) {
+        speaker->failed = 1;
+    }
+
+    speaker->start = -1;
+    if (pthread_create(&speaker->writer, NULL, speakerWriter, speaker) != 0) {
+        close(speaker->fd);
+        free(speaker);
+        return NULL;
+    }
+
+    __atomic_store_n(&pccore->speaker, speaker, __ATOMIC_RELEASE);
+    setPortHandlers(pccore, PIT_CHANNEL2_PORT, 2, NULL, speakerPortWriter);
+    setPortHandlers(pccore, SPEAKER_PORT, 1, NULL, speakerPortWriter);
+    return speaker;
+}
+
+void detachSpeaker(PCCORE* pccore) {
+    // The port handlers stay: with no speaker they do nothing
+    __atomic_store_n(&pccore->speaker, NULL, __ATOMIC_RELEASE);
+}
+
+void finishSpeaker(SPEAKER* speaker, long long now, FILE* out) {
+    unsigned char header[WAV_HEADER_SIZE];
+    double seconds;
+
+    if (speaker->start >= 0) {
+        synthesizeUntil(speaker, (now - speaker->start) * SPEAKER_RATE / 1000);
+    }
+
+    __atomic_store_n(&speaker->closing, 1, __ATOMIC_RELEASE);
+    pthread_join(speaker->writer, NULL);
+
+    wavHeader(header, (unsigned int)speaker->written);
+    if (pwrite(speaker->fd, header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+        speaker->failed = 1;
+    }
+    close(speaker->fd);
+
+    if (out != NULL) {
+        seconds = (double)speaker->position / SPEAKER_RATE;
+        fprintf(out, "Speaker: %lu tone changes (%lu dropped), %lu blocks (%lu dropped), %.1f s written%s\n",
+                speaker->events_queued, speaker->events_dropped, speaker->blocks,
+                speaker->blocks_dropped, (double)speaker->written / 2 / SPEAKER_RATE,
+                speaker->failed ? ", write error" : "");
+        if (seconds > 0) {
+            fprintf(out, "Speaker synthesis: %.3f%% of a core\n",
+                    (double)speaker->synth_nanos / (seconds * 1e9) * 100.0);
+        }
+    }
+}
+
+void closeSpeaker(PCCORE* pccore, SPEAKER* speaker, long long now, FILE* out) {
+    if (speaker == NULL) {
+        return;
+    }
+    detachSpeaker(pccore);
+    finishSpeaker(speaker, now, out);
+    free(speaker);
+}
@@ -0,0 +1,152 @@
+/*
+ * speaker.h
+ *
+ * The PC speaker: PIT channel 2 (0x42/0x43) gated by port 0x61,
+ * synthesized to 16-bit mono PCM and written to a WAV file.
+ *
+ * Port writes on the DOS thread only decode the PIT registers and, when
+ * the tone changes, push a timestamped event (guest milliseconds) onto
+ * a lock-free queue; they never wait. The thread that keeps pccore.time
+ * moving calls advanceSpeaker(), which turns the events into PCM one
+ * block at a time with a band-limited (PolyBLEP) square wave, and puts
+ * the blocks on a lock-free ring. A writer thread drains the ring into
+ * the file. If the queue or the ring is full, data is dropped and counted.
+ *
+ * Only the square wave modes (3 and 7) sound; tones above the Nyquist
+ * frequency and bit 1 of 0x61 toggled by hand with the gate off are
+ * silent, since the guest has no cycle timing to play them with.
+ */
+
+#ifndef SPEAKER_H
+#define SPEAKER_H
+
+#include "pccore.h"
+
+#include <pthread.h>
+#include <stdio.h>
+
+#define PIT_CHANNEL2_PORT 0x42
+#define PIT_CONTROL_PORT 0x43
+// |7|6|5|4|3|2|1|0|  43 Mode/Command Register
+//  | | | | | | | `---- 1 = BCD counting (ignored)
+//  | | | | `-------- operating mode (3 = square wave)
+//  | | `----------- access: 1 = low byte, 2 = high byte, 3 = low then high
+//  `-------------- channel (2 = speaker)
+
+#define SPEAKER_PORT 0x61
+// |7|6|5|4|3|2|1|0|  61 System Control Port B
+//  | | | | | | | `---- 1 = PIT channel 2 gate
+//  | | | | | | `----- 1 = speaker data enable
+//  `--------------- keyboard and parity, not emulated
+
+#define SPEAKER_GATE 0x01
+#define SPEAKER_DATA 0x02
+
+// PIT input clock
+#define PIT_CLOCK_HZ 1193182
+
+// Output format and the synthesis block
+#define SPEAKER_RATE 44100
+#define SPEAKER_BLOCK_SAMPLES 256
+#define SPEAKER_AMPLITUDE 8192
+
+// Events waiting for the synthesizer, and PCM waiting for the writer
+// (both powers of two)
+#define SPEAKER_EVENT_QUEUE 1024
+#define SPEAKER_RING_SAMPLES 65536
+
+// How far the synthesizer stays behind pccore.time, so an event written
+// in the current millisecond is still ahead of it
+#define SPEAKER_LATENCY_MS 20
+
+/**
+ * @brief A tone change: PIT divisor from 'time' on, 0 for silence.
+ */
+typedef struct {
+    long long time;
+    unsigned int divisor;
+} SPEAKEREVENT;
+
+/**
+ * @brief An open speaker output (typedef in pccore.h).
+ */
+struct SPEAKER {
+    int fd;
+
+    // PIT channel 2 and port 0x61 (DOS thread)
+    unsigned int latch;         // Reload value being written
+    unsigned int divisor;       // Loaded reload value, 0 = 65536
+    int access;                 // Control word bits 5-4
+    int mode;                   // Control word bits 3-1
+    int high_next;              // Access 3: the next byte is the high byte
+    unsigned int sounding;      // Divisor of the last event, 0 = silent
+
+    // Tone changes, DOS thread to synthesizer
+    SPEAKEREVENT events[SPEAKER_EVENT_QUEUE];
+    unsigned long event_head;
+    unsigned long event_tail;
+
+    // Synthesizer (advanceSpeaker's thread)
+    long long start;            // Guest time of sample 0, -1 until the first advanceSpeaker
+    unsigned long long position; // Samples synthesized
+    double phase, step;         // Square wave phase and increment per sample, step 0 = silent
+
+    // PCM, synthesizer to writer
+    short ring[SPEAKER_RING_SAMPLES];
+    unsigned long ring_head;
+    unsigned long ring_tail;
+
+    pthread_t writer;
+    int closing;
+    int failed;                 // Write error, stop writing
+
+    unsigned long events_queued;
+    unsigned long events_dropped;   // Event queue full
+    unsigned long blocks;           // Blocks synthesized
+    unsigned long blocks_dropped;   // Ring full
+    unsigned long long written;     // Bytes of PCM written
+    unsigned long long synth_nanos; // Time spent synthesizing
+};
+
+/**
+ * @brief Creates the WAV file, starts the writer thread and attaches the
+ * speaker ports of 'pccore' to it.
+ *
+ * @return The output, or NULL on error.
+ */
+SPEAKER* openSpeaker(PCCORE* pccore, const char* path);
+
+/**
+ * @brief Synthesizes the blocks that end before 'now' minus
+ * SPEAKER_LATENCY_MS. Call it periodically with pccore.time, from a
+ * single thread. Never waits for the writer.
+ */
+void advanceSpeaker(SPEAKER* speaker, long long now);
+
+/**
+ * @brief Clears pccore.speaker; the port writes that follow do nothing.
+ * Frees nothing: the DOS thread may still be in a port write.
+ */
+void detachSpeaker(PCCORE* pccore);
+
+/**
+ * @brief Synthesizes up to 'now', lets the writer drain the remaining
+ * PCM, completes the WAV header and closes the file, without freeing
+ * the speaker. For a wrapper that has to leave while dos_main runs:
+ * detachSpeaker first. The counters go to 'out' unless it is NULL.
+ */
+void finishSpeaker(SPEAKER* speaker, long long now, FILE* out);
+
+/**
+ * @brief detachSpeaker, finishSpeaker and frees the speaker. Call it
+ * once the DOS thread has been joined.
+ */
+void closeSpeaker(PCCORE* pccore, SPEAKER* speaker, long long now, FILE* out);
+
+/**
+ * @brief Fills 'samples' from 'step' and 'phase' (see SPEAKER), for
+ * benchmarks.
+ */
+void synthesizeSquare(short* samples, int count, double* phase, double step);
+
+#endif // SPEAKER_H
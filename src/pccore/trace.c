@@ -0,0 +1,220 @@
+#include "trace.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/**
+ * @brief One traced event. Stamps are written by different threads,
+ * each stage by exactly one of them.
+ */
+typedef struct {
+    unsigned int id;
+    unsigned long long stamp[TRACE_STAGES];  // Nanoseconds, 0 = not reached
+} TRACEEVENT;
+
+/**
+ * @brief Latencies of one stage (time since the previous stage).
+ */
+typedef struct {
+    unsigned long buckets[TRACE_BUCKETS];
+    unsigned long count;
+    unsigned long long max;                 // Nanoseconds
+} TRACEHISTOGRAM;
+
+static const char* const stageNames[TRACE_STAGES] = {
+    "keypress", "keystore", "consumed", "vram", "render", "present"
+};
+
+static int enabled = 0;
+static unsigned int nextId = 0;
+static TRACEEVENT events[TRACE_EVENTS];
+
+static unsigned int storedId = 0;       // Event in pccore.key
+static unsigned int consumedId = 0;     // Consumed, waiting for a video change
+static VIDEOSNAPSHOT lastVideo;         // Previous snapshot (renderer)
+static int haveLastVideo = 0;
+
+// Stage n holds TRACE_[n-1] -> TRACE_[n]; slot 0 holds the end-to-end time
+static TRACEHISTOGRAM histograms[TRACE_STAGES];
+static unsigned long completed = 0;
+static unsigned long lost = 0;
+
+static unsigned long long traceNanos(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (unsigned long long)(count.QuadPart * (1000000000.0 / freq.QuadPart));
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static TRACEEVENT* findEvent(unsigned int id) {
+    TRACEEVENT* event = &events[id % TRACE_EVENTS];
+    return (id != 0 && event->id == id) ? event : NULL;
+}
+
+static void stamp(unsigned int id, TRACESTAGE stage) {
+    TRACEEVENT* event = findEvent(id);
+    if (event != NULL && event->stamp[stage] == 0) {
+        __atomic_store_n(&event->stamp[stage], traceNanos(), __ATOMIC_RELEASE);
+    }
+}
+
+static void addSample(TRACEHISTOGRAM* histogram, unsigned long long nanos) {
+    unsigned long long micros = nanos / 1000;
+    int bucket = 0;
+
+    while (bucket < TRACE_BUCKETS - 1 && (1ULL << bucket) <= micros) {
+        bucket++;
+    }
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    if (nanos > histogram->max) {
+        histogram->max = nanos;
+    }
+}
+
+/**
+ * @brief Upper bound (us) of the bucket holding the given percentile.
+ */
+static unsigned long long percentile(const TRACEHISTOGRAM* histogram, int percent) {
+    unsigned long target = (histogram->count * percent + 99) / 100;
+    unsigned long seen = 0;
+    int bucket;
+
+    for (bucket = 0; bucket < TRACE_BUCKETS; bucket++) {
+        seen += histogram->buckets[bucket];
+        if (seen >= target) {
+            return 1ULL << bucket;
+        }
+    }
+    return 1ULL << (TRACE_BUCKETS - 1);
+}
+
+void enableTrace(int enable) {
+    __atomic_store_n(&enabled, enable, __ATOMIC_RELEASE);
+}
+
+unsigned int traceKeyPress(void) {
+    if (!__atomic_load_n(&enabled, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+
+    unsigned int id = __atomic_add_fetch(&nextId, 1, __ATOMIC_RELAXED);
+    if (id == 0) {
+        id = __atomic_add_fetch(&nextId, 1, __ATOMIC_RELAXED);
+    }
+
+    TRACEEVENT* event = &events[id % TRACE_EVENTS];
+    if (event->id != 0 && event->stamp[TRACE_PRESENT] == 0) {
+        // Never reached the screen (key ignored, or no visible change)
+        lost++;
+    }
+    memset(event->stamp, 0, sizeof(event->stamp));
+    event->stamp[TRACE_KEYPRESS] = traceNanos();
+    __atomic_store_n(&event->id, id, __ATOMIC_RELEASE);
+    return id;
+}
+
+void traceKeyStore(unsigned int id) {
+    if (id == 0) {
+        return;
+    }
+    stamp(id, TRACE_KEYSTORE);
+    __atomic_store_n(&storedId, id, __ATOMIC_RELEASE);
+}
+
+void traceKeyConsumed(void) {
+    if (!__atomic_load_n(&enabled, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    unsigned int id = __atomic_exchange_n(&storedId, 0, __ATOMIC_ACQ_REL);
+    if (id != 0) {
+        stamp(id, TRACE_CONSUMED);
+        __atomic_store_n(&consumedId, id, __ATOMIC_RELEASE);
+    }
+}
+
+unsigned int traceSnapshot(const VIDEOSNAPSHOT* video) {
+    if (!__atomic_load_n(&enabled, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+
+    int changed = !haveLastVideo ||
+                  video->mode != lastVideo.mode ||
+                  video->mode_reg != lastVideo.mode_reg ||
+                  video->color_reg != lastVideo.color_reg ||
+                  memcmp(video->vram, lastVideo.vram, PCCORE_VRAM_SIZE) != 0;
+    if (!changed) {
+        return 0;
+    }
+    memcpy(&lastVideo, video, sizeof(VIDEOSNAPSHOT));
+    haveLastVideo = 1;
+
+    // Only a change after the key was consumed can be its response
+    unsigned int id = __atomic_exchange_n(&consumedId, 0, __ATOMIC_ACQ_REL);
+    if (id != 0) {
+        stamp(id, TRACE_VRAM);
+    }
+    return id;
+}
+
+void traceStage(unsigned int id, TRACESTAGE stage) {
+    TRACEEVENT* event = findEvent(id);
+    int i;
+
+    if (event == NULL) {
+        return;
+    }
+    stamp(id, stage);
+    if (stage != TRACE_PRESENT) {
+        return;
+    }
+
+    // Complete: every stage has been stamped by now
+    for (i = 1; i < TRACE_STAGES; i++) {
+        unsigned long long from = __atomic_load_n(&event->stamp[i - 1], __ATOMIC_ACQUIRE);
+        unsigned long long to = __atomic_load_n(&event->stamp[i], __ATOMIC_ACQUIRE);
+        if (from == 0 || to < from) {
+            return;
+        }
+    }
+    for (i = 1; i < TRACE_STAGES; i++) {
+        addSample(&histograms[i], event->stamp[i] - event->stamp[i - 1]);
+    }
+    addSample(&histograms[0], event->stamp[TRACE_PRESENT] - event->stamp[TRACE_KEYPRESS]);
+    completed++;
+}
+
+void printTraceStats(FILE* out) {
+    int i;
+
+    fprintf(out, "Input latency: %lu events traced, %lu lost\n", completed, lost);
+    if (completed == 0) {
+        return;
+    }
+    for (i = 1; i <= TRACE_STAGES; i++) {
+        // The end-to-end row goes last
+        const TRACEHISTOGRAM* histogram = &histograms[i % TRACE_STAGES];
+        char name[32];
+
+        if (i == TRACE_STAGES) {
+            snprintf(name, sizeof(name), "total");
+        } else {
+            snprintf(name, sizeof(name), "->%s", stageNames[i]);
+        }
+        fprintf(out, "  %-10s p50 <%7llu us, p99 <%7llu us, max %8.1f us\n",
+                name, percentile(histogram, 50), percentile(histogram, 99),
+                histogram->max / 1000.0);
+    }
+}
@@ -0,0 +1,92 @@
+/*
+ * trace.h
+ *
+ * Input-to-photon latency tracer.
+ *
+ * Every key press gets an event ID, and each stage it passes through is
+ * timestamped against it:
+ *
+ *   TRACE_KEYPRESS  the wrapper received the key (X11 KeyPress)
+ *   TRACE_KEYSTORE  the key was stored to PCCORE.key
+ *   TRACE_CONSUMED  bioskey(0) handed it to the program
+ *   TRACE_VRAM      the first snapshot with changed video state after that
+ *   TRACE_RENDER    render() finished that frame
+ *   TRACE_PRESENT   the frame was sent to the display (XPutImage + flush)
+ *
+ * When an event reaches TRACE_PRESENT, the time between each pair of
+ * stages goes into a log2 histogram. printTraceStats() prints p50, p99
+ * and max per stage and can be called at any time.
+ *
+ * Tracing is off until enableTrace(1); every call is then a single load.
+ * The tracer is process-wide: it follows the one interactive machine of
+ * a wrapper, so leave it off when a process runs several machines.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "pccore.h"
+
+#include <stdio.h>
+
+// Events in flight; older ones are counted as lost when reused
+#define TRACE_EVENTS 64
+
+// Histogram buckets: bucket n holds latencies below 2^n microseconds
+#define TRACE_BUCKETS 32
+
+/**
+ * @brief Stages of one input event, in pipeline order.
+ */
+typedef enum {
+    TRACE_KEYPRESS,
+    TRACE_KEYSTORE,
+    TRACE_CONSUMED,
+    TRACE_VRAM,
+    TRACE_RENDER,
+    TRACE_PRESENT,
+    TRACE_STAGES
+} TRACESTAGE;
+
+/**
+ * @brief Turns tracing on or off.
+ */
+void enableTrace(int enable);
+
+/**
+ * @brief Starts a new event and stamps TRACE_KEYPRESS.
+ * @return The event ID, 0 if tracing is off.
+ */
+unsigned int traceKeyPress(void);
+
+/**
+ * @brief Stamps TRACE_KEYSTORE; the event is now the one in pccore.key.
+ */
+void traceKeyStore(unsigned int id);
+
+/**
+ * @brief Stamps TRACE_CONSUMED on the event in pccore.key.
+ * Called by bioskey(0) on the DOS thread.
+ */
+void traceKeyConsumed(void);
+
+/**
+ * @brief Checks a new snapshot for the first change after a consumed key.
+ * Called by the renderer after takeSnapshot().
+ *
+ * @return The event the snapshot belongs to (TRACE_VRAM stamped), or 0.
+ */
+unsigned int traceSnapshot(const VIDEOSNAPSHOT* video);
+
+/**
+ * @brief Stamps TRACE_RENDER or TRACE_PRESENT. TRACE_PRESENT completes
+ * the event and adds it to the histograms. Ignores id 0.
+ */
+void traceStage(unsigned int id, TRACESTAGE stage);
+
+/**
+ * @brief Prints p50/p99/max per stage and the event counters.
+ */
+void printTraceStats(FILE* out);
+
+#endif // TRACE_H
@@ -0,0 +1,110 @@
+#include "alloc.h"
+#include "arena.h"
+#include "dos.h"
+
+#include <string.h>
+
+/* Largest block: 0xFFFF paragraphs */
+#define FAR_MAX_BYTES 0xFFFF0UL
+
+static unsigned long paragraphs(unsigned long nbytes) {
+    return (nbytes + 15) >> 4;
+}
+
+void *farmalloc(unsigned long nbytes) {
+    unsigned available;
+    long segment;
+
+    if (nbytes == 0 || nbytes > FAR_MAX_BYTES) {
+        return NULL;
+    }
+    segment = dosAllocate(currentPCCore(), (unsigned)paragraphs(nbytes), &available);
+    return segment < 0 ? NULL : MK_FP((int)segment, 0);
+}
+
+void *farcalloc(unsigned long nunits, unsigned long unitsz) {
+    unsigned long nbytes = nunits * unitsz;
+    void *block;
+
+    if (unitsz != 0 && nbytes / unitsz != nunits) {
+        return NULL;
+    }
+    block = farmalloc(nbytes);
+    if (block != NULL) {
+        _fmemset(block, 0, paragraphs(nbytes) << 4);
+    }
+    return block;
+}
+
+void farfree(void *block) {
+    if (block != NULL && FP_OFF(block) == 0) {
+        dosFree(currentPCCore(), FP_SEG(block));
+    }
+}
+
+void *farrealloc(void *oldblock, unsigned long nbytes) {
+    PCCORE* pccore = currentPCCore();
+    unsigned available;
+    long size;
+    void *block;
+
+    if (oldblock == NULL) {
+        return farmalloc(nbytes);
+    }
+    if (nbytes == 0) {
+        farfree(oldblock);
+        return NULL;
+    }
+    size = FP_OFF(oldblock) == 0 ? dosBlockSize(pccore, FP_SEG(oldblock)) : -DOSERR_INVALID_BLOCK;
+    if (size < 0 || nbytes > FAR_MAX_BYTES) {
+        return NULL;
+    }
+    if (arenaResize(pccore, FP_SEG(oldblock), (unsigned)paragraphs(nbytes), &available) == 0) {
+        return oldblock;
+    }
+
+    // No room in place: move it. Only a failure here counts as one.
+    block = farmalloc(nbytes);
+    if (block != NULL) {
+        _fmemcpy(block, oldblock, (unsigned long)size << 4 < nbytes ? (unsigned long)size << 4 : nbytes);
+        farfree(oldblock);
+    }
+    return block;
+}
+
+unsigned long farcoreleft(void) {
+    PCCORE* pccore = currentPCCore();
+    ARENACONTROL* control = arenaControl(pccore);
+    MCB* last = (MCB*)MK_FP(control->last, 0);
+
+    return last->owner == 0 ? (unsigned long)last->size << 4 : 0;
+}
+
+int farheapcheck(void) {
+    return arenaCheck(currentPCCore()) == 0 ? _HEAPOK : _HEAPCORRUPT;
+}
+
+int farheapwalk(struct farheapinfo *hi) {
+    PCCORE* pccore = currentPCCore();
+    ARENACONTROL* control = arenaControl(pccore);
+    unsigned segment = DOS_ARENA_FIRST;
+    MCB* mcb;
+
+    if (hi->ptr != NULL) {
+        segment = FP_SEG(hi->ptr) - 1;
+        mcb = (MCB*)MK_FP(segment, 0);
+        if (segment == control->last) {
+            return _HEAPEND;
+        }
+        if (FP_OFF(hi->ptr) != 0 || segment < DOS_ARENA_FIRST || segment > control->last ||
+            (mcb->type != 'M' && mcb->type != 'Z')) {
+            return _BADNODE;
+        }
+        segment += 1 + mcb->size;
+    }
+    mcb = (MCB*)MK_FP(segment, 0);
+    hi->ptr = MK_FP(segment + 1, 0);
+    hi->size = (unsigned long)mcb->size << 4;
+    hi->in_use = mcb->owner != 0;
+    return _HEAPOK;
+}
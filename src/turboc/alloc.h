@@ -0,0 +1,47 @@
+#ifndef _ALLOC_H
+#define _ALLOC_H
+
+/*
+ * Far heap: blocks of guest memory from the DOS arena (see arena.h),
+ * so their addresses have a segment (FP_SEG, dos.h) that INT 21h calls
+ * and movedata understand. Blocks start at offset 0 of their segment.
+ */
+
+#define _HEAPEMPTY      1
+#define _HEAPOK         2
+#define _FREEENTRY      3
+#define _USEDENTRY      4
+#define _HEAPEND        5
+#define _HEAPCORRUPT   -1
+#define _BADNODE       -2
+#define _BADVALUE      -3
+
+struct farheapinfo {
+    void *ptr;
+    unsigned long size;
+    int in_use;
+};
+
+void *farmalloc(unsigned long nbytes);
+void *farcalloc(unsigned long nunits, unsigned long unitsz);
+void farfree(void *block);
+
+/*
+ * farrealloc - Resizes in place when the block, or the free memory
+ * after it, allows; moves the block otherwise.
+ */
+void *farrealloc(void *oldblock, unsigned long nbytes);
+
+/* farcoreleft - Free bytes above the highest allocated block */
+unsigned long farcoreleft(void);
+
+/* farheapcheck - _HEAPOK, or _HEAPCORRUPT if the MCB chain is broken */
+int farheapcheck(void);
+
+/*
+ * farheapwalk - Steps through the heap's blocks, the first when
+ * hi->ptr is NULL. Returns _HEAPOK per block, then _HEAPEND.
+ */
+int farheapwalk(struct farheapinfo *hi);
+
+#endif /* _ALLOC_H */
@@ -0,0 +1,358 @@
+#include "arena.h"
+
+#include <string.h>
+
+static MCB* mcbAt(PCCORE* pccore, unsigned segment) {
+    return (MCB*)(pccore->memory + ((size_t)segment << 4));
+}
+
+/*
+ * sizeClass - The free list for a block of 'size' paragraphs.
+ */
+static int sizeClass(unsigned size) {
+    return size == 0 ? 0 : 31 - __builtin_clz(size);
+}
+
+/*
+ * fitClass - The first list whose blocks all hold 'size' paragraphs
+ * (ARENA_CLASSES if none does). Class 0 may also hold empty blocks.
+ */
+static int fitClass(unsigned size) {
+    return size <= 1 ? 0 : 32 - __builtin_clz(size - 1);
+}
+
+static void listInsert(PCCORE* pccore, ARENACONTROL* control, unsigned segment) {
+    MCB* mcb = mcbAt(pccore, segment);
+    int c = sizeClass(mcb->size);
+
+    mcb->prev_free = 0;
+    mcb->next_free = control->free_head[c];
+    if (mcb->next_free != 0) {
+        mcbAt(pccore, mcb->next_free)->prev_free = (uint16_t)segment;
+    }
+    control->free_head[c] = (uint16_t)segment;
+    control->free_map |= (uint16_t)(1u << c);
+    control->free_blocks++;
+    control->free_paragraphs += mcb->size;
+}
+
+static void listRemove(PCCORE* pccore, ARENACONTROL* control, unsigned segment) {
+    MCB* mcb = mcbAt(pccore, segment);
+    int c = sizeClass(mcb->size);
+
+    if (mcb->prev_free != 0) {
+        mcbAt(pccore, mcb->prev_free)->next_free = mcb->next_free;
+    } else {
+        control->free_head[c] = mcb->next_free;
+    }
+    if (mcb->next_free != 0) {
+        mcbAt(pccore, mcb->next_free)->prev_free = mcb->prev_free;
+    }
+    if (control->free_head[c] == 0) {
+        control->free_map &= (uint16_t)~(1u << c);
+    }
+    control->free_blocks--;
+    control->free_paragraphs -= mcb->size;
+}
+
+/*
+ * nextFree - The MCB after 'segment' if it is a free block, 0 if not.
+ */
+static unsigned nextFree(PCCORE* pccore, unsigned segment) {
+    MCB* mcb = mcbAt(pccore, segment);
+    unsigned next = segment + 1 + mcb->size;
+
+    return mcb->type == 'M' && mcbAt(pccore, next)->owner == 0 ? next : 0;
+}
+
+/*
+ * absorbNext - Joins the block after 'segment' to it. Neither is in a
+ * free list.
+ */
+static void absorbNext(PCCORE* pccore, ARENACONTROL* control, unsigned segment) {
+    MCB* mcb = mcbAt(pccore, segment);
+    MCB* next = mcbAt(pccore, segment + 1 + mcb->size);
+
+    mcb->size = (uint16_t)(mcb->size + 1 + next->size);
+    mcb->type = next->type;
+    if (mcb->type == 'M') {
+        mcbAt(pccore, segment + 1 + mcb->size)->prev = (uint16_t)segment;
+    } else {
+        control->last = (uint16_t)segment;
+    }
+    control->merges++;
+}
+
+/*
+ * split - Cuts the block at 'segment' (not in a free list) down to
+ * 'size' paragraphs and frees the rest, unless the rest would not hold
+ * a paragraph besides its MCB.
+ */
+static void split(PCCORE* pccore, ARENACONTROL* control, unsigned segment, unsigned size) {
+    MCB* mcb = mcbAt(pccore, segment);
+    unsigned rest = segment + 1 + size;
+    unsigned next;
+    MCB* tail;
+
+    if (mcb->size < size + 2) {
+        return;
+    }
+    tail = mcbAt(pccore, rest);
+    memset(tail, 0, sizeof(MCB));
+    tail->type = mcb->type;
+    tail->size = (uint16_t)(mcb->size - size - 1);
+    tail->prev = (uint16_t)segment;
+    if (tail->type == 'M') {
+        mcbAt(pccore, rest + 1 + tail->size)->prev = (uint16_t)rest;
+    } else {
+        control->last = (uint16_t)rest;
+    }
+    mcb->type = 'M';
+    mcb->size = (uint16_t)size;
+
+    // Only a shrinking block can have a free block after it
+    next = nextFree(pccore, rest);
+    if (next != 0) {
+        listRemove(pccore, control, next);
+        absorbNext(pccore, control, rest);
+    }
+    listInsert(pccore, control, rest);
+}
+
+ARENACONTROL* arenaControl(PCCORE* pccore) {
+    ARENACONTROL* control = (ARENACONTROL*)(pccore->memory + (DOS_ARENA_CONTROL << 4));
+    MCB* first;
+
+    if (control->signature == ARENA_SIGNATURE) {
+        return control;
+    }
+
+    // One free block over the whole arena
+    memset(control, 0, sizeof(ARENACONTROL));
+    first = mcbAt(pccore, DOS_ARENA_FIRST);
+    memset(first, 0, sizeof(MCB));
+    first->type = 'Z';
+    first->size = DOS_ARENA_END - DOS_ARENA_FIRST - 1;
+    control->last = DOS_ARENA_FIRST;
+    listInsert(pccore, control, DOS_ARENA_FIRST);
+    control->signature = ARENA_SIGNATURE;
+    return control;
+}
+
+/*
+ * largestFree - Size of the largest free block: the largest in the
+ * highest non-empty list.
+ */
+static unsigned largestFree(PCCORE* pccore, ARENACONTROL* control) {
+    unsigned largest = 0;
+    unsigned segment;
+
+    if (control->free_map == 0) {
+        return 0;
+    }
+    segment = control->free_head[31 - __builtin_clz(control->free_map)];
+    for (; segment != 0; segment = mcbAt(pccore, segment)->next_free) {
+        if (mcbAt(pccore, segment)->size > largest) {
+            largest = mcbAt(pccore, segment)->size;
+        }
+    }
+    return largest;
+}
+
+/*
+ * findFree - A free block of at least 'size' paragraphs, 0 if none.
+ * The head of the first list above the size's own usually fits; the
+ * size's own list is searched only when nothing larger is free.
+ */
+static unsigned findFree(PCCORE* pccore, ARENACONTROL* control, unsigned size) {
+    int c = fitClass(size);
+    unsigned map = c < ARENA_CLASSES ? control->free_map & ~((1u << c) - 1) : 0;
+    unsigned segment;
+
+    for (; map != 0; map &= map - 1) {
+        segment = control->free_head[__builtin_ctz(map)];
+        if (mcbAt(pccore, segment)->size >= size) {
+            return segment;
+        }
+        // Class 0 with an empty block at its head
+        control->list_walks++;
+        for (; segment != 0; segment = mcbAt(pccore, segment)->next_free) {
+            if (mcbAt(pccore, segment)->size >= size) {
+                return segment;
+            }
+        }
+    }
+
+    c = sizeClass(size);
+    if (size > 1 && (control->free_map & (1u << c)) != 0) {
+        control->list_walks++;
+        for (segment = control->free_head[c]; segment != 0; segment = mcbAt(pccore, segment)->next_free) {
+            if (mcbAt(pccore, segment)->size >= size) {
+                return segment;
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * allocatedBlock - The MCB of the allocated block at 'segment', checked
+ * against its neighbours, or 0.
+ */
+static unsigned allocatedBlock(PCCORE* pccore, ARENACONTROL* control, unsigned segment) {
+    unsigned mcbSegment = segment - 1;
+    MCB* mcb;
+
+    if (segment <= DOS_ARENA_FIRST || segment >= DOS_ARENA_END) {
+        return 0;
+    }
+    mcb = mcbAt(pccore, mcbSegment);
+    if ((mcb->type != 'M' && mcb->type != 'Z') || mcb->owner == 0 ||
+        mcbSegment + 1 + mcb->size > DOS_ARENA_END) {
+        return 0;
+    }
+    if (mcb->type == 'Z' ? control->last != mcbSegment
+                         : mcbAt(pccore, mcbSegment + 1 + mcb->size)->prev != mcbSegment) {
+        return 0;
+    }
+    if (mcb->prev == 0 ? mcbSegment != DOS_ARENA_FIRST
+                       : mcb->prev < DOS_ARENA_FIRST ||
+                         (unsigned)mcb->prev + 1 + mcbAt(pccore, mcb->prev)->size != mcbSegment) {
+        return 0;
+    }
+    return mcbSegment;
+}
+
+long dosAllocate(PCCORE* pccore, unsigned paragraphs, unsigned* available) {
+    ARENACONTROL* control = arenaControl(pccore);
+    unsigned segment = findFree(pccore, control, paragraphs);
+
+    if (segment == 0) {
+        control->failures++;
+        *available = largestFree(pccore, control);
+        return -DOSERR_NOT_ENOUGH_MEMORY;
+    }
+    listRemove(pccore, control, segment);
+    split(pccore, control, segment, paragraphs);
+    mcbAt(pccore, segment)->owner = DOS_ARENA_OWNER;
+    control->used_blocks++;
+    control->allocations++;
+    return segment + 1;
+}
+
+long dosFree(PCCORE* pccore, unsigned segment) {
+    ARENACONTROL* control = arenaControl(pccore);
+    unsigned mcbSegment = allocatedBlock(pccore, control, segment);
+    unsigned neighbour;
+    MCB* mcb;
+
+    if (mcbSegment == 0) {
+        return -DOSERR_INVALID_BLOCK;
+    }
+    mcb = mcbAt(pccore, mcbSegment);
+    mcb->owner = 0;
+    control->used_blocks--;
+
+    neighbour = nextFree(pccore, mcbSegment);
+    if (neighbour != 0) {
+        listRemove(pccore, control, neighbour);
+        absorbNext(pccore, control, mcbSegment);
+    }
+    neighbour = mcb->prev;
+    if (neighbour != 0 && mcbAt(pccore, neighbour)->owner == 0) {
+        listRemove(pccore, control, neighbour);
+        absorbNext(pccore, control, neighbour);
+        mcbSegment = neighbour;
+    }
+    listInsert(pccore, control, mcbSegment);
+    return 0;
+}
+
+long arenaResize(PCCORE* pccore, unsigned segment, unsigned paragraphs, unsigned* available) {
+    ARENACONTROL* control = arenaControl(pccore);
+    unsigned mcbSegment = allocatedBlock(pccore, control, segment);
+    unsigned next, most;
+    MCB* mcb;
+
+    if (mcbSegment == 0) {
+        return -DOSERR_INVALID_BLOCK;
+    }
+    mcb = mcbAt(pccore, mcbSegment);
+    if (paragraphs > mcb->size) {
+        next = nextFree(pccore, mcbSegment);
+        most = mcb->size + (next != 0 ? 1u + mcbAt(pccore, next)->size : 0);
+        if (paragraphs > most) {
+            *available = most;
+            return -DOSERR_NOT_ENOUGH_MEMORY;
+        }
+        listRemove(pccore, control, next);
+        absorbNext(pccore, control, mcbSegment);
+    }
+    split(pccore, control, mcbSegment, paragraphs);
+    return 0;
+}
+
+long dosResize(PCCORE* pccore, unsigned segment, unsigned paragraphs, unsigned* available) {
+    long result = arenaResize(pccore, segment, paragraphs, available);
+
+    if (result == -DOSERR_NOT_ENOUGH_MEMORY) {
+        arenaControl(pccore)->failures++;
+    }
+    return result;
+}
+
+long dosBlockSize(PCCORE* pccore, unsigned segment) {
+    unsigned mcbSegment = allocatedBlock(pccore, arenaControl(pccore), segment);
+
+    return mcbSegment != 0 ? mcbAt(pccore, mcbSegment)->size : -DOSERR_INVALID_BLOCK;
+}
+
+void arenaStats(PCCORE* pccore, ARENASTATS* stats) {
+    ARENACONTROL* control = arenaControl(pccore);
+    unsigned long total = DOS_ARENA_END - DOS_ARENA_FIRST;
+
+    stats->free_bytes = (unsigned long)control->free_paragraphs << 4;
+    stats->used_bytes = (total - control->free_paragraphs - control->free_blocks - control->used_blocks) << 4;
+    stats->largest_free = (unsigned long)largestFree(pccore, control) << 4;
+    stats->free_blocks = control->free_blocks;
+    stats->used_blocks = control->used_blocks;
+    stats->fragmentation = stats->free_bytes != 0 ? 1.0 - (double)stats->largest_free / stats->free_bytes : 0.0;
+    stats->allocations = control->allocations;
+    stats->failures = control->failures;
+    stats->list_walks = control->list_walks;
+    stats->merges = control->merges;
+}
+
+long arenaCheck(PCCORE* pccore) {
+    ARENACONTROL* control = arenaControl(pccore);
+    unsigned segment = DOS_ARENA_FIRST;
+    unsigned prev = 0;
+    unsigned freeBlocks = 0, usedBlocks = 0;
+    int prevFree = 0;
+    MCB* mcb;
+
+    for (;;) {
+        mcb = mcbAt(pccore, segment);
+        if ((mcb->type != 'M' && mcb->type != 'Z') || mcb->prev != prev ||
+            segment + 1 + mcb->size > DOS_ARENA_END || (prevFree && mcb->owner == 0)) {
+            return -DOSERR_ARENA_TRASHED;
+        }
+        prevFree = mcb->owner == 0;
+        if (prevFree) {
+            freeBlocks++;
+        } else {
+            usedBlocks++;
+        }
+        if (mcb->type == 'Z') {
+            break;
+        }
+        prev = segment;
+        segment += 1 + mcb->size;
+    }
+
+    if (segment != control->last || segment + 1 + mcb->size != DOS_ARENA_END ||
+        freeBlocks != control->free_blocks || usedBlocks != control->used_blocks) {
+        return -DOSERR_ARENA_TRASHED;
+    }
+    return 0;
+}
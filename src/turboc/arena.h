@@ -0,0 +1,132 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include "../pccore/pccore.h"
+
+/*
+ * DOS memory arena (INT 21h AH=48h/49h/4Ah, farmalloc): conventional
+ * memory from DOS_ARENA_FIRST to DOS_ARENA_END as a chain of memory
+ * control blocks, one paragraph each, in front of every block. Blocks
+ * are handed out by the segment after their MCB.
+ *
+ * Everything lives in guest memory, the bookkeeping too, so checkpoints
+ * and shared machine images carry the heap with them. It is set up on
+ * first use.
+ *
+ * Free blocks sit in one of ARENA_CLASSES lists by size (class c holds
+ * 2^c to 2^(c+1)-1 paragraphs), linked through their MCB name field; a
+ * bitmap of the non-empty lists finds a block that surely fits with one
+ * bit scan. Neighbouring free blocks are merged when a block is freed,
+ * reaching back through the previous-MCB word each MCB keeps in its
+ * reserved bytes.
+ */
+
+#define DOS_ARENA_CONTROL 0x0060    // Arena bookkeeping (ARENACONTROL)
+#define DOS_ARENA_FIRST 0x0068      // First MCB
+#define DOS_ARENA_END 0xA000        // 640 KB
+
+// Owner word of allocated blocks: the program (there is no PSP)
+#define DOS_ARENA_OWNER DOS_ARENA_CONTROL
+
+#define ARENA_CLASSES 16
+
+/* Error codes (see int21.h for the others) */
+#define DOSERR_ARENA_TRASHED 0x07
+#define DOSERR_NOT_ENOUGH_MEMORY 0x08
+#define DOSERR_INVALID_BLOCK 0x09
+
+#pragma pack(push, 1)
+
+/**
+ * @brief A memory control block, as DOS lays it out.
+ */
+typedef struct {
+    uint8_t type;               // 'M', 'Z' for the last block
+    uint16_t owner;             // 0 if free
+    uint16_t size;              // Paragraphs, not counting the MCB
+    uint16_t prev;              // Reserved in DOS: MCB of the block before, 0 for the first
+    uint8_t reserved;
+    uint16_t next_free;         // Name field, free blocks only: free list links
+    uint16_t prev_free;
+    uint8_t name[4];
+} MCB;
+
+/**
+ * @brief The arena's bookkeeping at DOS_ARENA_CONTROL:0000.
+ */
+typedef struct {
+    uint32_t signature;         // ARENA_SIGNATURE once set up
+    uint16_t last;              // MCB of the 'Z' block
+    uint16_t free_map;          // Bit c set: free_head[c] is not empty
+    uint16_t free_head[ARENA_CLASSES];
+    uint16_t free_blocks;
+    uint16_t used_blocks;
+    uint32_t free_paragraphs;
+    uint32_t allocations;       // Successful allocations
+    uint32_t failures;          // Failed allocations and resizes
+    uint32_t list_walks;        // Allocations that had to search a list
+    uint32_t merges;            // Free blocks merged into a neighbour
+} ARENACONTROL;
+
+#pragma pack(pop)
+
+#define ARENA_SIGNATURE 0x414E5241  // "ARNA"
+
+/**
+ * @brief Arena statistics (arenaStats).
+ */
+typedef struct {
+    unsigned long free_bytes;
+    unsigned long used_bytes;   // Allocated blocks, without their MCBs
+    unsigned long largest_free; // Largest block that can be allocated, in bytes
+    unsigned int free_blocks;
+    unsigned int used_blocks;
+    // 1 - largest_free / free_bytes: 0 when all free memory is one block
+    double fragmentation;
+    unsigned long allocations;
+    unsigned long failures;
+    unsigned long list_walks;
+    unsigned long merges;
+} ARENASTATS;
+
+/**
+ * @brief The arena's bookkeeping, set up on the first call.
+ */
+ARENACONTROL* arenaControl(PCCORE* pccore);
+
+/*
+ * The INT 21h services. Segments are those of the blocks (MCB + 1).
+ * Each returns its result (segment, 0) or the negated error code; on
+ * DOSERR_NOT_ENOUGH_MEMORY '*available' is set to the largest size, in
+ * paragraphs, that would have succeeded.
+ */
+long dosAllocate(PCCORE* pccore, unsigned paragraphs, unsigned* available);
+long dosFree(PCCORE* pccore, unsigned segment);
+long dosResize(PCCORE* pccore, unsigned segment, unsigned paragraphs, unsigned* available);
+
+/**
+ * @brief dosResize without counting a failure, for callers that have a
+ * fallback (farrealloc moves the block instead).
+ */
+long arenaResize(PCCORE* pccore, unsigned segment, unsigned paragraphs, unsigned* available);
+
+/**
+ * @brief Size of the block at 'segment' in paragraphs, or the negated
+ * error code if it is not an allocated block.
+ */
+long dosBlockSize(PCCORE* pccore, unsigned segment);
+
+/**
+ * @brief Fills 'stats'. The largest free block takes a walk of one list.
+ */
+void arenaStats(PCCORE* pccore, ARENASTATS* stats);
+
+/**
+ * @brief Follows the MCB chain checking every link.
+ *
+ * @return 0 if the arena is sound, -DOSERR_ARENA_TRASHED if not.
+ */
+long arenaCheck(PCCORE* pccore);
+
+#endif /* ARENA_H */
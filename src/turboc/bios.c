@@ -1,18 +1,34 @@
 #include "bios.h"
 #include "../pccore/pccore.h"
+#include "../pccore/trace.h"
+#include "int1a.h"
 
 int bioskey(int cmd) {
+    PCCORE* pccore = currentPCCore();
     int current_key;
     switch (cmd) {
         case 0:
-            current_key = pccore.key;
-            pccore.key = 0; 
+            current_key = pccore->key;
+            pccore->key = 0; 
+            if (current_key != 0) {
+                traceKeyConsumed();
+            }
             return current_key;
         case 1:
-            return pccore.key;
+            return pccore->key;
         case 2:
-            return pccore.memory[0x417];
+            return pccore->memory[0x417];
         default:
             return 0;
     }
-}
\ No newline at end of file
+}
+
+long biostime(int cmd, long newtime) {
+    PCCORE *pccore = currentPCCore();
+
+    if (cmd == 1) {
+        setBiosTicks(pccore, newtime);
+        return newtime;
+    }
+    return biosTicks(pccore, NULL);
+}
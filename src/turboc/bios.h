@@ -15,4 +15,12 @@
  */
 int bioskey(int cmd);
 
+/*
+ * biostime - BIOS time of day (INT 1Ah, see int1a.h)
+ *
+ * cmd 0 returns the timer ticks since midnight (about 18.2 per second),
+ * cmd 1 sets the count to 'newtime'.
+ */
+long biostime(int cmd, long newtime);
+
 #endif /* _BIOS_H */
\ No newline at end of file
@@ -1,5 +1,103 @@
 #include "conio.h"
 #include "bios.h" // Assuming bios.h is in the same directory (../turboc/)
+#include "textvideo.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Longest cprintf output formatted on the stack */
+#define CPRINTF_BUFFER_SIZE 512
+
+int directvideo = 1;
+
+/*
+ * textWindow - The machine's console window, set to the whole screen on
+ * first use and after a change of text mode width.
+ */
+static TEXTWINDOW *textWindow(PCCORE *pccore) {
+    TEXTWINDOW *text = &pccore->text;
+    int cols = textColumns(pccore);
+
+    if (text->columns != cols) {
+        if (text->columns == 0) {
+            text->attribute = LIGHTGRAY;
+        }
+        text->left = 0;
+        text->top = 0;
+        text->right = (unsigned char)(cols - 1);
+        text->bottom = TEXT_ROWS - 1;
+        text->columns = (unsigned char)cols;
+    }
+    return text;
+}
+
+/*
+ * writeText - The single VRAM pass behind putch, cputs and cprintf.
+ *
+ * The cursor is read once and kept in registers; printable characters
+ * are stored as whole cells, and the window scrolls by one line only
+ * when output runs past its bottom.
+ */
+static int writeText(const char *text, int length) {
+    PCCORE *pccore = currentPCCore();
+    TEXTWINDOW *window = textWindow(pccore);
+    unsigned short *cells = textCells(pccore);
+    unsigned short attr = (unsigned short)(window->attribute << 8);
+    int cols = window->columns;
+    int draw = isTextMode(pccore);
+    int last = 0;
+    int col, row, i;
+
+    getTextCursor(pccore, &col, &row);
+    if (col < window->left || col > window->right) {
+        col = window->left;
+    }
+    if (row < window->top || row > window->bottom) {
+        row = window->top;
+    }
+
+    for (i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)text[i];
+
+        switch (c) {
+            case '\n':
+                row++;
+                break;
+            case '\r':
+                col = window->left;
+                break;
+            case '\b':
+                if (col > window->left) {
+                    col--;
+                }
+                break;
+            case '\a':
+                break;
+            default:
+                if (draw) {
+                    cells[row * cols + col] = (unsigned short)(c | attr);
+                }
+                if (++col > window->right) {
+                    col = window->left;
+                    row++;
+                }
+                break;
+        }
+
+        if (row > window->bottom) {
+            if (draw) {
+                scrollText(pccore, window->left, window->top, window->right, window->bottom,
+                           1, window->attribute);
+            }
+            row = window->bottom;
+        }
+        last = c;
+    }
+
+    setTextCursor(pccore, col, row);
+    return last;
+}
 
 /*
  * kbhit - Checks for available keystrokes in the keyboard buffer.
@@ -9,4 +107,132 @@
  */
 int kbhit(void) {
     return bioskey(1);
-}
\ No newline at end of file
+}
+
+void gotoxy(int x, int y) {
+    PCCORE *pccore = currentPCCore();
+    TEXTWINDOW *window = textWindow(pccore);
+
+    if (x < 1 || y < 1 ||
+        x > window->right - window->left + 1 || y > window->bottom - window->top + 1) {
+        return;
+    }
+    setTextCursor(pccore, window->left + x - 1, window->top + y - 1);
+}
+
+int wherex(void) {
+    PCCORE *pccore = currentPCCore();
+    TEXTWINDOW *window = textWindow(pccore);
+    int col, row;
+
+    getTextCursor(pccore, &col, &row);
+    return col - window->left + 1;
+}
+
+int wherey(void) {
+    PCCORE *pccore = currentPCCore();
+    TEXTWINDOW *window = textWindow(pccore);
+    int col, row;
+
+    getTextCursor(pccore, &col, &row);
+    return row - window->top + 1;
+}
+
+int putch(int c) {
+    char ch = (char)c;
+    writeText(&ch, 1);
+    return c;
+}
+
+int cputs(const char *str) {
+    int length = 0;
+
+    while (str[length] != '\0') {
+        length++;
+    }
+    return writeText(str, length);
+}
+
+int cprintf(const char *format, ...) {
+    char buffer[CPRINTF_BUFFER_SIZE];
+    char *text = buffer;
+    va_list args;
+    int length;
+
+    va_start(args, format);
+    length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0) {
+        return length;
+    }
+
+    // Too long for the stack buffer: format once more into the heap
+    if (length >= (int)sizeof(buffer)) {
+        text = (char *)malloc((size_t)length + 1);
+        if (text == NULL) {
+            return -1;
+        }
+        va_start(args, format);
+        vsnprintf(text, (size_t)length + 1, format, args);
+        va_end(args);
+    }
+
+    writeText(text, length);
+    if (text != buffer) {
+        free(text);
+    }
+    return length;
+}
+
+void clrscr(void) {
+    PCCORE *pccore = currentPCCore();
+    TEXTWINDOW *window = textWindow(pccore);
+
+    if (isTextMode(pccore)) {
+        scrollText(pccore, window->left, window->top, window->right, window->bottom,
+                   0, window->attribute);
+    }
+    setTextCursor(pccore, window->left, window->top);
+}
+
+void clreol(void) {
+    PCCORE *pccore = currentPCCore();
+    TEXTWINDOW *window = textWindow(pccore);
+    int col, row;
+
+    getTextCursor(pccore, &col, &row);
+    if (isTextMode(pccore) && col >= window->left && col <= window->right) {
+        fillCells(textCells(pccore) + row * window->columns + col,
+                  (unsigned short)(' ' | (window->attribute << 8)),
+                  window->right - col + 1);
+    }
+}
+
+void textattr(int newattr) {
+    textWindow(currentPCCore())->attribute = (unsigned char)newattr;
+}
+
+void textcolor(int newcolor) {
+    TEXTWINDOW *window = textWindow(currentPCCore());
+    window->attribute = (unsigned char)((window->attribute & 0x70) | (newcolor & 0x8F));
+}
+
+void textbackground(int newcolor) {
+    TEXTWINDOW *window = textWindow(currentPCCore());
+    window->attribute = (unsigned char)((window->attribute & 0x8F) | ((newcolor & 0x07) << 4));
+}
+
+void window(int left, int top, int right, int bottom) {
+    PCCORE *pccore = currentPCCore();
+    TEXTWINDOW *text = textWindow(pccore);
+
+    if (left < 1 || top < 1 || right > text->columns || bottom > TEXT_ROWS ||
+        left > right || top > bottom) {
+        return;
+    }
+    text->left = (unsigned char)(left - 1);
+    text->top = (unsigned char)(top - 1);
+    text->right = (unsigned char)(right - 1);
+    text->bottom = (unsigned char)(bottom - 1);
+    setTextCursor(pccore, text->left, text->top);
+}
@@ -1,6 +1,45 @@
 #ifndef _CONIO_H
 #define _CONIO_H
 
+/*
+ * Console functions, implemented like Turbo C with directvideo = 1:
+ * characters and attributes are stored straight into the text page at
+ * 0xB8000, and the cursor is the one in the BIOS Data Area.
+ *
+ * Coordinates are 1-based and relative to the current text window.
+ * In graphics modes the output functions only move the cursor.
+ */
+
+#if !defined(__COLORS)
+#define __COLORS
+
+enum COLORS {
+    BLACK,          /* dark colors */
+    BLUE,
+    GREEN,
+    CYAN,
+    RED,
+    MAGENTA,
+    BROWN,
+    LIGHTGRAY,
+    DARKGRAY,       /* light colors */
+    LIGHTBLUE,
+    LIGHTGREEN,
+    LIGHTCYAN,
+    LIGHTRED,
+    LIGHTMAGENTA,
+    YELLOW,
+    WHITE
+};
+#endif
+
+#define BLINK 128   /* blink bit */
+
+/*
+ * directvideo - Accepted for compatibility; output always goes to VRAM.
+ */
+extern int directvideo;
+
 /*
  * kbhit - Checks for keyboard hit
  *
@@ -11,4 +50,59 @@
  */
 int kbhit(void);
 
-#endif /* _CONIO_H */
\ No newline at end of file
+/*
+ * gotoxy - Moves the cursor to column x, row y of the window.
+ * Positions outside the window are ignored.
+ */
+void gotoxy(int x, int y);
+
+/*
+ * wherex / wherey - Cursor column / row within the window.
+ */
+int wherex(void);
+int wherey(void);
+
+/*
+ * putch - Writes one character in the current attribute.
+ * '\n' moves down a line, '\r' to the window's left edge, '\b' back one
+ * column and '\a' is ignored. Output wraps and scrolls within the window.
+ * Returns the character.
+ */
+int putch(int c);
+
+/*
+ * cputs - Writes a string like putch. Returns the last character written.
+ */
+int cputs(const char *str);
+
+/*
+ * cprintf - Formats like printf and writes the result like cputs.
+ * Returns the number of characters written.
+ */
+int cprintf(const char *format, ...);
+
+/*
+ * clrscr - Clears the window to the current attribute, cursor to 1,1.
+ */
+void clrscr(void);
+
+/*
+ * clreol - Clears from the cursor to the window's right edge.
+ */
+void clreol(void);
+
+/*
+ * textattr / textcolor / textbackground - Set the attribute used for
+ * output: the whole byte, the foreground (and BLINK) or the background.
+ */
+void textattr(int newattr);
+void textcolor(int newcolor);
+void textbackground(int newcolor);
+
+/*
+ * window - Defines the text window (screen coordinates, 1-based,
+ * inclusive) and homes the cursor in it. Invalid windows are ignored.
+ */
+void window(int left, int top, int right, int bottom);
+
+#endif /* _CONIO_H */
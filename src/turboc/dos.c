@@ -1,37 +1,412 @@
 #include "dos.h"
 #include "../pccore/pccore.h"
 #include "int10.h"
+#include "int21.h"
+#include "int1a.h"
+#include "int33.h"
+#include "../pccore/iobus.h"
+#include "../pccore/speaker.h"
 
-int int86(int intno,union REGS *inregs, union REGS *outregs)
+#include <stdint.h>
+#include <string.h>
+
+/* Bytes in a segment: offsets wrap at this */
+#define SEGMENT_SIZE 0x10000
+
+/*
+ * Register conversions between int86's REGS and a handler's REGPACK.
+ */
+static void regsToPack(const union REGS *regs, struct REGPACK *preg)
+{
+    preg->r_ax = regs->x.ax;
+    preg->r_bx = regs->x.bx;
+    preg->r_cx = regs->x.cx;
+    preg->r_dx = regs->x.dx;
+    preg->r_si = regs->x.si;
+    preg->r_di = regs->x.di;
+    preg->r_flags = (regs->x.flags & ~1u) | (regs->x.cflag & 1u);
+}
+
+static void packToRegs(const struct REGPACK *preg, union REGS *regs)
+{
+    regs->x.ax = (unsigned short)preg->r_ax;
+    regs->x.bx = (unsigned short)preg->r_bx;
+    regs->x.cx = (unsigned short)preg->r_cx;
+    regs->x.dx = (unsigned short)preg->r_dx;
+    regs->x.si = (unsigned short)preg->r_si;
+    regs->x.di = (unsigned short)preg->r_di;
+    regs->x.flags = (unsigned short)preg->r_flags;
+    regs->x.cflag = (unsigned short)(preg->r_flags & 1u);
+}
+
+/*
+ * The built-in handlers on REGPACK. INT 10h takes it as it is (ES:BP
+ * is the string of function 13h).
+ */
+static void biosTime(struct REGPACK *preg)
+{
+    union REGS regs;
+
+    packToRegs(preg, &regs);
+    int1a(&regs, &regs);
+    regsToPack(&regs, preg);
+}
+
+static void dosServices(struct REGPACK *preg)
+{
+    union REGS regs;
+    struct SREGS segregs = { preg->r_es, 0, 0, preg->r_ds };
+
+    packToRegs(preg, &regs);
+    int21(&regs, &regs, &segregs);
+    regsToPack(&regs, preg);
+}
+
+static void mouseDriver(struct REGPACK *preg)
+{
+    union REGS regs;
+
+    packToRegs(preg, &regs);
+    int33(&regs, &regs);
+    regsToPack(&regs, preg);
+}
+
+/* An IRET: what the unused vectors point at */
+static void noService(struct REGPACK *preg)
+{
+    (void)preg;
+}
+
+static const INTERRUPTHANDLER builtinVectors[256] = {
+    [0x00 ... 0x0F] = noService,
+    [0x10] = int10r,
+    [0x11 ... 0x19] = noService,
+    [0x1A] = biosTime,
+    [0x1B ... 0x20] = noService,
+    [0x21] = dosServices,
+    [0x22 ... 0x32] = noService,
+    [0x33] = mouseDriver,
+    [0x34 ... 0xFF] = noService
+};
+
+/*
+ * The same services on REGS, for int86x while their vector is not set:
+ * no conversion to REGPACK and back.
+ */
+typedef int (*REGSHANDLER)(union REGS *inregs, union REGS *outregs, struct SREGS *segregs);
+
+static int videoRegs(union REGS *inregs, union REGS *outregs, struct SREGS *segregs)
+{
+    struct REGPACK preg;
+
+    // Function 13h reads ES:BP: only intr can pass that
+    regsToPack(inregs, &preg);
+    preg.r_bp = 0;
+    preg.r_ds = segregs != NULL ? segregs->ds : 0;
+    preg.r_es = segregs != NULL ? segregs->es : 0;
+    int10r(&preg);
+    packToRegs(&preg, outregs);
+    outregs->x.cflag = 0;
+    return outregs->x.ax;
+}
+
+static int timeRegs(union REGS *inregs, union REGS *outregs, struct SREGS *segregs)
+{
+    int ax = int1a(inregs, outregs);
+
+    (void)segregs;
+    outregs->x.cflag = 0;
+    return ax;
+}
+
+static int mouseRegs(union REGS *inregs, union REGS *outregs, struct SREGS *segregs)
 {
-    switch (intno)
-    {
-    case 0x10:
-        return int10(inregs,outregs);
-        break;
-    default:
-        break;
+    int ax = int33(inregs, outregs);
+
+    (void)segregs;
+    outregs->x.cflag = 0;
+    return ax;
+}
+
+static const REGSHANDLER builtinRegs[256] = {
+    [0x10] = videoRegs,
+    [0x1A] = timeRegs,
+    [0x21] = int21,
+    [0x33] = mouseRegs
+};
+
+INTERRUPTHANDLER getvect(int interruptno)
+{
+    INTERRUPTHANDLER isr = currentPCCore()->vectors[interruptno & 0xFF];
+
+    return isr != NULL ? isr : builtinVectors[interruptno & 0xFF];
+}
+
+void setvect(int interruptno, INTERRUPTHANDLER isr)
+{
+    // Putting back the built-in handler unhooks the vector
+    currentPCCore()->vectors[interruptno & 0xFF] =
+        isr != builtinVectors[interruptno & 0xFF] ? isr : NULL;
+}
+
+void intr(int intno, struct REGPACK *preg)
+{
+    INTERRUPTHANDLER isr = currentPCCore()->vectors[intno & 0xFF];
+
+    (isr != NULL ? isr : builtinVectors[intno & 0xFF])(preg);
+}
+
+int int86x(int intno, union REGS *inregs, union REGS *outregs, struct SREGS *segregs)
+{
+    struct REGPACK preg;
+
+    // Built-in service, not hooked: straight to its REGS version
+    if (currentPCCore()->vectors[intno & 0xFF] == NULL && builtinRegs[intno & 0xFF] != NULL) {
+        return builtinRegs[intno & 0xFF](inregs, outregs, segregs);
+    }
+
+    regsToPack(inregs, &preg);
+    // The carry flag goes in clear, like after an INT instruction's caller did CLC
+    preg.r_flags &= ~1u;
+    preg.r_bp = 0;
+    preg.r_ds = segregs != NULL ? segregs->ds : 0;
+    preg.r_es = segregs != NULL ? segregs->es : 0;
+    intr(intno, &preg);
+    packToRegs(&preg, outregs);
+    if (segregs != NULL) {
+        segregs->ds = preg.r_ds;
+        segregs->es = preg.r_es;
     }
-    return 0;
+    return outregs->x.ax;
+}
+
+int int86(int intno, union REGS *inregs, union REGS *outregs)
+{
+    return int86x(intno, inregs, outregs, NULL);
+}
+
+int intdos(union REGS *inregs, union REGS *outregs)
+{
+    return int86x(0x21, inregs, outregs, NULL);
+}
+
+int intdosx(union REGS *inregs, union REGS *outregs, struct SREGS *segregs)
+{
+    return int86x(0x21, inregs, outregs, segregs);
+}
+
+unsigned char inportb(int portid){
+    return readPort(currentPCCore(), portid);
+}
+
+int inport(int portid){
+    return (int)readPortWord(currentPCCore(), portid);
 }
 
-void outportb(int portid, char value){
-    pccore.port[portid] = value;
+void outportb(int portid, unsigned char value){
+    writePort(currentPCCore(), portid, value);
+}
+
+void outport(int portid, int value){
+    writePortWord(currentPCCore(), portid, (unsigned int)value);
 }
 
 void* MK_FP(int seg, int ofs)
 {
     unsigned long linear_address = (unsigned long)(seg * 16) + (unsigned long)ofs;
-    return (void*)&pccore.memory[linear_address];
+    return (void*)&currentPCCore()->memory[linear_address];
+}
+
+unsigned FP_SEG(const void *p)
+{
+    return (unsigned)(((const unsigned char*)p - currentPCCore()->memory) >> 4);
+}
+
+unsigned FP_OFF(const void *p)
+{
+    return (unsigned)(((const unsigned char*)p - currentPCCore()->memory) & 15);
+}
+
+/*
+ * segmentBytes - seg:off in guest memory. Any pair is inside it (see
+ * PCCORE_MEMORY_SIZE); only running past offset FFFF needs care.
+ */
+static unsigned char* segmentBytes(PCCORE* pccore, unsigned seg, unsigned off) {
+    return &pccore->memory[((seg & 0xFFFF) << 4) + (off & 0xFFFF)];
+}
+
+size_t guestLength(const void* p, size_t n) {
+    PCCORE* pccore = currentPCCore();
+    uintptr_t start, end;
+
+    if (pccore == NULL) {
+        return n;
+    }
+    start = (uintptr_t)pccore->memory;
+    end = start + PCCORE_MEMORY_SIZE;
+    if ((uintptr_t)p - start < PCCORE_MEMORY_SIZE && n > end - (uintptr_t)p) {
+        return end - (uintptr_t)p;
+    }
+    return n;
+}
+
+void movedata(unsigned srcseg, unsigned srcoff, unsigned destseg, unsigned destoff, size_t n) {
+    PCCORE* pccore = currentPCCore();
+
+    srcoff &= 0xFFFF;
+    destoff &= 0xFFFF;
+
+    // Neither side crosses the end of its segment: one move
+    if (srcoff + n <= SEGMENT_SIZE && destoff + n <= SEGMENT_SIZE) {
+        memmove(segmentBytes(pccore, destseg, destoff), segmentBytes(pccore, srcseg, srcoff), n);
+        return;
+    }
+
+    // Otherwise in pieces, wrapping each offset to 0 at the end
+    while (n > 0) {
+        size_t chunk = n;
+        if (chunk > SEGMENT_SIZE - srcoff) {
+            chunk = SEGMENT_SIZE - srcoff;
+        }
+        if (chunk > SEGMENT_SIZE - destoff) {
+            chunk = SEGMENT_SIZE - destoff;
+        }
+        memmove(segmentBytes(pccore, destseg, destoff), segmentBytes(pccore, srcseg, srcoff), chunk);
+        srcoff = (unsigned)(srcoff + chunk) & 0xFFFF;
+        destoff = (unsigned)(destoff + chunk) & 0xFFFF;
+        n -= chunk;
+    }
+}
+
+void *_fmemcpy(void *dest, const void *src, size_t n) {
+    n = guestLength(src, guestLength(dest, n));
+    return memcpy(dest, src, n);
+}
+
+void *_fmemmove(void *dest, const void *src, size_t n) {
+    n = guestLength(src, guestLength(dest, n));
+    return memmove(dest, src, n);
+}
+
+void *_fmemset(void *s, int c, size_t n) {
+    return memset(s, c, guestLength(s, n));
+}
+
+void setmem(void *dest, unsigned length, char value) {
+    _fmemset(dest, value, length);
+}
+
+void *_fmemsetw(void *dest, unsigned value, size_t count) {
+    unsigned char* p = (unsigned char*)dest;
+    uint64_t four = (value & 0xFFFF) * 0x0001000100010001ULL;
+    uint16_t word = (uint16_t)value;
+
+    count = guestLength(dest, count * 2) / 2;
+
+    // Single words up to a 16-byte boundary (odd addresses never get there)
+    if (((uintptr_t)p & 1) == 0) {
+        while (count > 0 && ((uintptr_t)p & 15) != 0) {
+            memcpy(p, &word, 2);
+            p += 2;
+            count--;
+        }
+    }
+    for (; count >= 8; count -= 8, p += 16) {
+        memcpy(p, &four, 8);
+        memcpy(p + 8, &four, 8);
+    }
+    while (count-- > 0) {
+        memcpy(p, &word, 2);
+        p += 2;
+    }
+    return dest;
+}
+
+int peek(unsigned segment, unsigned offset) {
+    PCCORE* pccore = currentPCCore();
+    const unsigned char* low = segmentBytes(pccore, segment, offset);
+
+    // The high byte of a word at FFFF is at offset 0 of the segment
+    const unsigned char* high = (offset & 0xFFFF) == 0xFFFF ? segmentBytes(pccore, segment, 0) : low + 1;
+    return (short)(*low | (*high << 8));
+}
+
+char peekb(unsigned segment, unsigned offset) {
+    return (char)*segmentBytes(currentPCCore(), segment, offset);
+}
+
+void poke(unsigned segment, unsigned offset, int value) {
+    PCCORE* pccore = currentPCCore();
+    unsigned char* low = segmentBytes(pccore, segment, offset);
+    unsigned char* high = (offset & 0xFFFF) == 0xFFFF ? segmentBytes(pccore, segment, 0) : low + 1;
+
+    *low = (unsigned char)value;
+    *high = (unsigned char)(value >> 8);
+}
+
+void pokeb(unsigned segment, unsigned offset, char value) {
+    *segmentBytes(currentPCCore(), segment, offset) = (unsigned char)value;
 }
 
 void delay(int milliseconds) {
+    PCCORE* pccore = currentPCCore();
     if (milliseconds == 0) {
         return;
     }
-    long long end_time = pccore.time + milliseconds;
+    long long end_time = pccore->time + milliseconds;
 
-    while ((end_time - pccore.time) > 0) {
+    // The program is between frames: let the renderer take a clean snapshot
+    endVideoUpdate(pccore);
 
+    // pccore->time is advanced by the wrapper's thread
+    while ((end_time - __atomic_load_n(&pccore->time, __ATOMIC_RELAXED)) > 0) {
+
+    }
+
+    beginVideoUpdate(pccore);
+
+    // Keep the BIOS tick count at 0040:006C moving for programs that poll it.
+    // Not while idle: a paused machine must not change (pauseMachine).
+    biosTicks(pccore, NULL);
+
+    // A mouse handler runs like an interrupt would, between two steps of the program
+    pollMouseHandler(pccore);
+}
+
+void sound(unsigned frequency) {
+    PCCORE* pccore = currentPCCore();
+    // Below 19 Hz the divisor does not fit; 0 counts as 65536 anyway
+    unsigned int divisor = frequency != 0 ? PIT_CLOCK_HZ / frequency : 0;
+
+    if (divisor > 0xFFFF) {
+        divisor = 0;
     }
+    writePort(pccore, PIT_CONTROL_PORT, 0xB6); // Channel 2, low then high, mode 3
+    writePort(pccore, PIT_CHANNEL2_PORT, (unsigned char)(divisor & 0xFF));
+    writePort(pccore, PIT_CHANNEL2_PORT, (unsigned char)(divisor >> 8));
+    writePort(pccore, SPEAKER_PORT, readPort(pccore, SPEAKER_PORT) | SPEAKER_GATE | SPEAKER_DATA);
+}
+
+void nosound(void) {
+    PCCORE* pccore = currentPCCore();
+    writePort(pccore, SPEAKER_PORT, readPort(pccore, SPEAKER_PORT) & ~(SPEAKER_GATE | SPEAKER_DATA));
+}
+
+void getdate(struct date *datep) {
+    DOSTIME now;
+
+    localDosTime(currentPCCore(), &now);
+    datep->da_year = now.year;
+    datep->da_mon = (char)now.month;
+    datep->da_day = (char)now.day;
+}
+
+void gettime(struct time *timep) {
+    DOSTIME now;
+
+    localDosTime(currentPCCore(), &now);
+    timep->ti_hour = (unsigned char)now.hour;
+    timep->ti_min = (unsigned char)now.minute;
+    timep->ti_sec = (unsigned char)now.second;
+    timep->ti_hund = (unsigned char)now.hundredths;
 }
@@ -5,9 +5,10 @@
  * Header file for DOS-related utility functions.
  */
 
+/* 16-bit words, as in Turbo C, so that x.bx overlays h.bl and h.bh */
 struct WORDREGS
 	{
-	unsigned int	ax, bx, cx, dx, si, di, cflag, flags;
+	unsigned short	ax, bx, cx, dx, si, di, cflag, flags;
 	};
 
 struct BYTEREGS
@@ -33,12 +34,114 @@ struct	REGPACK
 	unsigned	r_bp, r_si, r_di, r_ds, r_es, r_flags;
 	};
 
+/*
+ * Interrupts. Each machine has a table of 256 vectors holding native
+ * handlers, which take the whole register set and change it in place
+ * (the carry flag is bit 0 of r_flags). Vectors nobody set run the
+ * built-in BIOS and DOS services: 10h video, 1Ah time, 21h DOS, 33h
+ * mouse; the others return at once. A handler may chain to the one
+ * getvect returned before it was installed.
+ *
+ * Every INT call is one indirect call through the table.
+ */
+typedef void (*INTERRUPTHANDLER)(struct REGPACK *regs);
+
+void setvect(int interruptno, INTERRUPTHANDLER isr);
+INTERRUPTHANDLER getvect(int interruptno);
+
+/*
+ * int86 / int86x - INT 'intno' with the general registers. int86 calls
+ * it with DS = ES = 0; int86x takes them from 'segregs' and stores
+ * their values after the interrupt back there. The carry flag comes
+ * back in x.cflag.
+ */
 int int86(int intno, union REGS *inregs, union REGS *outregs);
+int int86x(int intno, union REGS *inregs, union REGS *outregs, struct SREGS *segregs);
+/* int86 with the whole REGPACK (BP and the segment registers) */
+void intr(int intno, struct REGPACK *preg);
+
+/*
+ * intdos / intdosx - INT 21h (see int21.h). Buffers are at DS:DX, with
+ * DS from 'segregs'; intdos and int86(0x21, ...) use DS = 0.
+ */
+int intdos(union REGS *inregs, union REGS *outregs);
+int intdosx(union REGS *inregs, union REGS *outregs, struct SREGS *segregs);
+
+/* DOS error code of the last failed io.h call */
+extern int _doserrno;
 
-void outportb(int portid, char value);
+/* Port I/O through the pccore I/O bus (devices react to writes) */
+unsigned char inportb(int portid);
+int inport(int portid);
+void outportb(int portid, unsigned char value);
+void outport(int portid, int value);
 
 void* MK_FP(int seg, int ofs);
 
+/*
+ * FP_SEG / FP_OFF - The segment and offset of a pointer into guest
+ * memory, normalized: the offset is below 16.
+ */
+unsigned FP_SEG(const void *p);
+unsigned FP_OFF(const void *p);
+
+#include <stddef.h>
+
+/*
+ * Far memory. Segment:offset addresses wrap within their 64 KB segment
+ * like the 8086 string instructions; pointers (MK_FP) are host pointers
+ * into guest memory, and ranges running past its end are cut short.
+ */
+void movedata(unsigned srcseg, unsigned srcoff, unsigned destseg, unsigned destoff, size_t n);
+void *_fmemcpy(void *dest, const void *src, size_t n);
+void *_fmemmove(void *dest, const void *src, size_t n);
+void *_fmemset(void *s, int c, size_t n);
+void setmem(void *dest, unsigned length, char value);
+
+/*
+ * _fmemsetw - Stores 'count' copies of the 16-bit 'value', e.g. a
+ * character/attribute pair, 16 bytes at a time.
+ */
+void *_fmemsetw(void *dest, unsigned value, size_t count);
+
+/*
+ * guestLength - 'n', or less if the range from 'p' starts in guest
+ * memory and would run past its end. Host buffers are left alone.
+ */
+size_t guestLength(const void *p, size_t n);
+
+int peek(unsigned segment, unsigned offset);
+char peekb(unsigned segment, unsigned offset);
+void poke(unsigned segment, unsigned offset, int value);
+void pokeb(unsigned segment, unsigned offset, char value);
+
 void delay(int milliseconds);
 
+struct date {
+    int da_year;            /* current year */
+    char da_day;            /* day of the month */
+    char da_mon;            /* month (1 = Jan) */
+};
+
+struct time {
+    unsigned char ti_min;   /* minutes */
+    unsigned char ti_hour;  /* hours */
+    unsigned char ti_hund;  /* hundredths of seconds */
+    unsigned char ti_sec;   /* seconds */
+};
+
+/*
+ * getdate / gettime - Local date and time (INT 21h AH=2Ah / 2Ch).
+ */
+void getdate(struct date *datep);
+void gettime(struct time *timep);
+
+/*
+ * sound - Starts the PC speaker at 'frequency' Hz: PIT channel 2 in
+ * square wave mode, gate and data bits of port 0x61 on.
+ * nosound - Turns the speaker off.
+ */
+void sound(unsigned frequency);
+void nosound(void);
+
 #endif /* DOS_H */
\ No newline at end of file
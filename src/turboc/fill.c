@@ -0,0 +1,428 @@
+#include "graphics.h"
+#include "raster.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Seeds floodfill can have pending; each is one run of a scanline */
+#define FLOOD_STACK_SIZE 2048
+
+/* The predefined patterns, EMPTY_FILL..CLOSE_DOT_FILL */
+static const unsigned char fillPatterns[USER_FILL][8] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+    { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },
+    { 0xFF, 0xFF, 0x00, 0x00, 0xFF, 0xFF, 0x00, 0x00 },
+    { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 },
+    { 0xE0, 0xC1, 0x83, 0x07, 0x0E, 0x1C, 0x38, 0x70 },
+    { 0xF0, 0x78, 0x3C, 0x1E, 0x0F, 0x87, 0xC3, 0xE1 },
+    { 0xA5, 0xD2, 0x69, 0xB4, 0x5A, 0x2D, 0x96, 0x4B },
+    { 0xFF, 0x88, 0x88, 0x88, 0xFF, 0x88, 0x88, 0x88 },
+    { 0x81, 0x42, 0x24, 0x18, 0x18, 0x24, 0x42, 0x81 },
+    { 0xCC, 0x33, 0xCC, 0x33, 0xCC, 0x33, 0xCC, 0x33 },
+    { 0x80, 0x00, 0x08, 0x00, 0x80, 0x00, 0x08, 0x00 },
+    { 0x88, 0x00, 0x22, 0x00, 0x88, 0x00, 0x22, 0x00 }
+};
+
+typedef struct {
+    short x, y;
+} FLOODSEED;
+
+/*
+ * expandFill - Turns the fill pattern and color into the VRAM pattern of
+ * each of its 8 lines, once per setting rather than per span.
+ */
+static void expandFill(PCCORE *pccore) {
+    GRAPHSTATE *graph = &pccore->graph;
+    const unsigned char *bits;
+    RASTER raster;
+    int row;
+
+    if (!getRaster(pccore, &raster)) {
+        return;
+    }
+    bits = graph->fill_style == USER_FILL ? graph->fill_user : fillPatterns[graph->fill_style];
+    for (row = 0; row < 8; row++) {
+        graph->fill_rows[row] = rasterPattern(&raster, bits[row], graph->fill_color);
+    }
+}
+
+/*
+ * fillSpan - Screen pixels x0..x1 of line y in the fill pattern.
+ */
+static void fillSpan(const RASTER *raster, const GRAPHSTATE *graph, int x0, int x1, int y) {
+    rasterClipSpan(raster, x0, x1, y, graph->fill_rows[y & 7], RASTER_COPY);
+}
+
+void setfillstyle(int pattern, int color) {
+    PCCORE *pccore = currentPCCore();
+
+    if (pattern < EMPTY_FILL || pattern >= USER_FILL) {
+        pccore->graph.result = grError;
+        return;
+    }
+    pccore->graph.fill_style = pattern;
+    pccore->graph.fill_color = color;
+    expandFill(pccore);
+}
+
+void setfillpattern(const char *upattern, int color) {
+    PCCORE *pccore = currentPCCore();
+
+    memcpy(pccore->graph.fill_user, upattern, sizeof(pccore->graph.fill_user));
+    pccore->graph.fill_style = USER_FILL;
+    pccore->graph.fill_color = color;
+    expandFill(pccore);
+}
+
+void getfillsettings(struct fillsettingstype *fillinfo) {
+    GRAPHSTATE *graph = &currentPCCore()->graph;
+
+    fillinfo->pattern = graph->fill_style;
+    fillinfo->color = graph->fill_color;
+}
+
+void getfillpattern(char *pattern) {
+    memcpy(pattern, currentPCCore()->graph.fill_user, sizeof(currentPCCore()->graph.fill_user));
+}
+
+void bar(int left, int top, int right, int bottom) {
+    PCCORE *pccore = currentPCCore();
+    RASTER raster;
+    int y, t;
+
+    if (!openCanvas(pccore, &raster)) {
+        return;
+    }
+    if (left > right) {
+        t = left; left = right; right = t;
+    }
+    if (top > bottom) {
+        t = top; top = bottom; bottom = t;
+    }
+    top += raster.org_y;
+    bottom += raster.org_y;
+    if (top < raster.clip_top) {
+        top = raster.clip_top;
+    }
+    if (bottom > raster.clip_bottom) {
+        bottom = raster.clip_bottom;
+    }
+    for (y = top; y <= bottom; y++) {
+        fillSpan(&raster, &pccore->graph, left + raster.org_x, right + raster.org_x, y);
+    }
+}
+
+void bar3d(int left, int top, int right, int bottom, int depth, int topflag) {
+    // The receding edges rise 3 pixels for every 4 across
+    int rise = depth * 3 / 4;
+
+    bar(left, top, right, bottom);
+    rectangle(left, top, right, bottom);
+    if (depth == 0) {
+        return;
+    }
+    line(right, bottom, right + depth, bottom - rise);
+    line(right + depth, bottom - rise, right + depth, top - rise);
+    if (topflag) {
+        line(left, top, left + depth, top - rise);
+        line(left + depth, top - rise, right + depth, top - rise);
+        line(right, top, right + depth, top - rise);
+    }
+}
+
+void drawpoly(int numpoints, const int *polypoints) {
+    int i;
+
+    for (i = 1; i < numpoints; i++) {
+        line(polypoints[2 * i - 2], polypoints[2 * i - 1], polypoints[2 * i], polypoints[2 * i + 1]);
+    }
+}
+
+/*
+ * fillpoly scans every line between the top and bottom vertex: each edge
+ * crossing the pixel row adds an x, and the sorted x's pair up into
+ * spans. Edges are half-open at the bottom so that shared vertices
+ * count once.
+ */
+void fillpoly(int numpoints, const int *polypoints) {
+    PCCORE *pccore = currentPCCore();
+    RASTER raster;
+    int *xs;
+    int ymin, ymax, y, i, j, n;
+
+    if (numpoints < 2 || !openCanvas(pccore, &raster)) {
+        return;
+    }
+    xs = (int *)malloc(sizeof(int) * numpoints);
+    if (xs == NULL) {
+        pccore->graph.result = grNoScanMem;
+        return;
+    }
+
+    ymin = ymax = polypoints[1];
+    for (i = 1; i < numpoints; i++) {
+        if (polypoints[2 * i + 1] < ymin) {
+            ymin = polypoints[2 * i + 1];
+        }
+        if (polypoints[2 * i + 1] > ymax) {
+            ymax = polypoints[2 * i + 1];
+        }
+    }
+    ymin += raster.org_y;
+    ymax += raster.org_y;
+    if (ymin < raster.clip_top) {
+        ymin = raster.clip_top;
+    }
+    if (ymax > raster.clip_bottom) {
+        ymax = raster.clip_bottom;
+    }
+
+    for (y = ymin; y <= ymax; y++) {
+        int vy = y - raster.org_y;
+
+        n = 0;
+        for (i = 0; i < numpoints; i++) {
+            int k = (i + 1) % numpoints;
+            long x1 = polypoints[2 * i], y1 = polypoints[2 * i + 1];
+            long x2 = polypoints[2 * k], y2 = polypoints[2 * k + 1];
+            long num, den, x;
+
+            if (y1 == y2) {
+                continue;
+            }
+            if (y1 > y2) {
+                long t = x1; x1 = x2; x2 = t;
+                t = y1; y1 = y2; y2 = t;
+            }
+            if (vy < y1 || vy >= y2) {
+                continue;
+            }
+            // x at this line, rounded to the nearest pixel (floor division)
+            num = 2 * (x1 * (y2 - y1) + (vy - y1) * (x2 - x1)) + (y2 - y1);
+            den = 2 * (y2 - y1);
+            x = num / den;
+            if (num % den != 0 && num < 0) {
+                x--;
+            }
+
+            // Insertion sort: crossings per line are few
+            for (j = n; j > 0 && xs[j - 1] > x; j--) {
+                xs[j] = xs[j - 1];
+            }
+            xs[j] = (int)x;
+            n++;
+        }
+        for (i = 0; i + 1 < n; i += 2) {
+            fillSpan(&raster, &pccore->graph, xs[i] + raster.org_x, xs[i + 1] + raster.org_x, y);
+        }
+    }
+    free(xs);
+
+    drawpoly(numpoints, polypoints);
+    line(polypoints[2 * numpoints - 2], polypoints[2 * numpoints - 1], polypoints[0], polypoints[1]);
+}
+
+void fillellipse(int x, int y, int xradius, int yradius) {
+    PCCORE *pccore = currentPCCore();
+    RASTER raster;
+    int cx, cy, dy;
+
+    if (!openCanvas(pccore, &raster)) {
+        return;
+    }
+    cx = x + raster.org_x;
+    cy = y + raster.org_y;
+    for (dy = 0; dy <= yradius; dy++) {
+        int width = ellipseWidth(xradius, yradius, dy);
+
+        fillSpan(&raster, &pccore->graph, cx - width, cx + width, cy - dy);
+        if (dy > 0) {
+            fillSpan(&raster, &pccore->graph, cx - width, cx + width, cy + dy);
+        }
+    }
+    ellipse(x, y, 0, 360, xradius, yradius);
+}
+
+/* Bytes per line of the floodfill bitmap: one bit per pixel at 640x200 */
+#define FLOOD_ROW_BYTES (640 / 8)
+
+/*
+ * markOpen - Sets the bitmap of the pixels floodfill may fill: those
+ * inside the clip rectangle that are not the border color. Built from
+ * VRAM a byte at a time; filling clears bits, so it also records what is
+ * done (a patterned fill can leave pixels looking untouched).
+ */
+static void markOpen(const RASTER *raster, int border, unsigned char open[][FLOOD_ROW_BYTES]) {
+    unsigned char nibble[256];
+    int bytes = raster->width >> raster->shift;
+    int y, b, i;
+
+    memset(open, 0, (size_t)FLOOD_ROW_BYTES * RASTER_HEIGHT);
+
+    // 320x200: 4 pixels to 4 bits, set where the pixel is not 'border'
+    if (raster->bits == 2) {
+        for (i = 0; i < 256; i++) {
+            unsigned char x = (unsigned char)(i ^ (border * 0x55));
+            x = (unsigned char)((x | (x >> 1)) & 0x55);
+            nibble[i] = (unsigned char)(((x >> 3) & 8) | ((x >> 2) & 4) | ((x >> 1) & 2) | (x & 1));
+        }
+    }
+
+    for (y = raster->clip_top; y <= raster->clip_bottom; y++) {
+        const unsigned char *line = raster->vram + rasterRows[y];
+        unsigned char *row = open[y];
+
+        if (raster->bits == 1) {
+            for (b = 0; b < bytes; b++) {
+                row[b] = border ? (unsigned char)~line[b] : line[b];
+            }
+        } else {
+            for (b = 0; b < bytes; b += 2) {
+                row[b / 2] = (unsigned char)(nibble[line[b]] << 4 | nibble[line[b + 1]]);
+            }
+        }
+        // Nothing outside the clip rectangle
+        for (i = 0; i < raster->clip_left; i++) {
+            row[i >> 3] &= (unsigned char)~(0x80 >> (i & 7));
+        }
+        for (i = raster->clip_right + 1; i < raster->width; i++) {
+            row[i >> 3] &= (unsigned char)~(0x80 >> (i & 7));
+        }
+    }
+}
+
+#define IS_OPEN(row, x) (((row)[(x) >> 3] & (0x80 >> ((x) & 7))) != 0)
+
+/*
+ * runEnd - Last open pixel of the run starting at open pixel x,
+ * stepping over whole open bytes.
+ */
+static int runEnd(const unsigned char *row, int x, int width) {
+    while (x + 1 < width) {
+        if (((x + 1) & 7) == 0 && row[(x + 1) >> 3] == 0xFF) {
+            x += 8;
+        } else if (IS_OPEN(row, x + 1)) {
+            x++;
+        } else {
+            break;
+        }
+    }
+    return x;
+}
+
+/*
+ * runStart - First open pixel of the run ending at open pixel x.
+ */
+static int runStart(const unsigned char *row, int x) {
+    while (x > 0) {
+        if ((x & 7) == 0 && row[(x - 1) >> 3] == 0xFF) {
+            x -= 8;
+        } else if (IS_OPEN(row, x - 1)) {
+            x--;
+        } else {
+            break;
+        }
+    }
+    return x;
+}
+
+/*
+ * nextOpen - First open pixel in x..last, or last + 1, stepping over
+ * whole closed bytes.
+ */
+static int nextOpen(const unsigned char *row, int x, int last) {
+    while (x <= last) {
+        if ((x & 7) == 0 && row[x >> 3] == 0) {
+            x += 8;
+        } else if (IS_OPEN(row, x)) {
+            return x;
+        } else {
+            x++;
+        }
+    }
+    return last + 1;
+}
+
+/*
+ * floodfill - Span fill with an explicit stack.
+ *
+ * A seed is expanded left and right into its run of open pixels, which
+ * is filled as one span and closed in the bitmap; the lines above and
+ * below then get one seed per open run under it.
+ */
+void floodfill(int x, int y, int border) {
+    PCCORE *pccore = currentPCCore();
+    unsigned char open[RASTER_HEIGHT][FLOOD_ROW_BYTES];
+    FLOODSEED stack[FLOOD_STACK_SIZE];
+    RASTER raster;
+    int top = 0;
+
+    if (!openCanvas(pccore, &raster)) {
+        return;
+    }
+    x += raster.org_x;
+    y += raster.org_y;
+    if (x < raster.clip_left || x > raster.clip_right ||
+        y < raster.clip_top || y > raster.clip_bottom) {
+        return;
+    }
+    markOpen(&raster, border & raster.maxcolor, open);
+
+    stack[top].x = (short)x;
+    stack[top].y = (short)y;
+    top++;
+
+    while (top > 0) {
+        int sy, left, right, i, ny;
+
+        top--;
+        sy = stack[top].y;
+        if (!IS_OPEN(open[sy], stack[top].x)) {
+            continue;
+        }
+        left = runStart(open[sy], stack[top].x);
+        right = runEnd(open[sy], stack[top].x, raster.width);
+
+        fillSpan(&raster, &pccore->graph, left, right, sy);
+        for (i = left; i <= right; i++) {
+            if ((i & 7) == 0 && i + 7 <= right) {
+                open[sy][i >> 3] = 0;
+                i += 7;
+            } else {
+                open[sy][i >> 3] &= (unsigned char)~(0x80 >> (i & 7));
+            }
+        }
+
+        for (ny = sy - 1; ny <= sy + 1; ny += 2) {
+            if (ny < raster.clip_top || ny > raster.clip_bottom) {
+                continue;
+            }
+            for (i = nextOpen(open[ny], left, right); i <= right;
+                 i = nextOpen(open[ny], runEnd(open[ny], i, raster.width) + 1, right)) {
+                if (top == FLOOD_STACK_SIZE) {
+                    pccore->graph.result = grNoFloodMem;
+                    return;
+                }
+                stack[top].x = (short)i;
+                stack[top].y = (short)ny;
+                top++;
+            }
+        }
+    }
+}
+
+void clearviewport(void) {
+    PCCORE *pccore = currentPCCore();
+    GRAPHSTATE *graph = &pccore->graph;
+    RASTER raster;
+    int y;
+
+    if (!openCanvas(pccore, &raster)) {
+        return;
+    }
+    for (y = graph->vp_top; y <= graph->vp_bottom; y++) {
+        rasterSpan(&raster, graph->vp_left, graph->vp_right, y, 0, RASTER_COPY);
+    }
+    graph->x = 0;
+    graph->y = 0;
+}
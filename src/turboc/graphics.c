@@ -0,0 +1,519 @@
+#include "graphics.h"
+#include "dos.h"
+#include "int10.h"
+#include "raster.h"
+#include "../pccore/cga.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 0x3D9 palette bits of CGAC0..CGAC3 (select and intensity) */
+static const unsigned char cgaPalettes[] = { 0x10, 0x30, 0x00, 0x20 };
+
+/* Pixel patterns of SOLID_LINE..DASHED_LINE, first pixel in bit 15 */
+static const unsigned short linePatterns[] = { 0xFFFF, 0xCCCC, 0xFC78, 0xF8F8 };
+
+static GRAPHSTATE *graphState(void) {
+    return &currentPCCore()->graph;
+}
+
+/* --- Lines --- */
+
+/*
+ * horizontalRun - Pixels a..b (either order) of line y of a solid line.
+ */
+static void horizontalRun(const RASTER *raster, int a, int b, int y, unsigned short pattern, int op) {
+    if (a <= b) {
+        rasterClipSpan(raster, a, b, y, pattern, op);
+    } else {
+        rasterClipSpan(raster, b, a, y, pattern, op);
+    }
+}
+
+/*
+ * thinLine - Bresenham between two screen points.
+ *
+ * Solid lines that are wider than tall are drawn as one span per
+ * scanline; the others, and styled lines, pixel by pixel.
+ */
+static void thinLine(const RASTER *raster, const GRAPHSTATE *graph, int x1, int y1, int x2, int y2) {
+    int dx = abs(x2 - x1), dy = abs(y2 - y1);
+    int sx = x1 < x2 ? 1 : -1, sy = y1 < y2 ? 1 : -1;
+    int op = graph->write_mode == XOR_PUT ? RASTER_XOR : RASTER_COPY;
+    unsigned short style = graph->line_pattern;
+    int x = x1, y = y1;
+    int err, i;
+
+    if (style == 0xFFFF && dx >= dy) {
+        unsigned short solid = rasterSolid(raster, graph->color);
+        int run = x1;
+
+        err = 2 * dy - dx;
+        for (i = 0; i < dx; i++) {
+            if (err > 0) {
+                horizontalRun(raster, run, x, y, solid, op);
+                y += sy;
+                err -= 2 * dx;
+                run = x + sx;
+            }
+            err += 2 * dy;
+            x += sx;
+        }
+        horizontalRun(raster, run, x, y, solid, op);
+        return;
+    }
+
+    if (dx >= dy) {
+        err = 2 * dy - dx;
+        for (i = 0; i <= dx; i++) {
+            if (style & (0x8000 >> (i & 15))) {
+                rasterClipPixel(raster, x, y, graph->color, op);
+            }
+            if (err > 0) {
+                y += sy;
+                err -= 2 * dx;
+            }
+            err += 2 * dy;
+            x += sx;
+        }
+    } else {
+        err = 2 * dx - dy;
+        for (i = 0; i <= dy; i++) {
+            if (style & (0x8000 >> (i & 15))) {
+                rasterClipPixel(raster, x, y, graph->color, op);
+            }
+            if (err > 0) {
+                x += sx;
+                err -= 2 * dy;
+            }
+            err += 2 * dx;
+            y += sy;
+        }
+    }
+}
+
+/*
+ * drawLine - A line between two screen points in the current style.
+ * THICK_WIDTH adds a line on either side across the major axis.
+ */
+static void drawLine(const RASTER *raster, const GRAPHSTATE *graph, int x1, int y1, int x2, int y2) {
+    thinLine(raster, graph, x1, y1, x2, y2);
+    if (graph->thickness == THICK_WIDTH) {
+        if (abs(x2 - x1) >= abs(y2 - y1)) {
+            thinLine(raster, graph, x1, y1 - 1, x2, y2 - 1);
+            thinLine(raster, graph, x1, y1 + 1, x2, y2 + 1);
+        } else {
+            thinLine(raster, graph, x1 - 1, y1, x2 - 1, y2);
+            thinLine(raster, graph, x1 + 1, y1, x2 + 1, y2);
+        }
+    }
+}
+
+/* --- Ellipses --- */
+
+/*
+ * ARCSWEEP - Angular range of an arc, as the directions of its two ends
+ * and the counterclockwise sweep between them; 360 or more is the whole
+ * outline.
+ */
+typedef struct {
+    double start_x, start_y, end_x, end_y;
+    int sweep;
+} ARCSWEEP;
+
+static ARCSWEEP arcSweep(int stangle, int endangle) {
+    ARCSWEEP arc;
+
+    arc.sweep = endangle - stangle;
+    if (arc.sweep < 0) {
+        arc.sweep = arc.sweep % 360 + 360;
+    }
+    arc.start_x = cos(stangle * (M_PI / 180.0));
+    arc.start_y = sin(stangle * (M_PI / 180.0));
+    arc.end_x = cos(endangle * (M_PI / 180.0));
+    arc.end_y = sin(endangle * (M_PI / 180.0));
+    return arc;
+}
+
+/*
+ * inArc - Whether direction (x,y), y up, lies within the sweep. Two
+ * cross products instead of an angle per pixel.
+ */
+static int inArc(const ARCSWEEP *arc, double x, double y) {
+    int afterStart = arc->start_x * y - arc->start_y * x >= 0;
+    int beforeEnd = x * arc->end_y - y * arc->end_x >= 0;
+
+    return arc->sweep <= 180 ? (afterStart && beforeEnd) : (afterStart || beforeEnd);
+}
+
+/*
+ * outlineSegment - Pixels cx+a..cx+b of line y of the outline; for a
+ * partial arc only those within its angles, measured on the circle the
+ * ellipse is a scaled copy of.
+ */
+static void outlineSegment(const RASTER *raster, const ARCSWEEP *arc, int cx, int cy,
+                           int rx, int ry, int a, int b, int y, int color, unsigned short solid, int op) {
+    int x;
+
+    if (arc->sweep >= 360) {
+        rasterClipSpan(raster, cx + a, cx + b, y, solid, op);
+        return;
+    }
+    for (x = a; x <= b; x++) {
+        if (inArc(arc, (double)x * ry, (double)(cy - y) * rx)) {
+            rasterClipPixel(raster, cx + x, y, color, op);
+        }
+    }
+}
+
+/*
+ * thinEllipse - One pixel wide outline, as spans.
+ *
+ * Line dy of each half covers the pixels between its own half width and
+ * the next line's, so the outline stays connected where it is flat.
+ */
+static void thinEllipse(const RASTER *raster, const ARCSWEEP *arc, int color,
+                        int cx, int cy, int rx, int ry) {
+    unsigned short solid = rasterSolid(raster, color);
+    int outer, next, inner, dy, half;
+
+    if (rx < 0 || ry < 0) {
+        return;
+    }
+    outer = ellipseWidth(rx, ry, 0);
+    for (dy = 0; dy <= ry; dy++, outer = next) {
+        next = dy < ry ? ellipseWidth(rx, ry, dy + 1) : 0;
+        inner = dy < ry ? next + 1 : 0;
+        if (inner > outer) {
+            inner = outer;
+        }
+        for (half = 0; half < (dy == 0 ? 1 : 2); half++) {
+            int y = half ? cy + dy : cy - dy;
+            if (inner == 0) {
+                outlineSegment(raster, arc, cx, cy, rx, ry, -outer, outer, y, color, solid, RASTER_COPY);
+            } else {
+                outlineSegment(raster, arc, cx, cy, rx, ry, -outer, -inner, y, color, solid, RASTER_COPY);
+                outlineSegment(raster, arc, cx, cy, rx, ry, inner, outer, y, color, solid, RASTER_COPY);
+            }
+        }
+    }
+}
+
+static void drawEllipse(int x, int y, int stangle, int endangle, int xradius, int yradius) {
+    GRAPHSTATE *graph = graphState();
+    RASTER raster;
+    ARCSWEEP arc = arcSweep(stangle, endangle);
+
+    if (!openCanvas(currentPCCore(), &raster)) {
+        return;
+    }
+    x += raster.org_x;
+    y += raster.org_y;
+    thinEllipse(&raster, &arc, graph->color, x, y, xradius, yradius);
+    if (graph->thickness == THICK_WIDTH) {
+        thinEllipse(&raster, &arc, graph->color, x, y, xradius - 1, yradius - 1);
+        thinEllipse(&raster, &arc, graph->color, x, y, xradius + 1, yradius + 1);
+    }
+}
+
+/* --- Setup --- */
+
+void detectgraph(int *graphdriver, int *graphmode) {
+    *graphdriver = CGA;
+    *graphmode = CGAHI;
+}
+
+void initgraph(int *graphdriver, int *graphmode, const char *pathtodriver) {
+    PCCORE *pccore = currentPCCore();
+    GRAPHSTATE *graph = &pccore->graph;
+    int driver = *graphdriver, mode = *graphmode;
+
+    if (driver == DETECT) {
+        detectgraph(&driver, &mode);
+    }
+    if (driver != CGA) {
+        graph->result = grInvalidDriver;
+        *graphdriver = grInvalidDriver;
+        return;
+    }
+    if (mode < CGAC0 || mode > CGAHI) {
+        graph->result = grInvalidMode;
+        *graphdriver = grInvalidMode;
+        return;
+    }
+
+    if (!graph->active) {
+        graph->text_mode = pccore->mode == CGA40x25 ? 1 : 3;
+    }
+    setVideoMode(mode == CGAHI ? 6 : 4);
+    if (mode != CGAHI) {
+        outportb(CGA_COLOR_REGISTER_PORT, cgaPalettes[mode]);
+    }
+
+    graph->active = 1;
+    graph->driver = CGA;
+    graph->mode = mode;
+    graph->result = grOk;
+    graph->color = mode == CGAHI ? 1 : 3;
+    graph->bkcolor = 0;
+    graph->x = 0;
+    graph->y = 0;
+    graph->vp_left = 0;
+    graph->vp_top = 0;
+    graph->vp_right = getmaxx();
+    graph->vp_bottom = getmaxy();
+    graph->vp_clip = 1;
+    graph->line_style = SOLID_LINE;
+    graph->line_pattern = linePatterns[SOLID_LINE];
+    graph->thickness = NORM_WIDTH;
+    graph->write_mode = COPY_PUT;
+    setfillstyle(SOLID_FILL, graph->color);
+
+    *graphdriver = CGA;
+    *graphmode = mode;
+}
+
+void closegraph(void) {
+    GRAPHSTATE *graph = graphState();
+
+    if (!graph->active) {
+        return;
+    }
+    graph->active = 0;
+    setVideoMode(graph->text_mode);
+}
+
+int graphresult(void) {
+    GRAPHSTATE *graph = graphState();
+    int result = graph->result;
+
+    graph->result = grOk;
+    return result;
+}
+
+char *grapherrormsg(int errorcode) {
+    switch (errorcode) {
+        case grOk:              return (char *)"No error";
+        case grNoInitGraph:     return (char *)"(BGI) graphics not installed";
+        case grNotDetected:     return (char *)"Graphics hardware not detected";
+        case grFileNotFound:    return (char *)"Device driver file not found";
+        case grInvalidDriver:   return (char *)"Invalid device driver file";
+        case grNoLoadMem:       return (char *)"Not enough memory to load driver";
+        case grNoScanMem:       return (char *)"Out of memory in scan fill";
+        case grNoFloodMem:      return (char *)"Out of memory in flood fill";
+        case grFontNotFound:    return (char *)"Font file not found";
+        case grNoFontMem:       return (char *)"Not enough memory to load font";
+        case grInvalidMode:     return (char *)"Invalid graphics mode for selected driver";
+        case grIOerror:         return (char *)"Graphics I/O error";
+        case grInvalidFont:     return (char *)"Invalid font file";
+        case grInvalidFontNum:  return (char *)"Invalid font number";
+        case grInvalidVersion:  return (char *)"Invalid File Version Number";
+        default:                return (char *)"Graphics error";
+    }
+}
+
+int getmaxx(void) {
+    return graphState()->mode == CGAHI ? 639 : 319;
+}
+
+int getmaxy(void) {
+    return RASTER_HEIGHT - 1;
+}
+
+int getmaxcolor(void) {
+    return graphState()->mode == CGAHI ? 1 : 3;
+}
+
+void getaspectratio(int *xasp, int *yasp) {
+    // A 4:3 screen: 320x200 pixels are 0.83 as wide as tall, 640x200 0.42
+    *xasp = graphState()->mode == CGAHI ? 4167 : 8333;
+    *yasp = 10000;
+}
+
+void setviewport(int left, int top, int right, int bottom, int clip) {
+    GRAPHSTATE *graph = graphState();
+
+    if (left < 0 || top < 0 || right > getmaxx() || bottom > getmaxy() ||
+        left > right || top > bottom) {
+        graph->result = grError;
+        return;
+    }
+    graph->vp_left = left;
+    graph->vp_top = top;
+    graph->vp_right = right;
+    graph->vp_bottom = bottom;
+    graph->vp_clip = clip;
+    graph->x = 0;
+    graph->y = 0;
+}
+
+void cleardevice(void) {
+    PCCORE *pccore = currentPCCore();
+    RASTER raster;
+
+    if (!openCanvas(pccore, &raster)) {
+        return;
+    }
+    memset(raster.vram, 0, PCCORE_VRAM_SIZE);
+    pccore->graph.x = 0;
+    pccore->graph.y = 0;
+}
+
+/* --- Drawing --- */
+
+void putpixel(int x, int y, int color) {
+    RASTER raster;
+
+    if (openCanvas(currentPCCore(), &raster)) {
+        rasterClipPixel(&raster, x + raster.org_x, y + raster.org_y, color, RASTER_COPY);
+    }
+}
+
+unsigned getpixel(int x, int y) {
+    RASTER raster;
+
+    if (!openCanvas(currentPCCore(), &raster)) {
+        return 0;
+    }
+    x += raster.org_x;
+    y += raster.org_y;
+    if (x < 0 || x >= raster.width || y < 0 || y >= RASTER_HEIGHT) {
+        return 0;
+    }
+    return (unsigned)rasterGetPixel(&raster, x, y);
+}
+
+void moveto(int x, int y) {
+    GRAPHSTATE *graph = graphState();
+    graph->x = x;
+    graph->y = y;
+}
+
+void moverel(int dx, int dy) {
+    GRAPHSTATE *graph = graphState();
+    graph->x += dx;
+    graph->y += dy;
+}
+
+int getx(void) {
+    return graphState()->x;
+}
+
+int gety(void) {
+    return graphState()->y;
+}
+
+void line(int x1, int y1, int x2, int y2) {
+    RASTER raster;
+
+    if (openCanvas(currentPCCore(), &raster)) {
+        drawLine(&raster, graphState(), x1 + raster.org_x, y1 + raster.org_y,
+                 x2 + raster.org_x, y2 + raster.org_y);
+    }
+}
+
+void lineto(int x, int y) {
+    GRAPHSTATE *graph = graphState();
+
+    line(graph->x, graph->y, x, y);
+    graph->x = x;
+    graph->y = y;
+}
+
+void linerel(int dx, int dy) {
+    GRAPHSTATE *graph = graphState();
+
+    lineto(graph->x + dx, graph->y + dy);
+}
+
+void rectangle(int left, int top, int right, int bottom) {
+    GRAPHSTATE *graph = graphState();
+    RASTER raster;
+    int t;
+
+    if (!openCanvas(currentPCCore(), &raster)) {
+        return;
+    }
+    if (left > right) {
+        t = left; left = right; right = t;
+    }
+    if (top > bottom) {
+        t = top; top = bottom; bottom = t;
+    }
+    left += raster.org_x;
+    right += raster.org_x;
+    top += raster.org_y;
+    bottom += raster.org_y;
+
+    // Sides without the corners, so XOR_PUT leaves them set
+    drawLine(&raster, graph, left, top, right, top);
+    if (bottom > top) {
+        drawLine(&raster, graph, left, bottom, right, bottom);
+    }
+    if (bottom - top > 1) {
+        drawLine(&raster, graph, left, top + 1, left, bottom - 1);
+        if (right > left) {
+            drawLine(&raster, graph, right, top + 1, right, bottom - 1);
+        }
+    }
+}
+
+void circle(int x, int y, int radius) {
+    int xasp, yasp;
+
+    getaspectratio(&xasp, &yasp);
+    drawEllipse(x, y, 0, 360, radius, (int)(((long)radius * xasp + yasp / 2) / yasp));
+}
+
+void arc(int x, int y, int stangle, int endangle, int radius) {
+    int xasp, yasp;
+
+    getaspectratio(&xasp, &yasp);
+    drawEllipse(x, y, stangle, endangle, radius, (int)(((long)radius * xasp + yasp / 2) / yasp));
+}
+
+void ellipse(int x, int y, int stangle, int endangle, int xradius, int yradius) {
+    drawEllipse(x, y, stangle, endangle, xradius, yradius);
+}
+
+/* --- Colors and styles --- */
+
+void setcolor(int color) {
+    graphState()->color = color;
+}
+
+int getcolor(void) {
+    return graphState()->color;
+}
+
+void setbkcolor(int color) {
+    PCCORE *pccore = currentPCCore();
+
+    pccore->graph.bkcolor = color & 0x0F;
+    if (pccore->graph.active) {
+        outportb(CGA_COLOR_REGISTER_PORT,
+                 (unsigned char)((pccore->port[CGA_COLOR_REGISTER_PORT] & 0xF0) | (color & 0x0F)));
+    }
+}
+
+int getbkcolor(void) {
+    return graphState()->bkcolor;
+}
+
+void setlinestyle(int linestyle, unsigned upattern, int thickness) {
+    GRAPHSTATE *graph = graphState();
+
+    if (linestyle < SOLID_LINE || linestyle > USERBIT_LINE ||
+        (thickness != NORM_WIDTH && thickness != THICK_WIDTH)) {
+        graph->result = grError;
+        return;
+    }
+    graph->line_style = linestyle;
+    graph->line_pattern = linestyle == USERBIT_LINE ? (unsigned short)upattern : linePatterns[linestyle];
+    graph->thickness = thickness;
+}
+
+void setwritemode(int mode) {
+    graphState()->write_mode = mode == XOR_PUT ? XOR_PUT : COPY_PUT;
+}
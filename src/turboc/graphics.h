@@ -0,0 +1,271 @@
+#ifndef _GRAPHICS_H
+#define _GRAPHICS_H
+
+/*
+ * Borland Graphics Interface for the CGA, drawing straight into VRAM at
+ * 0xB8000 like Turbo C's CGA.BGI. No driver files are loaded: the
+ * pathtodriver argument of initgraph is ignored.
+ *
+ * Coordinates are relative to the viewport, and drawing is clipped to
+ * it (or to the screen when clipping is off). Colors are pixel values:
+ * 0-3 in CGAC0..CGAC3 (0 is the background), 0-1 in CGAHI.
+ */
+
+enum graphics_errors {      /* graphresult error return codes */
+    grOk               =   0,
+    grNoInitGraph      =  -1,
+    grNotDetected      =  -2,
+    grFileNotFound     =  -3,
+    grInvalidDriver    =  -4,
+    grNoLoadMem        =  -5,
+    grNoScanMem        =  -6,
+    grNoFloodMem       =  -7,
+    grFontNotFound     =  -8,
+    grNoFontMem        =  -9,
+    grInvalidMode      = -10,
+    grError            = -11,   /* generic error */
+    grIOerror          = -12,
+    grInvalidFont      = -13,
+    grInvalidFontNum   = -14,
+    grInvalidVersion   = -18
+};
+
+enum graphics_drivers {     /* define graphics drivers */
+    DETECT,                 /* requests autodetection */
+    CGA, MCGA, EGA, EGA64, EGAMONO, IBM8514,    /* 1 - 6 */
+    HERCMONO, ATT400, VGA, PC3270,              /* 7 - 10 */
+    CURRENT_DRIVER = -1
+};
+
+enum graphics_modes {       /* graphics modes for each driver */
+    CGAC0      = 0,  /* 320x200 palette 0; 1 page: LightGreen, LightRed, Yellow */
+    CGAC1      = 1,  /* 320x200 palette 1; 1 page: LightCyan, LightMagenta, White */
+    CGAC2      = 2,  /* 320x200 palette 2; 1 page: Green, Red, Brown */
+    CGAC3      = 3,  /* 320x200 palette 3; 1 page: Cyan, Magenta, LightGray */
+    CGAHI      = 4   /* 640x200 1 page */
+};
+
+#if !defined(__COLORS)
+#define __COLORS
+
+enum COLORS {
+    BLACK,          /* dark colors */
+    BLUE,
+    GREEN,
+    CYAN,
+    RED,
+    MAGENTA,
+    BROWN,
+    LIGHTGRAY,
+    DARKGRAY,       /* light colors */
+    LIGHTBLUE,
+    LIGHTGREEN,
+    LIGHTCYAN,
+    LIGHTRED,
+    LIGHTMAGENTA,
+    YELLOW,
+    WHITE
+};
+#endif
+
+enum line_styles {          /* Line styles for get/setlinestyle */
+    SOLID_LINE   = 0,
+    DOTTED_LINE  = 1,
+    CENTER_LINE  = 2,
+    DASHED_LINE  = 3,
+    USERBIT_LINE = 4        /* User defined line style */
+};
+
+enum line_widths {          /* Line widths for get/setlinestyle */
+    NORM_WIDTH  = 1,
+    THICK_WIDTH = 3
+};
+
+enum fill_patterns {        /* Fill patterns for get/setfillstyle */
+    EMPTY_FILL,             /* fills area in background color */
+    SOLID_FILL,             /* fills area in solid fill color */
+    LINE_FILL,              /* --- fill */
+    LTSLASH_FILL,           /* /// fill */
+    SLASH_FILL,             /* /// fill with thick lines */
+    BKSLASH_FILL,           /* \\\ fill with thick lines */
+    LTBKSLASH_FILL,         /* \\\ fill */
+    HATCH_FILL,             /* light hatch fill */
+    XHATCH_FILL,            /* heavy cross hatch fill */
+    INTERLEAVE_FILL,        /* interleaving line fill */
+    WIDE_DOT_FILL,          /* Widely spaced dot fill */
+    CLOSE_DOT_FILL,         /* Closely spaced dot fill */
+    USER_FILL               /* user defined fill */
+};
+
+struct fillsettingstype {
+    int pattern;
+    int color;
+};
+
+enum putimage_ops {         /* BitBlt operators for putimage */
+    COPY_PUT,               /* MOV */
+    XOR_PUT,                /* XOR */
+    OR_PUT,                 /* OR  */
+    AND_PUT,                /* AND */
+    NOT_PUT                 /* MOV NOT */
+};
+
+/*
+ * initgraph - Switches to the graphics mode and resets the colors,
+ * position, viewport and styles. DETECT picks CGA / CGAHI.
+ * *graphdriver is set to a negative error code on failure.
+ */
+void initgraph(int *graphdriver, int *graphmode, const char *pathtodriver);
+
+/*
+ * detectgraph - The driver and highest mode of the display: CGA, CGAHI.
+ */
+void detectgraph(int *graphdriver, int *graphmode);
+
+/*
+ * closegraph - Returns to the text mode active before initgraph.
+ */
+void closegraph(void);
+
+/*
+ * graphresult - Error code of the last graphics operation, then grOk.
+ * grapherrormsg - Its message.
+ */
+int graphresult(void);
+char *grapherrormsg(int errorcode);
+
+int getmaxx(void);
+int getmaxy(void);
+int getmaxcolor(void);
+
+/*
+ * getaspectratio - Pixel aspect: *yasp is 10000, *xasp the width of a
+ * pixel on the same scale. Circles are drawn using it.
+ */
+void getaspectratio(int *xasp, int *yasp);
+
+/*
+ * setviewport - Screen rectangle (inclusive) later coordinates are
+ * relative to; 'clip' non-zero clips drawing to it. Moves to 0,0.
+ */
+void setviewport(int left, int top, int right, int bottom, int clip);
+
+/*
+ * cleardevice - Clears the screen to the background, moves to 0,0.
+ */
+void cleardevice(void);
+
+void putpixel(int x, int y, int color);
+unsigned getpixel(int x, int y);
+
+/*
+ * moveto / moverel / getx / gety - The current position.
+ */
+void moveto(int x, int y);
+void moverel(int dx, int dy);
+int getx(void);
+int gety(void);
+
+/*
+ * line / lineto / linerel - Lines in the current color, line style and
+ * write mode. lineto and linerel move the current position.
+ */
+void line(int x1, int y1, int x2, int y2);
+void lineto(int x, int y);
+void linerel(int dx, int dy);
+
+void rectangle(int left, int top, int right, int bottom);
+
+/*
+ * circle / arc / ellipse - Outlines in the current color and thickness.
+ * Angles are degrees counterclockwise from 3 o'clock.
+ */
+void circle(int x, int y, int radius);
+void arc(int x, int y, int stangle, int endangle, int radius);
+void ellipse(int x, int y, int stangle, int endangle, int xradius, int yradius);
+
+/*
+ * setcolor - Drawing color. setbkcolor - Color of pixel value 0 at
+ * 320x200; at 640x200 the CGA only lets the foreground change, so it
+ * sets that instead.
+ */
+void setcolor(int color);
+int getcolor(void);
+void setbkcolor(int color);
+int getbkcolor(void);
+
+/*
+ * setlinestyle - SOLID_LINE .. USERBIT_LINE ('upattern' for the last)
+ * and NORM_WIDTH or THICK_WIDTH.
+ */
+void setlinestyle(int linestyle, unsigned upattern, int thickness);
+
+/*
+ * setwritemode - COPY_PUT or XOR_PUT, used by the line functions.
+ */
+void setwritemode(int mode);
+
+/*
+ * setfillstyle - One of the fill patterns above (not USER_FILL) and the
+ * fill color. Set bits of a pattern take the color, clear bits the
+ * background. setfillpattern - An 8x8 pattern, one byte per line with
+ * the leftmost pixel in bit 7; selects USER_FILL.
+ */
+void setfillstyle(int pattern, int color);
+void setfillpattern(const char *upattern, int color);
+void getfillsettings(struct fillsettingstype *fillinfo);
+void getfillpattern(char *pattern);
+
+/*
+ * bar - Fills a rectangle with the fill pattern, without an outline.
+ * bar3d - A bar outlined in the line color, with a side 'depth' pixels
+ * deep and, if 'topflag' is non-zero, a top.
+ */
+void bar(int left, int top, int right, int bottom);
+void bar3d(int left, int top, int right, int bottom, int depth, int topflag);
+
+/*
+ * drawpoly - Lines through 'numpoints' x,y pairs.
+ * fillpoly - Fills the polygon (even-odd rule) and outlines it, closed.
+ */
+void drawpoly(int numpoints, const int *polypoints);
+void fillpoly(int numpoints, const int *polypoints);
+
+/*
+ * fillellipse - Filled and outlined ellipse.
+ */
+void fillellipse(int x, int y, int xradius, int yradius);
+
+/*
+ * floodfill - Fills the area around x,y up to pixels of color 'border'
+ * (and the viewport when clipping). An area too ragged for the fixed
+ * seed stack is left partly filled, with grNoFloodMem.
+ */
+void floodfill(int x, int y, int border);
+
+/*
+ * imagesize - Bytes getimage needs for the rectangle: a 4-byte header
+ * (width - 1, height - 1) and byte-aligned rows of packed pixels.
+ * 0xFFFF if that is 64 KB or more.
+ */
+unsigned imagesize(int left, int top, int right, int bottom);
+
+/*
+ * getimage - Saves the rectangle into 'bitmap'; pixels off the screen
+ * read as 0.
+ */
+void getimage(int left, int top, int right, int bottom, void *bitmap);
+
+/*
+ * putimage - Draws a saved image with its top left corner at left,top
+ * by COPY_PUT, XOR_PUT, OR_PUT, AND_PUT or NOT_PUT, clipped like the
+ * other drawing functions.
+ */
+void putimage(int left, int top, const void *bitmap, int op);
+
+/*
+ * clearviewport - Clears the viewport to the background, moves to 0,0.
+ */
+void clearviewport(void);
+
+#endif /* _GRAPHICS_H */
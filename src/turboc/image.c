@@ -0,0 +1,115 @@
+#include "graphics.h"
+#include "raster.h"
+
+#include <string.h>
+
+/* Header before the pixel rows: width - 1 and height - 1, 16 bits each */
+#define IMAGE_HEADER 4
+
+/*
+ * rowBytes - Bytes of one packed row of 'width' pixels.
+ */
+static int rowBytes(const RASTER *raster, int width) {
+    return (width * raster->bits + 7) >> 3;
+}
+
+unsigned imagesize(int left, int top, int right, int bottom) {
+    PCCORE *pccore = currentPCCore();
+    RASTER raster;
+    long size;
+    int width = (right > left ? right - left : left - right) + 1;
+    int height = (bottom > top ? bottom - top : top - bottom) + 1;
+
+    if (!getRaster(pccore, &raster)) {
+        return 0;
+    }
+    size = IMAGE_HEADER + (long)height * rowBytes(&raster, width);
+    return size >= 0xFFFF ? 0xFFFF : (unsigned)size;
+}
+
+void getimage(int left, int top, int right, int bottom, void *bitmap) {
+    PCCORE *pccore = currentPCCore();
+    unsigned char *image = (unsigned char *)bitmap;
+    RASTER raster;
+    int width, height, bytes, y;
+
+    if (!openCanvas(pccore, &raster)) {
+        return;
+    }
+    if (left > right || top > bottom) {
+        pccore->graph.result = grError;
+        return;
+    }
+    width = right - left + 1;
+    height = bottom - top + 1;
+    bytes = rowBytes(&raster, width);
+    image[0] = (unsigned char)(width - 1);
+    image[1] = (unsigned char)((width - 1) >> 8);
+    image[2] = (unsigned char)(height - 1);
+    image[3] = (unsigned char)((height - 1) >> 8);
+    image += IMAGE_HEADER;
+
+    left += raster.org_x;
+    top += raster.org_y;
+    for (y = 0; y < height; y++, image += bytes) {
+        int sy = top + y;
+        int x0 = left < 0 ? 0 : left;
+        int x1 = left + width - 1 >= raster.width ? raster.width - 1 : left + width - 1;
+        unsigned char row[RASTER_ROW_BYTES + 8];
+
+        memset(image, 0, (size_t)bytes);
+        if (sy < 0 || sy >= RASTER_HEIGHT || x0 > x1) {
+            continue;
+        }
+        if (x0 == left) {
+            rasterReadRow(&raster, x0, sy, x1 - x0 + 1, image);
+            continue;
+        }
+        // Starts off the left edge: read the visible part and move it right
+        rasterReadRow(&raster, x0, sy, x1 - x0 + 1, row);
+        {
+            int skip = (x0 - left) * raster.bits;
+            int phase = skip & 7;
+            int i;
+
+            for (i = 0; i < rowBytes(&raster, x1 - x0 + 1); i++) {
+                int at = (skip >> 3) + i;
+                image[at] |= (unsigned char)(row[i] >> phase);
+                if (phase != 0 && at + 1 < bytes) {
+                    image[at + 1] |= (unsigned char)(row[i] << (8 - phase));
+                }
+            }
+        }
+    }
+}
+
+void putimage(int left, int top, const void *bitmap, int op) {
+    PCCORE *pccore = currentPCCore();
+    const unsigned char *image = (const unsigned char *)bitmap;
+    RASTER raster;
+    int width, height, bytes, y, x0, x1, y0, y1;
+
+    if (!openCanvas(pccore, &raster)) {
+        return;
+    }
+    width = (image[0] | (image[1] << 8)) + 1;
+    height = (image[2] | (image[3] << 8)) + 1;
+    bytes = rowBytes(&raster, width);
+    image += IMAGE_HEADER;
+
+    left += raster.org_x;
+    top += raster.org_y;
+    x0 = left < raster.clip_left ? raster.clip_left : left;
+    x1 = left + width - 1 > raster.clip_right ? raster.clip_right : left + width - 1;
+    y0 = top < raster.clip_top ? raster.clip_top : top;
+    y1 = top + height - 1 > raster.clip_bottom ? raster.clip_bottom : top + height - 1;
+    if (x0 > x1 || y0 > y1 || op < COPY_PUT || op > NOT_PUT) {
+        return;
+    }
+
+    // The BGI operators are numbered like the RASTER_ ones
+    for (y = y0; y <= y1; y++) {
+        rasterWriteRow(&raster, x0, y, x1 - x0 + 1, image + (long)(y - top) * bytes, bytes,
+                       x0 - left, op);
+    }
+}
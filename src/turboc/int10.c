@@ -1,12 +1,362 @@
 #include "int10.h"
+#include "textvideo.h"
+#include "../pccore/bda.h"
+#include "../pccore/cgafont.h"
 #include <string.h> 
 
+/* Scanlines of one character in the graphics modes */
+#define GLYPH_HEIGHT 8
+
 /**
- * @brief Handler for INT 10h (Video BIOS Services).
- * * Dispatches commands based on the value in AH.
+ * @brief Reads / writes a little-endian BDA word.
  */
-int int10(union REGS *inregs, union REGS *outregs)
+static unsigned int bdaWord(PCCORE* pccore, unsigned int offset) {
+    return pccore->memory[offset] | (pccore->memory[offset + 1] << 8);
+}
+
+static void setBdaWord(PCCORE* pccore, unsigned int offset, unsigned int value) {
+    pccore->memory[offset] = (unsigned char)value;
+    pccore->memory[offset + 1] = (unsigned char)(value >> 8);
+}
+
+/**
+ * @brief Number of display pages of the current mode (16 KB of VRAM).
+ */
+static int pageCount(PCCORE* pccore) {
+    unsigned int size = bdaWord(pccore, BDA_VIDEO_PAGE_SIZE);
+    return size != 0 && isTextMode(pccore) ? (int)(PCCORE_VRAM_SIZE / size) : 1;
+}
+
+/* --- Graphics modes: characters are 8x8 glyphs drawn into the two banks --- */
+
+/**
+ * @brief First byte of scanline y in VRAM (even lines bank 0, odd bank 1).
+ */
+static unsigned char* scanline(PCCORE* pccore, int y) {
+    return &pccore->memory[CGA_VIDEO_RAM_START + (y & 1) * CGA_BANK1_OFFSET +
+                           (y >> 1) * CGA_BYTES_PER_LINE];
+}
+
+/**
+ * @brief VRAM bytes per character column: 1 at 640x200, 2 at 320x200.
+ */
+static int glyphBytes(PCCORE* pccore) {
+    return pccore->mode == CGA640x200x1 ? 1 : 2;
+}
+
+/**
+ * @brief A glyph row as 2-bit pixels of 'color' (320x200), as a 16-bit
+ * word with the leftmost pixel in the high bits of the first byte.
+ */
+static unsigned int widenGlyphRow(unsigned char bits, int color) {
+    unsigned int pixels = 0;
+    int x;
+
+    for (x = 0; x < 8; x++) {
+        pixels <<= 2;
+        if (bits & (0x80 >> x)) {
+            pixels |= color & 3;
+        }
+    }
+    return pixels;
+}
+
+/**
+ * @brief Draws 'count' copies of glyph 'c' from (col,row) on.
+ *
+ * Bit 7 of 'color' XORs the glyph with the screen, like the BIOS does;
+ * otherwise the cell is replaced (background pixels become color 0).
+ */
+static void drawGlyphs(PCCORE* pccore, int col, int row, unsigned char c, int color, int count) {
+    int bytes = glyphBytes(pccore);
+    int cols = textColumns(pccore);
+    int invert = (color & 0x80) != 0;
+    int line, i;
+
+    if (count > cols - col) {
+        count = cols - col;
+    }
+    for (line = 0; line < GLYPH_HEIGHT; line++) {
+        unsigned char bits = CGA_FONT_BOLD[c * GLYPH_HEIGHT + line];
+        unsigned char* dest = scanline(pccore, row * GLYPH_HEIGHT + line) + col * bytes;
+        unsigned char pattern[2];
+
+        if (bytes == 1) {
+            pattern[0] = (color & 1) ? bits : 0;
+        } else {
+            unsigned int pixels = widenGlyphRow(bits, color);
+            pattern[0] = (unsigned char)(pixels >> 8);
+            pattern[1] = (unsigned char)pixels;
+        }
+        for (i = 0; i < count * bytes; i++) {
+            dest[i] = invert ? (unsigned char)(dest[i] ^ pattern[i % bytes]) : pattern[i % bytes];
+        }
+    }
+}
+
+/**
+ * @brief Reads back the glyph at (col,row) by matching its lit pixels
+ * against the font. Returns 0 when nothing matches.
+ */
+static unsigned char readGlyph(PCCORE* pccore, int col, int row) {
+    int bytes = glyphBytes(pccore);
+    unsigned char shape[GLYPH_HEIGHT];
+    int line, c;
+
+    for (line = 0; line < GLYPH_HEIGHT; line++) {
+        const unsigned char* src = scanline(pccore, row * GLYPH_HEIGHT + line) + col * bytes;
+        unsigned char bits = src[0];
+
+        if (bytes == 2) {
+            unsigned int pixels = (src[0] << 8) | src[1];
+            int x;
+            bits = 0;
+            for (x = 0; x < 8; x++) {
+                if (pixels & (0xC000 >> (x * 2))) {
+                    bits |= (unsigned char)(0x80 >> x);
+                }
+            }
+        }
+        shape[line] = bits;
+    }
+    for (c = 0; c < 256; c++) {
+        if (memcmp(&CGA_FONT_BOLD[c * GLYPH_HEIGHT], shape, GLYPH_HEIGHT) == 0) {
+            return (unsigned char)c;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief scrollText for the graphics modes: one move per scanline span,
+ * uncovered lines filled with 'color'.
+ */
+static void scrollGlyphs(PCCORE* pccore, int left, int top, int right, int bottom,
+                         int lines, int color) {
+    int bytes = glyphBytes(pccore);
+    int cols = textColumns(pccore);
+    unsigned char fill;
+    int width, height, count, row, line;
+
+    if (right >= cols) {
+        right = cols - 1;
+    }
+    if (bottom >= TEXT_ROWS) {
+        bottom = TEXT_ROWS - 1;
+    }
+    if (left < 0 || top < 0 || left > right || top > bottom) {
+        return;
+    }
+    fill = bytes == 1 ? ((color & 1) ? 0xFF : 0x00) : (unsigned char)((color & 3) * 0x55);
+
+    width = (right - left + 1) * bytes;
+    height = bottom - top + 1;
+    count = lines < 0 ? -lines : lines;
+    if (count == 0 || count >= height) {
+        count = height;
+    }
+
+    for (row = 0; row < height - count; row++) {
+        // Upwards: fill from the top; downwards: from the bottom
+        int to = lines > 0 ? top + row : bottom - row;
+        int from = lines > 0 ? to + count : to - count;
+        for (line = 0; line < GLYPH_HEIGHT; line++) {
+            memmove(scanline(pccore, to * GLYPH_HEIGHT + line) + left * bytes,
+                    scanline(pccore, from * GLYPH_HEIGHT + line) + left * bytes, (size_t)width);
+        }
+    }
+    for (row = 0; row < count; row++) {
+        int to = lines > 0 ? bottom - row : top + row;
+        for (line = 0; line < GLYPH_HEIGHT; line++) {
+            memset(scanline(pccore, to * GLYPH_HEIGHT + line) + left * bytes, fill, (size_t)width);
+        }
+    }
+}
+
+/* --- Services --- */
+
+/**
+ * @brief AH=06h/07h: scrolls the window CH,CL - DH,DL of the active page.
+ */
+static void scrollWindow(PCCORE* pccore, union REGS* regs, int up) {
+    int lines = up ? regs->h.al : -regs->h.al;
+
+    if (isTextMode(pccore)) {
+        scrollText(pccore, regs->h.cl, regs->h.ch, regs->h.dl, regs->h.dh, lines, regs->h.bh);
+    } else {
+        scrollGlyphs(pccore, regs->h.cl, regs->h.ch, regs->h.dl, regs->h.dh, lines, regs->h.bh);
+    }
+}
+
+/**
+ * @brief AH=09h/0Ah: CX copies of AL at the cursor of page BH, which does
+ * not move. With 'attr' < 0 (0Ah) the attributes are left as they are.
+ */
+static void writeChars(PCCORE* pccore, int page, unsigned char c, int attr, int count) {
+    int cols = textColumns(pccore);
+    int col, row;
+
+    getPageCursor(pccore, page, &col, &row);
+    if (col >= cols || row >= TEXT_ROWS) {
+        return;
+    }
+
+    if (!isTextMode(pccore)) {
+        drawGlyphs(pccore, col, row, c, attr < 0 ? 0 : attr, count);
+        return;
+    }
+
+    {
+        unsigned short* cells = pageCells(pccore, page) + row * cols + col;
+        int room = (TEXT_ROWS - row) * cols - col;
+        int i;
+
+        if (count > room) {
+            count = room;
+        }
+        if (attr >= 0) {
+            fillCells(cells, (unsigned short)(c | (attr << 8)), count);
+        } else {
+            unsigned char* bytes = (unsigned char*)cells;
+            for (i = 0; i < count; i++) {
+                bytes[i * 2] = c;
+            }
+        }
+    }
+}
+
+/**
+ * @brief The teletype pass behind AH=0Eh and AH=13h.
+ *
+ * Bell, backspace, carriage return and line feed are obeyed; anything
+ * else is stored and the cursor advances, wrapping at the right edge and
+ * scrolling the page at the bottom. The cursor stays in (col,row) for
+ * the whole string and is stored back by the caller once.
+ *
+ * 'stride' is 2 when attributes follow each character in 'text'.
+ * Otherwise 'attr' is used, and in text modes a negative one keeps the
+ * attribute already on screen. In graphics modes it is the glyph color.
+ */
+static void teletype(PCCORE* pccore, int page, int* col, int* row,
+                     const unsigned char* text, int count, int stride, int attr) {
+    int cols = textColumns(pccore);
+    int text_mode = isTextMode(pccore);
+    unsigned short* cells = pageCells(pccore, page);
+    int x = *col, y = *row;
+    int i;
+
+    if (x >= cols) {
+        x = cols - 1;
+    }
+    if (y >= TEXT_ROWS) {
+        y = TEXT_ROWS - 1;
+    }
+
+    for (i = 0; i < count; i++) {
+        unsigned char c = text[i * stride];
+        int a = stride == 2 ? text[i * stride + 1] : attr;
+
+        switch (c) {
+            case '\a':
+                break;
+            case '\b':
+                if (x > 0) {
+                    x--;
+                }
+                break;
+            case '\r':
+                x = 0;
+                break;
+            case '\n':
+                y++;
+                break;
+            default:
+                if (!text_mode) {
+                    drawGlyphs(pccore, x, y, c, a < 0 ? 0 : a, 1);
+                } else if (a < 0) {
+                    ((unsigned char*)&cells[y * cols + x])[0] = c;
+                } else {
+                    cells[y * cols + x] = (unsigned short)(c | (a << 8));
+                }
+                if (++x >= cols) {
+                    x = 0;
+                    y++;
+                }
+                break;
+        }
+
+        if (y >= TEXT_ROWS) {
+            // The new line takes the attribute found under the cursor
+            y = TEXT_ROWS - 1;
+            if (text_mode) {
+                scrollCells(cells, cols, 0, 0, cols - 1, y, 1,
+                            (unsigned char)(cells[y * cols + x] >> 8));
+            } else {
+                scrollGlyphs(pccore, 0, 0, cols - 1, y, 1, 0);
+            }
+        }
+    }
+
+    *col = x;
+    *row = y;
+}
+
+/**
+ * @brief AH=13h: writes CX characters at DH,DL of page BH.
+ * AL bit 0 leaves the cursor after the string, bit 1 takes the attribute
+ * from the byte after each character instead of BL.
+ */
+static void writeString(PCCORE* pccore, union REGS* regs, const unsigned char* text) {
+    int page = regs->h.bh;
+    int col = regs->h.dl, row = regs->h.dh;
+    int stride = (regs->h.al & 2) ? 2 : 1;
+
+    if (text == NULL) {
+        return;
+    }
+    teletype(pccore, page, &col, &row, text, (int)regs->x.cx, stride, regs->h.bl);
+    if (regs->h.al & 1) {
+        setPageCursor(pccore, page, col, row);
+    }
+}
+
+/**
+ * @brief Points the CRTC start address at VRAM byte 'offset'.
+ */
+static void setDisplayStart(unsigned int offset) {
+    outportb(CGA_CRTC_INDEX_PORT, CGA_CRTC_START_HIGH);
+    outportb(CGA_CRTC_DATA_PORT, (unsigned char)((offset >> 9) & 0x3F));
+    outportb(CGA_CRTC_INDEX_PORT, CGA_CRTC_START_LOW);
+    outportb(CGA_CRTC_DATA_PORT, (unsigned char)(offset >> 1));
+}
+
+/**
+ * @brief AH=05h: shows page AL; only the text modes have more than one.
+ * The CRTC starts the display at the page, and conio and teletype
+ * output go to it from now on.
+ */
+static void selectPage(PCCORE* pccore, int page) {
+    unsigned int offset;
+
+    if (page >= pageCount(pccore)) {
+        return;
+    }
+    offset = page * bdaWord(pccore, BDA_VIDEO_PAGE_SIZE);
+    pccore->memory[BDA_ACTIVE_PAGE] = (unsigned char)page;
+    setBdaWord(pccore, BDA_VIDEO_PAGE_OFF, offset);
+    setDisplayStart(offset);
+}
+
+/**
+ * @brief Dispatches on AH. 'string' is ES:BP for AH=13h, NULL when the
+ * caller has no segment registers to give.
+ */
+static int videoService(union REGS *inregs, union REGS *outregs, const unsigned char *string)
 {
+    PCCORE* pccore = currentPCCore();
+    int page = inregs->h.bh & 7;
+    int col, row;
+
     /* Standard behavior: Copy input to output, then modify output as needed */
     if (inregs != outregs) {
         memcpy(outregs, inregs, sizeof(union REGS));
@@ -20,6 +370,80 @@ int int10(union REGS *inregs, union REGS *outregs)
             setVideoMode(inregs->h.al);
             break;
 
+        /* Function 01h: Set Cursor Shape (CH start line, CL end line) */
+        case 0x01:
+            setBdaWord(pccore, BDA_CURSOR_TYPE, inregs->x.cx);
+            break;
+
+        /* Function 02h: Set Cursor Position of page BH to DH,DL */
+        case 0x02:
+            setPageCursor(pccore, page, inregs->h.dl, inregs->h.dh);
+            break;
+
+        /* Function 03h: Get Cursor Position and Shape */
+        case 0x03:
+            getPageCursor(pccore, page, &col, &row);
+            outregs->h.dl = (unsigned char)col;
+            outregs->h.dh = (unsigned char)row;
+            outregs->x.cx = bdaWord(pccore, BDA_CURSOR_TYPE);
+            break;
+
+        /* Function 05h: Select Active Display Page */
+        case 0x05:
+            selectPage(pccore, inregs->h.al);
+            break;
+
+        /* Functions 06h/07h: Scroll Window Up / Down */
+        case 0x06:
+        case 0x07:
+            scrollWindow(pccore, inregs, inregs->h.ah == 0x06);
+            break;
+
+        /* Function 08h: Read Character and Attribute at Cursor */
+        case 0x08:
+            getPageCursor(pccore, page, &col, &row);
+            if (col >= textColumns(pccore) || row >= TEXT_ROWS) {
+                outregs->x.ax = 0;
+            } else if (isTextMode(pccore)) {
+                outregs->x.ax = pageCells(pccore, page)[row * textColumns(pccore) + col];
+            } else {
+                outregs->h.al = readGlyph(pccore, col, row);
+                outregs->h.ah = 0;
+            }
+            break;
+
+        /* Function 09h: Write Character and Attribute (BL), CX times */
+        case 0x09:
+            writeChars(pccore, page, inregs->h.al, inregs->h.bl, (int)inregs->x.cx);
+            break;
+
+        /* Function 0Ah: Write Character only, CX times */
+        case 0x0A:
+            writeChars(pccore, page, inregs->h.al,
+                       isTextMode(pccore) ? -1 : inregs->h.bl, (int)inregs->x.cx);
+            break;
+
+        /* Function 0Eh: Teletype Output (BL is the color in graphics) */
+        case 0x0E:
+            page = pccore->memory[BDA_ACTIVE_PAGE];
+            getPageCursor(pccore, page, &col, &row);
+            teletype(pccore, page, &col, &row, &inregs->h.al, 1, 1,
+                     isTextMode(pccore) ? -1 : inregs->h.bl);
+            setPageCursor(pccore, page, col, row);
+            break;
+
+        /* Function 0Fh: Get Video Mode (AL mode, AH columns, BH page) */
+        case 0x0F:
+            outregs->h.al = pccore->memory[BDA_VIDEO_MODE];
+            outregs->h.ah = pccore->memory[BDA_VIDEO_COLS];
+            outregs->h.bh = pccore->memory[BDA_ACTIVE_PAGE];
+            break;
+
+        /* Function 13h: Write String from ES:BP */
+        case 0x13:
+            writeString(pccore, inregs, string);
+            break;
+
         default:
             /* Unimplemented function */
             break;
@@ -28,43 +452,89 @@ int int10(union REGS *inregs, union REGS *outregs)
     return outregs->x.ax;
 }
 
+/**
+ * @brief Handler for INT 10h (Video BIOS Services).
+ * * Dispatches commands based on the value in AH.
+ */
+int int10(union REGS *inregs, union REGS *outregs)
+{
+    return videoService(inregs, outregs, NULL);
+}
+
+void int10r(struct REGPACK *preg)
+{
+    union REGS regs;
+
+    regs.x.ax = preg->r_ax;
+    regs.x.bx = preg->r_bx;
+    regs.x.cx = preg->r_cx;
+    regs.x.dx = preg->r_dx;
+    regs.x.si = preg->r_si;
+    regs.x.di = preg->r_di;
+    regs.x.cflag = 0;
+    regs.x.flags = preg->r_flags;
+
+    videoService(&regs, &regs, (const unsigned char*)MK_FP(preg->r_es, preg->r_bp));
+
+    preg->r_ax = regs.x.ax;
+    preg->r_bx = regs.x.bx;
+    preg->r_cx = regs.x.cx;
+    preg->r_dx = regs.x.dx;
+}
+
+/**
+ * @brief Mode Control Register (0x3D8) value for each BIOS mode.
+ *
+ * The usual BIOS values with the blink bit left clear (attribute bit 7
+ * selects bright backgrounds), as this core has always shown them.
+ * Writing it through the I/O bus switches the machine's mode.
+ */
+static const unsigned char modeControl[] = {
+    0x0C,   // 0: 40x25, its grey by default
+    0x08,   // 1: 40x25
+    0x0D,   // 2: 80x25, its grey by default
+    0x09,   // 3: 80x25
+    0x0A,   // 4: 320x200 4 colors
+    0x0E,   // 5: 320x200, its grey by default
+    0x1E    // 6: 640x200
+};
+
+/**
+ * @brief BDA columns and page size of each BIOS mode.
+ */
+static const unsigned char modeColumns[] = { 40, 40, 80, 80, 40, 40, 80 };
+static const unsigned short modePageSize[] = {
+    0x0800, 0x0800, 0x1000, 0x1000, 0x4000, 0x4000, 0x4000
+};
+
 void setVideoMode(int mode){
-    pccore.port[CGA_COLOR_REGISTER_PORT] = 0;
-    memset(&pccore.memory[CGA_VIDEO_RAM_START],0,CGA_BANK1_OFFSET*2);
-    switch (mode)
-    {
-    case 0:
-        pccore.mode = CGA40x25;
-        // its grey by default
-        pccore.port[CGA_MODE_CONTROL_PORT] = 0x04; 
-        break;    
-    case 1:
-        pccore.mode = CGA40x25;
-        pccore.port[CGA_MODE_CONTROL_PORT] = 0x00; 
-        break; 
-    case 2:
-        pccore.mode = CGA80x25;
-        // its grey by default
-        pccore.port[CGA_MODE_CONTROL_PORT] = 0x04; 
-        break;    
-    case 3:
-        pccore.mode = CGA80x25;
-        pccore.port[CGA_MODE_CONTROL_PORT] = 0x00; 
-        break;                     
-    case 4:
-        pccore.mode = CGA320x200x2;
-        pccore.port[CGA_MODE_CONTROL_PORT] = 0x00;        
-        break;
-    case 5:
-        pccore.mode = CGA320x200x2g;
-        // its grey by default
-        pccore.port[CGA_MODE_CONTROL_PORT] = 0x04; 
-        break;    
-    case 6:
-        pccore.mode = CGA640x200x1;
-        pccore.port[CGA_MODE_CONTROL_PORT] = 0x00; 
-        break;          
-    default:
-        break;
-    }
-}
\ No newline at end of file
+    PCCORE* pccore = currentPCCore();
+    // The BIOS palette: bright cyan/magenta/white, white pixels at 640x200
+    unsigned char color = mode == 6 ? 0x3F : 0x30;
+    int page;
+
+    // An unknown mode changes nothing, the screen included
+    if (mode < 0 || mode >= (int)sizeof(modeControl)) {
+        return;
+    }
+    memset(&pccore->memory[CGA_VIDEO_RAM_START],0,CGA_BANK1_OFFSET*2);
+
+    // Keep the BDA in step with the registers, as the BIOS does
+    pccore->memory[BDA_VIDEO_MODE] = (unsigned char)mode;
+    setBdaWord(pccore, BDA_VIDEO_COLS, modeColumns[mode]);
+    setBdaWord(pccore, BDA_VIDEO_PAGE_SIZE, modePageSize[mode]);
+    setBdaWord(pccore, BDA_VIDEO_PAGE_OFF, 0);
+    for (page = 0; page < 8; page++) {
+        setBdaWord(pccore, BDA_CURSOR_POS + page * 2, 0);
+    }
+    setBdaWord(pccore, BDA_CURSOR_TYPE, 0x0607);
+    pccore->memory[BDA_ACTIVE_PAGE] = 0;
+    setBdaWord(pccore, BDA_CRT_CONTROLLER, 0x3D4);
+    pccore->memory[BDA_MODE_SELECT_REG] = modeControl[mode];
+    pccore->memory[BDA_PALETTE_ID] = color;
+
+    setDisplayStart(0);
+    outportb(CGA_COLOR_REGISTER_PORT, color);
+    outportb(CGA_MODE_CONTROL_PORT, modeControl[mode]);
+    notifyVideoChange(pccore);
+}
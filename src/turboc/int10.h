@@ -13,6 +13,17 @@
  */
 int int10(union REGS *inregs, union REGS *outregs);
 
+/**
+ * @brief INT 10h with the full register set (intr): ES:BP is the string
+ * of function 13h.
+ */
+void int10r(struct REGPACK *preg);
+
+/**
+ * @brief Function 00h: programs 0x3D8/0x3D9 and the CRTC start address,
+ * clears VRAM and resets the video fields of the BIOS Data Area
+ * (0x449-0x466) to match the mode. Modes other than 0-6 are ignored.
+ */
 void setVideoMode(int mode);
 
 #endif /* INT10_H */
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "int1a.h"
+#include "../pccore/bda.h"
+#include "../pccore/speaker.h"
+
+/* ticks = ms * PIT_CLOCK_HZ / MS_TICK_DIVISOR */
+#define MS_TICK_DIVISOR (65536LL * 1000LL)
+
+long long localMillis(PCCORE* pccore) {
+    return __atomic_load_n(&pccore->time, __ATOMIC_RELAXED) + pccore->clock.local_offset_ms;
+}
+
+/**
+ * @brief Milliseconds since 1970-01-01 on the BIOS clock (local time
+ * moved by the last tick count set).
+ */
+static long long biosMillis(PCCORE* pccore) {
+    return localMillis(pccore) + pccore->clock.bios_adjust_ms;
+}
+
+/**
+ * @brief Floor division for the (rare) times before 1970.
+ */
+static long long floorDiv(long long a, long long b) {
+    return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+void localDosTime(PCCORE* pccore, DOSTIME* out) {
+    long long ms = localMillis(pccore);
+    long long days = floorDiv(ms, MS_PER_DAY);
+    long long rest = ms - days * MS_PER_DAY;
+    long long z, era, doe, yoe, doy, mp;
+
+    out->hour = (int)(rest / 3600000);
+    out->minute = (int)(rest / 60000 % 60);
+    out->second = (int)(rest / 1000 % 60);
+    out->hundredths = (int)(rest / 10 % 100);
+
+    // 1970-01-01 was a Thursday
+    out->weekday = (int)((days % 7 + 11) % 7);
+
+    // Civil date from a day count (proleptic Gregorian, eras of 400 years)
+    z = days + 719468;
+    era = floorDiv(z, 146097);
+    doe = z - era * 146097;
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    mp = (5 * doy + 2) / 153;
+    out->day = (int)(doy - (153 * mp + 2) / 5 + 1);
+    out->month = (int)(mp < 10 ? mp + 3 : mp - 9);
+    out->year = (int)(yoe + era * 400 + (out->month <= 2));
+}
+
+long biosTicks(PCCORE* pccore, int* midnight) {
+    long long ms = biosMillis(pccore);
+    long long day = floorDiv(ms, MS_PER_DAY);
+    long ticks = (long)((ms - day * MS_PER_DAY) * (long long)PIT_CLOCK_HZ / MS_TICK_DIVISOR);
+    unsigned char* bda = &pccore->memory[BDA_TIMER_TICKS];
+
+    if (midnight != NULL) {
+        *midnight = pccore->clock.bios_day != 0 && day != pccore->clock.bios_day;
+        pccore->clock.bios_day = day;
+    }
+
+    bda[0] = (unsigned char)ticks;
+    bda[1] = (unsigned char)(ticks >> 8);
+    bda[2] = (unsigned char)(ticks >> 16);
+    bda[3] = (unsigned char)(ticks >> 24);
+    return ticks;
+}
+
+void setBiosTicks(PCCORE* pccore, long ticks) {
+    long long ms = localMillis(pccore);
+    long long sinceMidnight = ms - floorDiv(ms, MS_PER_DAY) * MS_PER_DAY;
+
+    if (ticks < 0 || ticks >= BIOS_TICKS_PER_DAY) {
+        ticks = 0;
+    }
+    pccore->clock.bios_adjust_ms = ticks * MS_TICK_DIVISOR / (long long)PIT_CLOCK_HZ - sinceMidnight;
+    pccore->clock.bios_day = floorDiv(biosMillis(pccore), MS_PER_DAY);
+    biosTicks(pccore, NULL);
+}
+
+int int1a(union REGS *inregs, union REGS *outregs) {
+    PCCORE* pccore = currentPCCore();
+    union REGS regs = *inregs;
+
+    switch (regs.h.ah) {
+        case 0x00: {
+            int midnight;
+            long ticks = biosTicks(pccore, &midnight);
+            regs.x.cx = (unsigned short)(ticks >> 16);
+            regs.x.dx = (unsigned short)ticks;
+            regs.h.al = (unsigned char)midnight;
+            break;
+        }
+        case 0x01:
+            setBiosTicks(pccore, ((long)regs.x.cx << 16) | regs.x.dx);
+            break;
+        default:
+            break;
+    }
+    *outregs = regs;
+    return regs.x.ax;
+}
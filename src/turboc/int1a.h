@@ -0,0 +1,59 @@
+#ifndef INT1A_H
+#define INT1A_H
+
+#include "dos.h"
+#include "../pccore/pccore.h"
+
+/*
+ * BIOS time of day (INT 1Ah) and the local date and time the DOS and
+ * Turbo C time functions report, all derived from pccore.time: one
+ * atomic load per call, no system call.
+ *
+ * The BIOS counts PIT_CLOCK_HZ / 65536 (about 18.2) ticks per second,
+ * 0x1800B0 per day, from local midnight.
+ */
+
+#define BIOS_TICKS_PER_DAY 0x1800B0L
+#define MS_PER_DAY 86400000LL
+
+/**
+ * @brief A local date and time, split up.
+ */
+typedef struct {
+    int year, month, day;       // month and day from 1
+    int weekday;                // 0 = Sunday
+    int hour, minute, second, hundredths;
+} DOSTIME;
+
+/**
+ * @brief Emulates the BIOS Interrupt 0x1A time of day functions:
+ * AH=00h reads the tick count into CX:DX (AL = 1 if midnight passed
+ * since the last read), AH=01h sets it from CX:DX.
+ *
+ * @return The value of AX after the interrupt.
+ */
+int int1a(union REGS *inregs, union REGS *outregs);
+
+/**
+ * @brief Local wall time, in milliseconds since 1970-01-01 00:00.
+ */
+long long localMillis(PCCORE* pccore);
+
+/**
+ * @brief Splits the local time into date and time fields.
+ */
+void localDosTime(PCCORE* pccore, DOSTIME* out);
+
+/**
+ * @brief Ticks since midnight, also stored in the BIOS Data Area
+ * (0x46C). If 'midnight' is not NULL it is set to 1 when a day has
+ * passed since the previous such call, 0 otherwise.
+ */
+long biosTicks(PCCORE* pccore, int* midnight);
+
+/**
+ * @brief Makes the tick count read 'ticks' now.
+ */
+void setBiosTicks(PCCORE* pccore, long ticks);
+
+#endif /* INT1A_H */
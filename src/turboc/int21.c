@@ -0,0 +1,461 @@
+#include "int21.h"
+#include "int1a.h"
+#include "arena.h"
+#include "../pccore/checkpoint.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Longest path name accepted, terminator included */
+#define DOS_PATH_SIZE 260
+
+/**
+ * @brief The open file behind 'handle', NULL if there is none.
+ */
+static DOSFILE* dosFile(int handle) {
+    DOSFILE* file;
+
+    if (handle < DOS_FIRST_FILE || handle >= DOS_FILES) {
+        return NULL;
+    }
+    file = &currentPCCore()->files[handle];
+    return file->open ? file : NULL;
+}
+
+/**
+ * @brief DOS error code for a failed host call.
+ */
+static long dosError(int error) {
+    switch (error) {
+        case ENOENT:
+            return -DOSERR_FILE_NOT_FOUND;
+        case ENOTDIR:
+        case ENAMETOOLONG:
+            return -DOSERR_PATH_NOT_FOUND;
+        case EMFILE:
+        case ENFILE:
+            return -DOSERR_TOO_MANY_FILES;
+        case EBADF:
+            return -DOSERR_INVALID_HANDLE;
+        default:
+            return -DOSERR_ACCESS_DENIED;
+    }
+}
+
+/**
+ * @brief Turns a DOS path into a host path: drive letter dropped, '\'
+ * turned into '/', and each component that does not exist as written
+ * replaced by a directory entry matching it without regard to case.
+ * A missing last component is kept as written (for create).
+ */
+static int hostPath(const char *path, char *host, size_t size) {
+    size_t length = 0;
+
+    if (isalpha((unsigned char)path[0]) && path[1] == ':') {
+        path += 2;
+    }
+    if (*path == '\\' || *path == '/') {
+        host[length++] = '/';
+        path++;
+    }
+
+    while (*path != '\0') {
+        size_t start = length, name;
+        struct stat st;
+
+        // Copy one component
+        while (*path != '\0' && *path != '\\' && *path != '/') {
+            if (length + 2 >= size) {
+                return -1;
+            }
+            host[length++] = *path++;
+        }
+        host[length] = '\0';
+        name = length - start;
+
+        if (name > 0 && stat(host, &st) != 0) {
+            char first = host[start];
+            DIR* dir;
+            struct dirent* entry;
+
+            // Look in the directory so far
+            host[start] = '\0';
+            dir = opendir(start > 0 ? host : ".");
+            host[start] = first;
+            if (dir != NULL) {
+                while ((entry = readdir(dir)) != NULL) {
+                    if (strlen(entry->d_name) == name &&
+                        strncasecmp(entry->d_name, host + start, name) == 0) {
+                        memcpy(host + start, entry->d_name, name);
+                        break;
+                    }
+                }
+                closedir(dir);
+            }
+        }
+
+        if (*path != '\0') {
+            host[length++] = '/';
+            path++;
+        }
+    }
+    host[length] = '\0';
+    return 0;
+}
+
+/**
+ * @brief Opens a DOS path on the host (see hostPath).
+ */
+static int openHost(const char *path, int flags, int mode) {
+    char host[DOS_PATH_SIZE];
+
+    if (hostPath(path, host, sizeof(host)) != 0) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    return open(host, flags, mode);
+}
+
+/**
+ * @brief Puts a host descriptor in the first free handle.
+ */
+static long addFile(int fd, int access) {
+    PCCORE* pccore = currentPCCore();
+    struct stat st;
+    int handle;
+
+    for (handle = DOS_FIRST_FILE; handle < DOS_FILES; handle++) {
+        if (!pccore->files[handle].open) {
+            break;
+        }
+    }
+    if (handle == DOS_FILES) {
+        close(fd);
+        return -DOSERR_TOO_MANY_FILES;
+    }
+    if (fstat(fd, &st) != 0 || S_ISDIR(st.st_mode)) {
+        close(fd);
+        return -DOSERR_ACCESS_DENIED;
+    }
+
+    DOSFILE* file = &pccore->files[handle];
+    memset(file, 0, sizeof(*file));
+    file->open = 1;
+    file->fd = fd;
+    file->access = access;
+
+    if (access == 0 && st.st_size >= DOS_MAP_MIN_SIZE) {
+        void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+            file->map = (const unsigned char*)map;
+            file->map_size = st.st_size;
+        }
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    if (file->map == NULL) {
+        // Most DOS programs read their files front to back
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+#endif
+    return handle;
+}
+
+long dosCreate(const char *path, int attributes) {
+    // Attribute bit 0: read-only (for later opens, not for this handle)
+    int fd = openHost(path, O_RDWR | O_CREAT | O_TRUNC, (attributes & 1) ? 0444 : 0644);
+
+    if (fd < 0) {
+        // A missing file is created: only its directory can be missing
+        return errno == ENOENT ? -DOSERR_PATH_NOT_FOUND : dosError(errno);
+    }
+    return addFile(fd, 2);
+}
+
+long dosOpen(const char *path, int access) {
+    static const int flags[3] = { O_RDONLY, O_WRONLY, O_RDWR };
+    int fd;
+
+    if (access < 0 || access > 2) {
+        return -DOSERR_INVALID_ACCESS;
+    }
+    fd = openHost(path, flags[access], 0);
+    return fd < 0 ? dosError(errno) : addFile(fd, access);
+}
+
+long dosClose(int handle) {
+    DOSFILE* file = dosFile(handle);
+
+    if (file == NULL) {
+        return handle >= 0 && handle < DOS_FIRST_FILE ? 0 : -DOSERR_INVALID_HANDLE;
+    }
+    if (file->map != NULL) {
+        munmap((void*)file->map, (size_t)file->map_size);
+    }
+    free(file->buffer);
+    close(file->fd);
+    memset(file, 0, sizeof(*file));
+    return 0;
+}
+
+/**
+ * @brief pread until 'count' bytes or end of file.
+ */
+static long readAt(int fd, unsigned char* buffer, size_t count, long long position) {
+    size_t done = 0;
+
+    // The kernel does not trap on write-protected guest pages: unlock them
+    prepareGuestWrite(buffer, count);
+    while (done < count) {
+        ssize_t n = pread(fd, buffer + done, count - done, (off_t)(position + done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return done > 0 ? (long)done : dosError(errno);
+        }
+        if (n == 0) {
+            break;
+        }
+        done += (size_t)n;
+    }
+    return (long)done;
+}
+
+long dosRead(int handle, void *buffer, unsigned count) {
+    DOSFILE* file = dosFile(handle);
+    unsigned char* out = (unsigned char*)buffer;
+    unsigned done = 0;
+    long n;
+
+    if (file == NULL) {
+        // Standard input is at end of file; the other devices have nothing
+        return handle >= 0 && handle < DOS_FIRST_FILE ? 0 : -DOSERR_INVALID_HANDLE;
+    }
+    if (file->access == 1) {
+        return -DOSERR_ACCESS_DENIED;
+    }
+
+    if (file->map != NULL) {
+        long long left = file->map_size - file->position;
+        if (left <= 0) {
+            return 0;
+        }
+        if ((long long)count > left) {
+            count = (unsigned)left;
+        }
+        memcpy(out, file->map + file->position, count);
+        file->position += count;
+        return count;
+    }
+
+    // What the read-ahead buffer already has
+    if (file->buffer_length > 0 && file->position >= file->buffer_start &&
+        file->position < file->buffer_start + file->buffer_length) {
+        long long from = file->position - file->buffer_start;
+        done = (unsigned)(file->buffer_length - from);
+        if (done > count) {
+            done = count;
+        }
+        memcpy(out, file->buffer + from, done);
+        file->position += done;
+    }
+    if (done == count) {
+        return count;
+    }
+
+    // Large reads go straight to the destination
+    if (count - done >= DOS_READAHEAD) {
+        n = readAt(file->fd, out + done, count - done, file->position);
+        if (n < 0) {
+            return done > 0 ? (long)done : n;
+        }
+        file->position += n;
+        return done + n;
+    }
+
+    // Small ones refill the buffer
+    if (file->buffer == NULL) {
+        file->buffer = (unsigned char*)malloc(DOS_READAHEAD);
+        if (file->buffer == NULL) {
+            n = readAt(file->fd, out + done, count - done, file->position);
+            if (n > 0) {
+                file->position += n;
+            }
+            return n < 0 ? (done > 0 ? (long)done : n) : done + n;
+        }
+    }
+    n = readAt(file->fd, file->buffer, DOS_READAHEAD, file->position);
+    if (n < 0) {
+        file->buffer_length = 0;
+        return done > 0 ? (long)done : n;
+    }
+    file->buffer_start = file->position;
+    file->buffer_length = (int)n;
+    if (n > (long)(count - done)) {
+        n = count - done;
+    }
+    memcpy(out + done, file->buffer, (size_t)n);
+    file->position += n;
+    return done + n;
+}
+
+long dosWrite(int handle, const void *buffer, unsigned count) {
+    DOSFILE* file = dosFile(handle);
+    const unsigned char* in = (const unsigned char*)buffer;
+    unsigned done = 0;
+
+    if (file == NULL) {
+        if (handle == 1 || handle == 2) {
+            ssize_t n = write(handle, buffer, count);
+            return n < 0 ? dosError(errno) : n;
+        }
+        return handle >= 0 && handle < DOS_FIRST_FILE ? (long)count : -DOSERR_INVALID_HANDLE;
+    }
+    if (file->access == 0) {
+        return -DOSERR_ACCESS_DENIED;
+    }
+    file->buffer_length = 0;
+
+    // Writing nothing sets the file size to the file pointer
+    if (count == 0) {
+        return ftruncate(file->fd, (off_t)file->position) == 0 ? 0 : dosError(errno);
+    }
+
+    while (done < count) {
+        ssize_t n = pwrite(file->fd, in + done, count - done, (off_t)(file->position + done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (done == 0) {
+                return dosError(errno);
+            }
+            break;
+        }
+        done += (unsigned)n;
+    }
+    file->position += done;
+    return done;
+}
+
+long dosSeek(int handle, long offset, int origin) {
+    DOSFILE* file = dosFile(handle);
+    long long position;
+
+    if (file == NULL) {
+        return handle >= 0 && handle < DOS_FIRST_FILE ? 0 : -DOSERR_INVALID_HANDLE;
+    }
+
+    switch (origin) {
+        case 0:
+            position = offset;
+            break;
+        case 1:
+            position = file->position + offset;
+            break;
+        case 2: {
+            struct stat st;
+            if (file->map != NULL) {
+                position = file->map_size + offset;
+            } else if (fstat(file->fd, &st) == 0) {
+                position = st.st_size + offset;
+            } else {
+                return dosError(errno);
+            }
+            break;
+        }
+        default:
+            return -DOSERR_FUNCTION;
+    }
+    if (position < 0 || position > 0xFFFFFFFFLL) {
+        return -DOSERR_FUNCTION;
+    }
+    file->position = position;
+    return (long)position;
+}
+
+int int21(union REGS *inregs, union REGS *outregs, struct SREGS *segregs) {
+    union REGS regs = *inregs;
+    unsigned int ds = segregs != NULL ? segregs->ds : 0;
+    unsigned int es = segregs != NULL ? segregs->es : 0;
+    void* data = MK_FP(ds, regs.x.dx);
+    unsigned available;
+    DOSTIME now;
+    long result;
+
+    regs.x.cflag = 0;
+    switch (regs.h.ah) {
+        case 0x2A:
+            localDosTime(currentPCCore(), &now);
+            regs.x.cx = (unsigned short)now.year;
+            regs.h.dh = (unsigned char)now.month;
+            regs.h.dl = (unsigned char)now.day;
+            regs.h.al = (unsigned char)now.weekday;
+            *outregs = regs;
+            return regs.x.ax;
+        case 0x2C:
+            localDosTime(currentPCCore(), &now);
+            regs.h.ch = (unsigned char)now.hour;
+            regs.h.cl = (unsigned char)now.minute;
+            regs.h.dh = (unsigned char)now.second;
+            regs.h.dl = (unsigned char)now.hundredths;
+            *outregs = regs;
+            return regs.x.ax;
+        case 0x3C:
+            result = dosCreate((const char*)data, regs.x.cx);
+            break;
+        case 0x3D:
+            result = dosOpen((const char*)data, regs.h.al & 7);
+            break;
+        case 0x3E:
+            result = dosClose(regs.x.bx);
+            break;
+        case 0x3F:
+            // DS:DX near the top of memory: no further than its end
+            result = dosRead(regs.x.bx, data, guestLength(data, regs.x.cx));
+            break;
+        case 0x40:
+            result = dosWrite(regs.x.bx, data, guestLength(data, regs.x.cx));
+            break;
+        case 0x42:
+            // CX:DX is a signed 32-bit offset; the new position comes back in DX:AX
+            result = dosSeek(regs.x.bx, (long)(int)(((unsigned int)regs.x.cx << 16) | regs.x.dx),
+                             regs.h.al);
+            if (result >= 0) {
+                regs.x.dx = (unsigned short)((unsigned long)result >> 16);
+            }
+            break;
+        case 0x48:
+            result = dosAllocate(currentPCCore(), regs.x.bx, &available);
+            if (result == -DOSERR_NOT_ENOUGH_MEMORY) {
+                regs.x.bx = (unsigned short)available;
+            }
+            break;
+        case 0x49:
+            result = dosFree(currentPCCore(), es);
+            break;
+        case 0x4A:
+            result = dosResize(currentPCCore(), es, regs.x.bx, &available);
+            if (result == -DOSERR_NOT_ENOUGH_MEMORY) {
+                regs.x.bx = (unsigned short)available;
+            }
+            break;
+        default:
+            result = -DOSERR_FUNCTION;
+            break;
+    }
+
+    regs.x.cflag = result < 0;
+    regs.x.ax = (unsigned short)(result < 0 ? -result : result);
+    *outregs = regs;
+    return regs.x.ax;
+}
@@ -0,0 +1,64 @@
+#ifndef INT21_H
+#define INT21_H
+
+#include "dos.h"
+#include "../pccore/pccore.h"
+
+/*
+ * DOS file services over host files.
+ *
+ * DOS handles index the machine's DOSFILE table; each open handle owns a
+ * host descriptor. Paths lose their drive letter and take '/' for '\';
+ * a name that does not exist as written matches without regard to case.
+ *
+ * Read-only handles on files of DOS_MAP_MIN_SIZE bytes or more are
+ * mapped, so a read is one memcpy from the page cache. Other handles
+ * read at their file pointer with pread: small reads are served from a
+ * DOS_READAHEAD buffer, larger ones go straight into the destination.
+ *
+ * Handles 0-4 are the standard devices: 1 and 2 write to the host's
+ * stdout and stderr, 0 reads as end of file, closing them does nothing.
+ */
+
+#define DOS_MAP_MIN_SIZE 0x40000
+#define DOS_READAHEAD 0x4000
+
+/* First handle given to files */
+#define DOS_FIRST_FILE 5
+
+/* Error codes (AX with the carry flag set) */
+#define DOSERR_FUNCTION 0x01
+#define DOSERR_FILE_NOT_FOUND 0x02
+#define DOSERR_PATH_NOT_FOUND 0x03
+#define DOSERR_TOO_MANY_FILES 0x04
+#define DOSERR_ACCESS_DENIED 0x05
+#define DOSERR_INVALID_HANDLE 0x06
+#define DOSERR_INVALID_ACCESS 0x0C
+
+/**
+ * @brief Emulates the DOS Interrupt 0x21 file functions: 3Ch create,
+ * 3Dh open, 3Eh close, 3Fh read, 40h write, 42h seek; 2Ah get date,
+ * 2Ch get time (local time, see int1a.h); and 48h allocate, 49h free,
+ * 4Ah resize memory (BX paragraphs, block at ES; see arena.h).
+ *
+ * Buffers and path names are at DS:DX; DS and ES come from 'segregs'
+ * (0 if NULL). When 48h or 4Ah fail for lack of memory, BX holds the
+ * largest size available.
+ * On error the carry flag (x.cflag) is set and AX holds the error code.
+ *
+ * @return The value of AX after the interrupt.
+ */
+int int21(union REGS *inregs, union REGS *outregs, struct SREGS *segregs);
+
+/*
+ * The same services on host pointers, for io.c. Each returns its result
+ * (handle, byte count, position) or the negated error code.
+ */
+long dosCreate(const char *path, int attributes);
+long dosOpen(const char *path, int access);
+long dosClose(int handle);
+long dosRead(int handle, void *buffer, unsigned count);
+long dosWrite(int handle, const void *buffer, unsigned count);
+long dosSeek(int handle, long offset, int origin);
+
+#endif /* INT21_H */
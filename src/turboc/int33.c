@@ -0,0 +1,173 @@
+#include "int33.h"
+#include "../pccore/mouse.h"
+
+/* Mickeys per mouse coordinate: 8 per 8 pixels across, 16 per 8 down */
+#define MICKEYS_X 1
+#define MICKEYS_Y 2
+
+static void setLimits(int* min, int* max, int a, int b) {
+    __atomic_store_n(min, a < b ? a : b, __ATOMIC_RELAXED);
+    __atomic_store_n(max, a < b ? b : a, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief AX=00h: cursor hidden, on the pointer, limits the whole screen.
+ */
+static void resetMouse(PCCORE* pccore) {
+    MOUSESTATE* mouse = &pccore->mouse;
+    unsigned long long host = __atomic_load_n(&mouse->host, __ATOMIC_ACQUIRE);
+    int i;
+
+    __atomic_store_n(&mouse->cursor, -1, __ATOMIC_RELAXED);
+    __atomic_store_n(&mouse->offset_x, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&mouse->offset_y, 0, __ATOMIC_RELAXED);
+    setLimits(&mouse->min_x, &mouse->max_x, 0, MOUSE_WIDTH - 1);
+    setLimits(&mouse->min_y, &mouse->max_y, 0, MOUSE_HEIGHT - 1);
+    mouse->mickey_x = MOUSE_HOST_X(host);
+    mouse->mickey_y = MOUSE_HOST_Y(host);
+    mouse->call_mask = 0;
+    mouse->handler = NULL;
+    __atomic_store_n(&mouse->reset, 1, __ATOMIC_RELEASE);
+    for (i = 0; i < MOUSE_BUTTONS; i++) {
+        mouse->handler_presses[i] = __atomic_load_n(&mouse->presses[i], __ATOMIC_RELAXED);
+        mouse->handler_releases[i] = __atomic_load_n(&mouse->releases[i], __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief The cursor position as AX=03h reports it.
+ */
+static void cursorPosition(PCCORE* pccore, unsigned long long host, int* x, int* y) {
+    mousePosition(pccore, host, x, y);
+    if (pccore->mode == CGA80x25) {
+        *x &= ~7;
+        *y &= ~7;
+    } else if (pccore->mode == CGA40x25) {
+        *x &= ~15;
+        *y &= ~7;
+    }
+}
+
+int int33(union REGS *inregs, union REGS *outregs) {
+    PCCORE* pccore = currentPCCore();
+    MOUSESTATE* mouse = &pccore->mouse;
+    union REGS regs = *inregs;
+    unsigned long long host;
+    int x, y;
+
+    if (!mouse->reset) {
+        resetMouse(pccore);
+    }
+
+    switch (regs.x.ax) {
+        case 0x00:
+            resetMouse(pccore);
+            regs.x.ax = 0xFFFF;
+            regs.x.bx = MOUSE_BUTTONS;
+            break;
+        case 0x01:
+            if (mouse->cursor < 0) {
+                __atomic_store_n(&mouse->cursor, mouse->cursor + 1, __ATOMIC_RELAXED);
+            }
+            break;
+        case 0x02:
+            __atomic_store_n(&mouse->cursor, mouse->cursor - 1, __ATOMIC_RELAXED);
+            break;
+        case 0x03:
+            host = __atomic_load_n(&mouse->host, __ATOMIC_ACQUIRE);
+            cursorPosition(pccore, host, &x, &y);
+            regs.x.bx = (unsigned short)MOUSE_HOST_BUTTONS(host);
+            regs.x.cx = (unsigned short)x;
+            regs.x.dx = (unsigned short)y;
+            break;
+        case 0x04:
+            // Clamped now, so the cursor stays where it was put until the pointer moves
+            host = __atomic_load_n(&mouse->host, __ATOMIC_ACQUIRE);
+            x = (short)regs.x.cx;
+            y = (short)regs.x.dx;
+            x = x < mouse->min_x ? mouse->min_x : x > mouse->max_x ? mouse->max_x : x;
+            y = y < mouse->min_y ? mouse->min_y : y > mouse->max_y ? mouse->max_y : y;
+            __atomic_store_n(&mouse->offset_x, x - MOUSE_HOST_X(host), __ATOMIC_RELAXED);
+            __atomic_store_n(&mouse->offset_y, y - MOUSE_HOST_Y(host), __ATOMIC_RELAXED);
+            break;
+        case 0x07:
+            setLimits(&mouse->min_x, &mouse->max_x, (short)regs.x.cx, (short)regs.x.dx);
+            break;
+        case 0x08:
+            setLimits(&mouse->min_y, &mouse->max_y, (short)regs.x.cx, (short)regs.x.dx);
+            break;
+        case 0x0B:
+            host = __atomic_load_n(&mouse->host, __ATOMIC_ACQUIRE);
+            regs.x.cx = (unsigned short)((MOUSE_HOST_X(host) - mouse->mickey_x) * MICKEYS_X);
+            regs.x.dx = (unsigned short)((MOUSE_HOST_Y(host) - mouse->mickey_y) * MICKEYS_Y);
+            mouse->mickey_x = MOUSE_HOST_X(host);
+            mouse->mickey_y = MOUSE_HOST_Y(host);
+            break;
+        case 0x0C:
+            mouse->call_mask = regs.x.cx;
+            break;
+        default:
+            break;
+    }
+
+    *outregs = regs;
+    return regs.x.ax;
+}
+
+void setmousehandler(unsigned mask, MOUSEHANDLER handler) {
+    PCCORE* pccore = currentPCCore();
+    MOUSESTATE* mouse = &pccore->mouse;
+    int i;
+
+    if (!mouse->reset) {
+        resetMouse(pccore);
+    }
+    mouse->call_mask = handler != NULL ? mask : 0;
+    mouse->handler = handler;
+    // Conditions count from now on
+    mouse->handler_host = __atomic_load_n(&mouse->host, __ATOMIC_ACQUIRE);
+    for (i = 0; i < MOUSE_BUTTONS; i++) {
+        mouse->handler_presses[i] = __atomic_load_n(&mouse->presses[i], __ATOMIC_RELAXED);
+        mouse->handler_releases[i] = __atomic_load_n(&mouse->releases[i], __ATOMIC_RELAXED);
+    }
+}
+
+void pollMouseHandler(PCCORE* pccore) {
+    MOUSESTATE* mouse = &pccore->mouse;
+    unsigned long long host;
+    unsigned events = 0;
+    unsigned presses, releases;
+    int i, x, y, lastX, lastY;
+
+    if (mouse->handler == NULL || mouse->call_mask == 0) {
+        return;
+    }
+    host = __atomic_load_n(&mouse->host, __ATOMIC_ACQUIRE);
+    if (host == mouse->handler_host) {
+        return;
+    }
+
+    cursorPosition(pccore, host, &x, &y);
+    cursorPosition(pccore, mouse->handler_host, &lastX, &lastY);
+    if (x != lastX || y != lastY) {
+        events |= MOUSE_MOVED;
+    }
+    for (i = 0; i < MOUSE_BUTTONS; i++) {
+        presses = __atomic_load_n(&mouse->presses[i], __ATOMIC_RELAXED);
+        releases = __atomic_load_n(&mouse->releases[i], __ATOMIC_RELAXED);
+        if (presses != mouse->handler_presses[i]) {
+            events |= MOUSE_LEFT_PRESSED << (2 * i);
+        }
+        if (releases != mouse->handler_releases[i]) {
+            events |= MOUSE_LEFT_RELEASED << (2 * i);
+        }
+        mouse->handler_presses[i] = presses;
+        mouse->handler_releases[i] = releases;
+    }
+    mouse->handler_host = host;
+
+    events &= mouse->call_mask;
+    if (events != 0) {
+        mouse->handler(events, MOUSE_HOST_BUTTONS(host), x, y);
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef INT33_H
+#define INT33_H
+
+#include "dos.h"
+#include "../pccore/pccore.h"
+
+/*
+ * Mouse driver (INT 33h) over the wrapper's pointer (see mouse.h).
+ *
+ * Positions are 640x200 mouse coordinates in every CGA mode; in text
+ * modes they are multiples of the character cell (8x8, 16x8 in 40
+ * columns). The cursor follows the host pointer until AX=04h moves it,
+ * after which it keeps that offset from the pointer.
+ *
+ * Reading the state (AX=03h) is one atomic load of the pointer word: a
+ * program polling it in a tight loop costs no more than that, and never
+ * sees a backlog of motion events.
+ */
+
+/* Condition bits of AX=0Ch (and of the handler's 'events') */
+#define MOUSE_MOVED 0x01
+#define MOUSE_LEFT_PRESSED 0x02
+#define MOUSE_LEFT_RELEASED 0x04
+#define MOUSE_RIGHT_PRESSED 0x08
+#define MOUSE_RIGHT_RELEASED 0x10
+#define MOUSE_MIDDLE_PRESSED 0x20
+#define MOUSE_MIDDLE_RELEASED 0x40
+
+/**
+ * @brief Emulates the mouse driver: AX=00h reset (AX=FFFFh, BX=3
+ * buttons), 01h show cursor, 02h hide cursor, 03h position (CX, DX)
+ * and buttons (BX), 04h set position, 07h/08h horizontal/vertical
+ * limits (CX to DX), 0Bh motion in mickeys since the last call (CX, DX),
+ * 0Ch call mask (CX; the handler itself is a host function, see
+ * setmousehandler).
+ *
+ * @return The value of AX after the interrupt.
+ */
+int int33(union REGS *inregs, union REGS *outregs);
+
+/*
+ * setmousehandler - INT 33h AX=0Ch for a C function: 'handler' is called
+ * on the DOS thread, from delay(), when any condition in 'mask' occurred
+ * since its last call. Motion in between is coalesced: one call reports
+ * every condition seen and the newest position. NULL or a 0 mask removes it.
+ */
+void setmousehandler(unsigned mask, MOUSEHANDLER handler);
+
+/**
+ * @brief Calls the mouse handler if its conditions occurred. Constant
+ * time, however many events arrived.
+ */
+void pollMouseHandler(PCCORE* pccore);
+
+#endif /* INT33_H */
@@ -0,0 +1,56 @@
+#include "io.h"
+#include "int21.h"
+
+#include <errno.h>
+
+int _doserrno = 0;
+
+/**
+ * @brief Passes a result through, or turns a DOS error into -1 with
+ * errno and _doserrno set.
+ */
+static int ioResult(long result) {
+    if (result >= 0) {
+        return (int)result;
+    }
+    _doserrno = (int)-result;
+    switch (_doserrno) {
+        case DOSERR_FILE_NOT_FOUND:
+        case DOSERR_PATH_NOT_FOUND:
+            errno = ENOENT;
+            break;
+        case DOSERR_TOO_MANY_FILES:
+            errno = EMFILE;
+            break;
+        case DOSERR_INVALID_HANDLE:
+            errno = EBADF;
+            break;
+        case DOSERR_INVALID_ACCESS:
+            errno = EINVAL;
+            break;
+        default:
+            errno = EACCES;
+            break;
+    }
+    return -1;
+}
+
+int _open(const char *path, int oflags) {
+    return ioResult(dosOpen(path, oflags & 3));
+}
+
+int _creat(const char *path, int attrib) {
+    return ioResult(dosCreate(path, attrib));
+}
+
+int _close(int handle) {
+    return ioResult(dosClose(handle));
+}
+
+int _read(int handle, void *buf, unsigned len) {
+    return ioResult(dosRead(handle, buf, len));
+}
+
+int _write(int handle, const void *buf, unsigned len) {
+    return ioResult(dosWrite(handle, buf, len));
+}
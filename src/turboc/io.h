@@ -0,0 +1,34 @@
+#ifndef _IO_H
+#define _IO_H
+
+/*
+ * Low-level file I/O on DOS handles (the INT 21h services, see int21.h).
+ * Buffers are ordinary pointers, in guest memory (MK_FP) or not.
+ *
+ * On error these return -1 and set errno and _doserrno (dos.h).
+ */
+
+/*
+ * _open - Opens an existing file. 'oflags' is O_RDONLY, O_WRONLY or
+ * O_RDWR; the host's fcntl.h values are DOS's access codes.
+ * Returns the handle.
+ */
+int _open(const char *path, int oflags);
+
+/*
+ * _creat - Creates or truncates a file and opens it for reading and
+ * writing. Bit 0 of 'attrib' makes it read-only for later opens.
+ */
+int _creat(const char *path, int attrib);
+
+int _close(int handle);
+
+/*
+ * _read / _write - Transfer up to 'len' bytes at the file pointer.
+ * Return the number of bytes transferred, 0 at end of file.
+ * _write with 'len' 0 cuts the file at the file pointer.
+ */
+int _read(int handle, void *buf, unsigned len);
+int _write(int handle, const void *buf, unsigned len);
+
+#endif /* _IO_H */
@@ -0,0 +1,329 @@
+#include "raster.h"
+#include "graphics.h"
+#include "../pccore/cga.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Zero bytes around a row copy, so 64-bit reads may run past either end */
+#define ROW_PAD 8
+
+/* Bits of a byte from bit 'phase' on (leftmost is bit 7), and up to it */
+static const unsigned char leftMasks[8] = { 0xFF, 0x7F, 0x3F, 0x1F, 0x0F, 0x07, 0x03, 0x01 };
+static const unsigned char rightMasks[8] = { 0x80, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC, 0xFE, 0xFF };
+
+#define ROW(y)  (((y) & 1) * CGA_BANK1_OFFSET + ((y) >> 1) * CGA_BYTES_PER_LINE)
+#define ROW8(y) ROW(y), ROW(y + 1), ROW(y + 2), ROW(y + 3), \
+                ROW(y + 4), ROW(y + 5), ROW(y + 6), ROW(y + 7)
+
+const unsigned short rasterRows[RASTER_HEIGHT] = {
+    ROW8(0),   ROW8(8),   ROW8(16),  ROW8(24),  ROW8(32),
+    ROW8(40),  ROW8(48),  ROW8(56),  ROW8(64),  ROW8(72),
+    ROW8(80),  ROW8(88),  ROW8(96),  ROW8(104), ROW8(112),
+    ROW8(120), ROW8(128), ROW8(136), ROW8(144), ROW8(152),
+    ROW8(160), ROW8(168), ROW8(176), ROW8(184), ROW8(192)
+};
+
+int getRaster(PCCORE *pccore, RASTER *raster) {
+    raster->vram = &pccore->memory[CGA_VIDEO_RAM_START];
+    switch (pccore->mode) {
+        case CGA640x200x1:
+            raster->width = 640;
+            raster->bits = 1;
+            raster->shift = 3;
+            raster->maxcolor = 1;
+            return 1;
+        case CGA320x200x2:
+        case CGA320x200x2g:
+            raster->width = 320;
+            raster->bits = 2;
+            raster->shift = 2;
+            raster->maxcolor = 3;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int openCanvas(PCCORE *pccore, RASTER *raster) {
+    GRAPHSTATE *graph = &pccore->graph;
+
+    if (!graph->active) {
+        graph->result = grNoInitGraph;
+        return 0;
+    }
+    if (!getRaster(pccore, raster)) {
+        return 0;
+    }
+
+    raster->org_x = graph->vp_left;
+    raster->org_y = graph->vp_top;
+    if (graph->vp_clip) {
+        raster->clip_left = graph->vp_left;
+        raster->clip_top = graph->vp_top;
+        raster->clip_right = graph->vp_right;
+        raster->clip_bottom = graph->vp_bottom;
+    } else {
+        raster->clip_left = 0;
+        raster->clip_top = 0;
+        raster->clip_right = raster->width - 1;
+        raster->clip_bottom = RASTER_HEIGHT - 1;
+    }
+    return 1;
+}
+
+unsigned short rasterSolid(const RASTER *raster, int color) {
+    unsigned char byte;
+
+    if (raster->bits == 1) {
+        byte = (color & 1) ? 0xFF : 0x00;
+    } else {
+        byte = (unsigned char)((color & 3) * 0x55);
+    }
+    return (unsigned short)(byte << 8 | byte);
+}
+
+unsigned short rasterPattern(const RASTER *raster, unsigned char bits, int color) {
+    unsigned short pixels = 0;
+    int x;
+
+    if (raster->bits == 1) {
+        bits = (color & 1) ? bits : 0;
+        return (unsigned short)(bits << 8 | bits);
+    }
+    for (x = 0; x < 8; x++) {
+        pixels <<= 2;
+        if (bits & (0x80 >> x)) {
+            pixels |= color & 3;
+        }
+    }
+    return pixels;
+}
+
+/*
+ * combine - One VRAM byte: the bits of 'mask' become 'value' by 'op'.
+ */
+static void combine(unsigned char *dest, unsigned char value, unsigned char mask, int op) {
+    switch (op) {
+        case RASTER_XOR:
+            *dest ^= value & mask;
+            break;
+        case RASTER_OR:
+            *dest |= value & mask;
+            break;
+        case RASTER_AND:
+            *dest &= value | (unsigned char)~mask;
+            break;
+        case RASTER_NOT:
+            *dest = (unsigned char)((*dest & ~mask) | (~value & mask));
+            break;
+        default:
+            *dest = (unsigned char)((*dest & ~mask) | (value & mask));
+            break;
+    }
+}
+
+void rasterSpan(const RASTER *raster, int x0, int x1, int y, unsigned short pattern, int op) {
+    unsigned char *line = raster->vram + rasterRows[y];
+    int last = (1 << raster->shift) - 1;
+    int b0 = x0 >> raster->shift;
+    int b1 = x1 >> raster->shift;
+    unsigned char left = (unsigned char)(0xFF >> ((x0 & last) * raster->bits));
+    unsigned char right = (unsigned char)(0xFF << ((last - (x1 & last)) * raster->bits));
+    unsigned char even = (unsigned char)(pattern >> 8);
+    unsigned char odd = (unsigned char)pattern;
+    int b;
+
+    if (b0 == b1) {
+        combine(line + b0, (b0 & 1) ? odd : even, left & right, op);
+        return;
+    }
+
+    combine(line + b0, (b0 & 1) ? odd : even, left, op);
+    combine(line + b1, (b1 & 1) ? odd : even, right, op);
+
+    // Whole bytes in between
+    b0++;
+    if (b0 >= b1) {
+        return;
+    }
+    if (op == RASTER_COPY && even == odd) {
+        memset(line + b0, even, (size_t)(b1 - b0));
+        return;
+    }
+    for (b = b0; b < b1; b++) {
+        unsigned char value = (b & 1) ? odd : even;
+        switch (op) {
+            case RASTER_XOR:
+                line[b] ^= value;
+                break;
+            case RASTER_OR:
+                line[b] |= value;
+                break;
+            case RASTER_AND:
+                line[b] &= value;
+                break;
+            default:
+                line[b] = value;
+                break;
+        }
+    }
+}
+
+void rasterPixel(const RASTER *raster, int x, int y, int color, int op) {
+    int last = (1 << raster->shift) - 1;
+    int bitpos = (last - (x & last)) * raster->bits;
+    unsigned char mask = (unsigned char)(raster->maxcolor << bitpos);
+
+    combine(raster->vram + rasterRows[y] + (x >> raster->shift),
+            (unsigned char)(color << bitpos), mask, op);
+}
+
+int rasterGetPixel(const RASTER *raster, int x, int y) {
+    int last = (1 << raster->shift) - 1;
+    int bitpos = (last - (x & last)) * raster->bits;
+
+    return (raster->vram[rasterRows[y] + (x >> raster->shift)] >> bitpos) & raster->maxcolor;
+}
+
+void rasterClipSpan(const RASTER *raster, int x0, int x1, int y, unsigned short pattern, int op) {
+    if (y < raster->clip_top || y > raster->clip_bottom) {
+        return;
+    }
+    if (x0 < raster->clip_left) {
+        x0 = raster->clip_left;
+    }
+    if (x1 > raster->clip_right) {
+        x1 = raster->clip_right;
+    }
+    if (x0 <= x1) {
+        rasterSpan(raster, x0, x1, y, pattern, op);
+    }
+}
+
+void rasterClipPixel(const RASTER *raster, int x, int y, int color, int op) {
+    if (x >= raster->clip_left && x <= raster->clip_right &&
+        y >= raster->clip_top && y <= raster->clip_bottom) {
+        rasterPixel(raster, x, y, color, op);
+    }
+}
+
+static uint64_t loadBig(const unsigned char *p) {
+    return (uint64_t)p[0] << 56 | (uint64_t)p[1] << 48 | (uint64_t)p[2] << 40 | (uint64_t)p[3] << 32 |
+           (uint64_t)p[4] << 24 | (uint64_t)p[5] << 16 | (uint64_t)p[6] << 8 | p[7];
+}
+
+static void storeBig(unsigned char *p, uint64_t w) {
+    int i;
+
+    for (i = 7; i >= 0; i--, w >>= 8) {
+        p[i] = (unsigned char)w;
+    }
+}
+
+/*
+ * shiftBits - out[j] = the 8 bits of 'src' from bit 'offset' + 8j on,
+ * for 'bytes' bytes (rounded up to 8). 'src' is padded with ROW_PAD
+ * bytes before and 3 * ROW_PAD after, so 'offset' may be down to
+ * -8 * ROW_PAD and reads may run past a full row.
+ */
+static void shiftBits(const unsigned char *src, int offset, unsigned char *out, int bytes) {
+    const unsigned char *p = src + (offset >> 3);  // Floor, also when negative
+    int phase = offset & 7;
+    int j;
+
+    for (j = 0; j < bytes; j += 8, p += 8) {
+        uint64_t w = loadBig(p);
+        if (phase != 0) {
+            w = (w << phase) | (p[8] >> (8 - phase));
+        }
+        storeBig(out + j, w);
+    }
+}
+
+void rasterReadRow(const RASTER *raster, int x, int y, int count, unsigned char *bits) {
+    unsigned char line[ROW_PAD + RASTER_ROW_BYTES + 3 * ROW_PAD];
+    unsigned char row[RASTER_ROW_BYTES + ROW_PAD];
+    int nbits = count * raster->bits;
+    int bytes = (nbits + 7) >> 3;
+
+    memset(line, 0, sizeof(line));
+    memcpy(line + ROW_PAD, raster->vram + rasterRows[y], RASTER_ROW_BYTES);
+    shiftBits(line + ROW_PAD, x * raster->bits, row, bytes);
+    if (nbits & 7) {
+        row[bytes - 1] &= rightMasks[(nbits - 1) & 7];
+    }
+    memcpy(bits, row, (size_t)bytes);
+}
+
+void rasterWriteRow(const RASTER *raster, int x, int y, int count,
+                    const unsigned char *bits, int bytes, int first, int op) {
+    unsigned char source[ROW_PAD + RASTER_ROW_BYTES + 3 * ROW_PAD];
+    unsigned char row[RASTER_ROW_BYTES + 2 * ROW_PAD];
+    unsigned char *line = raster->vram + rasterRows[y];
+    int start = x * raster->bits;
+    int end = start + count * raster->bits - 1;
+    int b0 = start >> 3, b1 = end >> 3;
+    int from = first * raster->bits;
+    int b, n;
+
+    // From the byte holding the first pixel: at most a screen row and one byte
+    bits += from >> 3;
+    bytes -= from >> 3;
+    from &= 7;
+    if (bytes > RASTER_ROW_BYTES + 1) {
+        bytes = RASTER_ROW_BYTES + 1;
+    }
+    memset(source, 0, sizeof(source));
+    memcpy(source + ROW_PAD, bits, (size_t)bytes);
+
+    // Source bits lined up with the destination bytes b0..b1
+    shiftBits(source + ROW_PAD, from - (start & 7), row, b1 - b0 + 1);
+
+    if (b0 == b1) {
+        combine(line + b0, row[0], leftMasks[start & 7] & rightMasks[end & 7], op);
+        return;
+    }
+    combine(line + b0, row[0], leftMasks[start & 7], op);
+    combine(line + b1, row[b1 - b0], rightMasks[end & 7], op);
+
+    // Whole bytes in between, a 64-bit word at a time
+    for (b = b0 + 1, n = 1; b + 8 <= b1; b += 8, n += 8) {
+        uint64_t d, w;
+
+        memcpy(&d, line + b, 8);
+        memcpy(&w, row + n, 8);
+        switch (op) {
+            case RASTER_XOR:
+                d ^= w;
+                break;
+            case RASTER_OR:
+                d |= w;
+                break;
+            case RASTER_AND:
+                d &= w;
+                break;
+            case RASTER_NOT:
+                d = ~w;
+                break;
+            default:
+                d = w;
+                break;
+        }
+        memcpy(line + b, &d, 8);
+    }
+    for (; b < b1; b++, n++) {
+        combine(line + b, row[n], 0xFF, op);
+    }
+}
+
+int ellipseWidth(int rx, int ry, int dy) {
+    double t;
+
+    if (ry == 0) {
+        return rx;
+    }
+    t = 1.0 - (double)dy * dy / ((double)ry * ry);
+    return t > 0 ? (int)(rx * sqrt(t) + 0.5) : 0;
+}
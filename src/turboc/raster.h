@@ -0,0 +1,120 @@
+#ifndef _RASTER_H
+#define _RASTER_H
+
+/*
+ * Pixel and span access to the CGA graphics modes, shared by the
+ * graphics library (graphics.c).
+ *
+ * VRAM at 0xB8000 holds the even scanlines in the first 8 KB bank and
+ * the odd ones in the second, 80 bytes each. A byte is 4 pixels at
+ * 320x200 (2 bits each) or 8 at 640x200, the leftmost in the high bits.
+ * Scanline addresses come from a table, never from per-pixel math.
+ */
+
+#include "../pccore/pccore.h"
+
+#define RASTER_HEIGHT 200
+
+/* Raster operations, numbered like the BGI's COPY_PUT... */
+#define RASTER_COPY 0
+#define RASTER_XOR  1
+#define RASTER_OR   2
+#define RASTER_AND  3
+#define RASTER_NOT  4   /* Copy of the inverted source (rows only) */
+
+/* Longest row rasterReadRow / rasterWriteRow handle, in bytes */
+#define RASTER_ROW_BYTES 80
+
+/*
+ * RASTER - Geometry of the current graphics mode, and the BGI viewport
+ * origin and clip rectangle in screen coordinates.
+ */
+typedef struct {
+    unsigned char *vram;    // 0xB8000 in the machine's memory
+    int width;              // 320 or 640
+    int bits;               // Bits per pixel: 2 or 1
+    int shift;              // log2(pixels per byte): 2 or 3
+    int maxcolor;           // 3 or 1
+    int org_x, org_y;
+    int clip_left, clip_top, clip_right, clip_bottom;
+} RASTER;
+
+/*
+ * rasterRows - Offset of each scanline from 0xB8000.
+ */
+extern const unsigned short rasterRows[RASTER_HEIGHT];
+
+/*
+ * getRaster - Fills 'raster' for the mode of 'pccore'. Returns 0 in the
+ * text modes, which have no raster.
+ */
+int getRaster(PCCORE *pccore, RASTER *raster);
+
+/*
+ * openCanvas - getRaster plus the viewport of the graphics library.
+ * Returns 0, and records grNoInitGraph, outside initgraph/closegraph.
+ */
+int openCanvas(PCCORE *pccore, RASTER *raster);
+
+/*
+ * rasterSolid - The pattern of 'color' for rasterSpan.
+ *
+ * A pattern is 8 pixels in VRAM format: one byte at 640x200 (stored
+ * twice), two at 320x200 (high byte first). Even VRAM bytes of a line
+ * take the high byte and odd ones the low byte.
+ */
+unsigned short rasterSolid(const RASTER *raster, int color);
+
+/*
+ * rasterPattern - rasterSolid for an 8-pixel pattern: set bits of 'bits'
+ * (the leftmost in bit 7) are 'color', clear bits 0.
+ */
+unsigned short rasterPattern(const RASTER *raster, unsigned char bits, int color);
+
+/*
+ * rasterSpan - Combines pixels x0..x1 (inclusive, x0 <= x1, on screen)
+ * of line y with 'pattern' by 'op'. Whole bytes inside the span are
+ * written at once; only the two end bytes are masked.
+ */
+void rasterSpan(const RASTER *raster, int x0, int x1, int y, unsigned short pattern, int op);
+
+/*
+ * rasterPixel / rasterGetPixel - One pixel, on screen.
+ */
+void rasterPixel(const RASTER *raster, int x, int y, int color, int op);
+int rasterGetPixel(const RASTER *raster, int x, int y);
+
+/*
+ * rasterClipSpan / rasterClipPixel - rasterSpan and rasterPixel for any
+ * screen coordinates (x0 <= x1), clipped to the clip rectangle.
+ */
+void rasterClipSpan(const RASTER *raster, int x0, int x1, int y, unsigned short pattern, int op);
+void rasterClipPixel(const RASTER *raster, int x, int y, int color, int op);
+
+/*
+ * rasterReadRow - Copies 'count' pixels of line y from x on (on screen)
+ * into 'bits', packed from its first bit; the bits after the last pixel
+ * of the final byte are cleared.
+ */
+void rasterReadRow(const RASTER *raster, int x, int y, int count, unsigned char *bits);
+
+/*
+ * rasterWriteRow - Combines 'count' pixels of a packed row, starting at
+ * pixel 'first' of 'bits' ('bytes' long), with line y from x on (on
+ * screen), by any RASTER_ operation.
+ *
+ * The row is shifted once into the destination's bit phase, 64 bits at
+ * a time, and then combined a word at a time; only the two end bytes
+ * are masked.
+ */
+void rasterWriteRow(const RASTER *raster, int x, int y, int count,
+                    const unsigned char *bits, int bytes, int first, int op);
+
+/*
+ * ellipseWidth - Half width, rounded, of the ellipse with radii rx and
+ * ry, dy lines from its center. Outlines and fills share it so that a
+ * filled ellipse meets its outline.
+ */
+int ellipseWidth(int rx, int ry, int dy);
+
+#endif /* _RASTER_H */
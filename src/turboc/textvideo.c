@@ -0,0 +1,117 @@
+#include "textvideo.h"
+#include "../pccore/cga.h"
+#include "dos.h"
+
+#include <string.h>
+
+int isTextMode(PCCORE *pccore) {
+    return pccore->mode == CGA80x25 || pccore->mode == CGA40x25;
+}
+
+int textColumns(PCCORE *pccore) {
+    switch (pccore->mode) {
+        case CGA40x25:
+        case CGA320x200x2:
+        case CGA320x200x2g:
+            return 40;
+        default:
+            return 80;
+    }
+}
+
+unsigned short *textCells(PCCORE *pccore) {
+    unsigned int page = pccore->memory[BDA_VIDEO_PAGE_OFF] |
+                        (pccore->memory[BDA_VIDEO_PAGE_OFF + 1] << 8);
+    // Pages live inside the 16 KB window the renderer sees
+    return (unsigned short *)&pccore->memory[CGA_VIDEO_RAM_START + (page & 0x3FFE)];
+}
+
+unsigned short *pageCells(PCCORE *pccore, int page) {
+    unsigned int size = pccore->memory[BDA_VIDEO_PAGE_SIZE] |
+                        (pccore->memory[BDA_VIDEO_PAGE_SIZE + 1] << 8);
+    return (unsigned short *)&pccore->memory[CGA_VIDEO_RAM_START + ((page * size) & 0x3FFE)];
+}
+
+void getPageCursor(PCCORE *pccore, int page, int *col, int *row) {
+    const unsigned char *cursor = &pccore->memory[BDA_CURSOR_POS + 2 * (page & 7)];
+    *col = cursor[0];
+    *row = cursor[1];
+}
+
+void setPageCursor(PCCORE *pccore, int page, int col, int row) {
+    unsigned char *cursor = &pccore->memory[BDA_CURSOR_POS + 2 * (page & 7)];
+    cursor[0] = (unsigned char)col;
+    cursor[1] = (unsigned char)row;
+}
+
+void getTextCursor(PCCORE *pccore, int *col, int *row) {
+    getPageCursor(pccore, pccore->memory[BDA_ACTIVE_PAGE], col, row);
+}
+
+void setTextCursor(PCCORE *pccore, int col, int row) {
+    setPageCursor(pccore, pccore->memory[BDA_ACTIVE_PAGE], col, row);
+}
+
+void fillCells(unsigned short *cells, unsigned short cell, int count) {
+    if (count > 0) {
+        _fmemsetw(cells, cell, (size_t)count);
+    }
+}
+
+void scrollText(PCCORE *pccore, int left, int top, int right, int bottom,
+                int lines, unsigned char attr) {
+    scrollCells(textCells(pccore), textColumns(pccore), left, top, right, bottom, lines, attr);
+}
+
+void scrollCells(unsigned short *cells, int cols, int left, int top, int right, int bottom,
+                 int lines, unsigned char attr) {
+    unsigned short blank = (unsigned short)(' ' | (attr << 8));
+    int width, height, count, row;
+
+    if (right >= cols) {
+        right = cols - 1;
+    }
+    if (bottom >= TEXT_ROWS) {
+        bottom = TEXT_ROWS - 1;
+    }
+    if (left < 0 || top < 0 || left > right || top > bottom) {
+        return;
+    }
+
+    width = right - left + 1;
+    height = bottom - top + 1;
+    count = lines < 0 ? -lines : lines;
+    if (count == 0 || count >= height) {
+        count = height;
+    }
+
+    if (width == cols) {
+        // Whole rows are contiguous: one move and one fill
+        unsigned short *window = cells + top * cols;
+        if (lines > 0) {
+            memmove(window, window + count * cols, (size_t)(height - count) * cols * 2);
+            fillCells(window + (height - count) * cols, blank, count * cols);
+        } else {
+            memmove(window + count * cols, window, (size_t)(height - count) * cols * 2);
+            fillCells(window, blank, count * cols);
+        }
+        return;
+    }
+
+    // Partial rows: one move per row span
+    if (lines > 0) {
+        for (row = top; row + count <= bottom; row++) {
+            memmove(cells + row * cols + left, cells + (row + count) * cols + left, (size_t)width * 2);
+        }
+        for (row = bottom - count + 1; row <= bottom; row++) {
+            fillCells(cells + row * cols + left, blank, width);
+        }
+    } else {
+        for (row = bottom; row - count >= top; row--) {
+            memmove(cells + row * cols + left, cells + (row - count) * cols + left, (size_t)width * 2);
+        }
+        for (row = top; row < top + count; row++) {
+            fillCells(cells + row * cols + left, blank, width);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef _TEXTVIDEO_H
+#define _TEXTVIDEO_H
+
+/*
+ * Text-mode VRAM helpers shared by the console functions (conio.c) and
+ * the video BIOS (int10.c).
+ *
+ * A cell is one 16-bit word: character in the low byte, attribute in the
+ * high byte, as the CGA reads it from 0xB8000 (little-endian hosts).
+ * The cursor lives in the BIOS Data Area (0x450, one word per page: low
+ * byte column, high byte row), so every writer agrees on it.
+ */
+
+#include "../pccore/pccore.h"
+
+#define TEXT_ROWS 25
+
+/*
+ * isTextMode - Non-zero in the 40x25 and 80x25 text modes.
+ */
+int isTextMode(PCCORE *pccore);
+
+/*
+ * textColumns - Character columns of the current mode (80 or 40).
+ * The 320x200 graphics modes have 40, like the BIOS gives them.
+ */
+int textColumns(PCCORE *pccore);
+
+/*
+ * textCells - The first cell of the active page.
+ */
+unsigned short *textCells(PCCORE *pccore);
+
+/*
+ * pageCells - The first cell of 'page', using the BDA page size.
+ */
+unsigned short *pageCells(PCCORE *pccore, int page);
+
+/*
+ * getPageCursor / setPageCursor - Cursor of 'page' (0-7), 0-based.
+ */
+void getPageCursor(PCCORE *pccore, int page, int *col, int *row);
+void setPageCursor(PCCORE *pccore, int page, int col, int row);
+
+/*
+ * getTextCursor / setTextCursor - Cursor of the active page, 0-based.
+ */
+void getTextCursor(PCCORE *pccore, int *col, int *row);
+void setTextCursor(PCCORE *pccore, int col, int row);
+
+/*
+ * fillCells - Stores 'count' copies of 'cell', several per store.
+ */
+void fillCells(unsigned short *cells, unsigned short cell, int count);
+
+/*
+ * scrollText - Scrolls the window (0-based, inclusive) up by 'lines'
+ * (down if negative) and fills the uncovered rows with blanks in 'attr'.
+ * 0 lines, or more than the window height, clears the window.
+ */
+void scrollText(PCCORE *pccore, int left, int top, int right, int bottom,
+                int lines, unsigned char attr);
+
+/*
+ * scrollCells - scrollText on any page: 'cells' is its first cell and
+ * 'cols' its width.
+ */
+void scrollCells(unsigned short *cells, int cols, int left, int top, int right, int bottom,
+                 int lines, unsigned char attr);
+
+#endif /* _TEXTVIDEO_H */
@@ -1,10 +1,74 @@
 #include "time.h"
+#include "../pccore/speaker.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/**
+ * @brief Host wall clock in milliseconds since 1970, for threads with no
+ * bound machine.
+ */
+static long long hostWallMs(void) {
+#ifdef _WIN32
+    FILETIME now;
+    ULARGE_INTEGER ticks;
+
+    // 100 ns units since 1601
+    GetSystemTimeAsFileTime(&now);
+    ticks.LowPart = now.dwLowDateTime;
+    ticks.HighPart = now.dwHighDateTime;
+    return (long long)(ticks.QuadPart / 10000ULL) - 11644473600000LL;
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (long long)now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+#endif
+}
+
+/**
+ * @brief Host CPU time of this process in milliseconds, for threads with
+ * no bound machine.
+ */
+static long long hostCpuMs(void) {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    ULARGE_INTEGER k, u;
+
+    GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (long long)((k.QuadPart + u.QuadPart) / 10000ULL);
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return (long long)now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+#endif
+}
 
 time_t time(time_t *timer){
-    time_t seconds = (time_t)(pccore.time / 1000);
+    PCCORE* pccore = currentPCCore();
+    long long now = pccore != NULL ? __atomic_load_n(&pccore->time, __ATOMIC_RELAXED) : hostWallMs();
+    time_t seconds = (time_t)(now / 1000);
 
     if (timer != NULL) {
         *timer = seconds;
     }
     return seconds;
-}
\ No newline at end of file
+}
+
+clock_t clock(void){
+    PCCORE* pccore = currentPCCore();
+    long long elapsed = pccore != NULL ?
+                        __atomic_load_n(&pccore->time, __ATOMIC_RELAXED) - pccore->clock.wall_ms :
+                        hostCpuMs();
+
+    // Same CLK_TCK ticks either way
+    return (clock_t)(elapsed * PIT_CLOCK_HZ / (65536LL * 1000LL));
+}
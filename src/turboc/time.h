@@ -5,7 +5,19 @@
 #include <stddef.h>
 
 typedef long	time_t;
+typedef long	clock_t;
 
+/* clock() ticks per second (the BIOS timer rate) */
+#define CLK_TCK 18.2
+
+/*
+ * time - Seconds since 1970-01-01 00:00 UTC.
+ * clock - Timer ticks since the machine clock started.
+ * Both read pccore.time and make no system call. On a thread with no
+ * bound machine they fall back to the host: the wall clock for time(),
+ * the process CPU time for clock().
+ */
 time_t time(time_t *timer);
+clock_t clock(void);
 
 #endif
\ No newline at end of file
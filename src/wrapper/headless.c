@@ -0,0 +1,481 @@
+/**
+ * @file headless.c
+ * @brief Display-less wrapper for running Turbo C programs on servers
+ *
+ * Runs dos_main on its own thread with the same PCCORE, timer and
+ * keyboard plumbing as the windowed wrappers, but without a display.
+ * Input comes from a script (see script.h), read from a file or stdin.
+ * Frames are rendered on demand or at a fixed rate, and are only
+ * written to disk when the script asks for them.
+ *
+ * With PCCORE_TRACE set, key presses are traced to the frame that shows
+ * the response (a rendered frame counts as presented) and the latency
+ * histograms are printed at exit.
+ *
+ * With -v the rendered frames are also streamed as YUV4MPEG2 (or raw
+ * RGB if the file name ends in .rgb) at the render rate.
+ *
+ * With -a the PC speaker is recorded to a WAV file (see speaker.h).
+ *
+ * With -c the machine is checkpointed incrementally to a delta log (see
+ * checkpoint.h), every -k milliseconds, on the 'checkpoint' script
+ * command and at exit. If the log exists, the machine is restored from
+ * it first.
+ *
+ * Usage: pccore_headless [-s script] [-r fps] [-v video] [-a audio.wav] [-c log [-k ms]] [-- dos arguments]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "../pccore/pccore.h"
+#include "../pccore/cga.h"
+#include "../pccore/memory.h"
+#include "../pccore/iobus.h"
+#include "../pccore/checkpoint.h"
+#include "../pccore/capture.h"
+#include "../pccore/speaker.h"
+#include "../pccore/trace.h"
+#include "../dosapp.h"
+#include "script.h"
+
+// --- Constants ---
+#define TIMER_PERIOD_US 1000        // pccore.time resolution
+#define BLINK_HALF_CYCLE_MS 133     // ~3.75 Hz, same as the windowed wrappers
+#define KEY_CONSUME_TIMEOUT_MS 1000 // 'type' gives up on a key after this
+
+// --- Global Variables ---
+PCCORE pccore;                  // The machine this wrapper runs
+IMAGE g_imageBuffer = {0};
+pthread_mutex_t g_renderLock = PTHREAD_MUTEX_INITIALIZER;
+
+int g_running = 1;
+int g_renderRate = 0;           // Frames per second, 0 = on demand only
+int g_scriptDone = 0;
+long long g_startTime = 0;
+CAPTURE *g_capture = NULL;
+SPEAKER *g_speaker = NULL;
+
+// Incremental checkpoints; written from the timer loop and the script thread
+CHECKPOINTLOG *g_checkpoint = NULL;
+pthread_mutex_t g_checkpointLock = PTHREAD_MUTEX_INITIALIZER;
+
+// DOS Thread Data
+typedef struct {
+    int argc;
+    char **argv;
+    int result;
+    int finished;
+} DOSThreadData;
+
+pthread_t g_dosThread;
+DOSThreadData g_dosData;
+
+pthread_t g_scriptThread;
+FILE *g_script = NULL;
+
+// --- Forward Declarations ---
+void InitializePCCore(void);
+void UpdateTime(void);
+void RenderFrame(void);
+int SaveFrame(const char *path);
+void* DOSThreadFunction(void *arg);
+void* ScriptThreadFunction(void *arg);
+long long GetCurrentTimeMillis(void);
+long long GetCurrentTimeMicros(void);
+void SleepMillis(long ms);
+void TypeText(const char *text);
+void PressKey(int key);
+void Checkpoint(void);
+
+/**
+ * @brief Get current time in milliseconds
+ */
+long long GetCurrentTimeMillis(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000LL + tv.tv_usec / 1000;
+}
+
+/**
+ * @brief Get current time in microseconds
+ */
+long long GetCurrentTimeMicros(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+/**
+ * @brief Sleep for a number of milliseconds
+ */
+void SleepMillis(long ms) {
+    while (ms > 0) {
+        long chunk = ms > 1000 ? 1000 : ms;
+        usleep(chunk * 1000);
+        ms -= chunk;
+    }
+}
+
+/**
+ * @brief DOS Thread Function
+ */
+void* DOSThreadFunction(void *arg) {
+    DOSThreadData *data = (DOSThreadData *)arg;
+
+    // Call the DOS main function
+    bindPCCore(&pccore);
+    beginVideoUpdate(&pccore);
+    data->result = dos_main(data->argc, data->argv);
+    endVideoUpdate(&pccore);
+
+    // Mark as finished
+    __atomic_store_n(&data->finished, 1, __ATOMIC_SEQ_CST);
+
+    return NULL;
+}
+
+/**
+ * @brief Initialize PCCORE struct (same defaults as the windowed wrappers)
+ */
+void InitializePCCore(void) {
+    memset(&pccore, 0, sizeof(PCCORE));
+    int resumed = initMachineFromEnv(&pccore);
+    if (resumed < 0) {
+        fprintf(stderr, "Cannot set up guest memory\n");
+        exit(1);
+    }
+    attachCga(&pccore);
+    if (!resumed) {
+        writePort(&pccore, CGA_MODE_CONTROL_PORT, 0x0A); // 320x200x2
+        writePort(&pccore, CGA_COLOR_REGISTER_PORT, 0x20 | 0x10 | 0x01); // 0x31
+    }
+    pccore.key = 0;
+    startMachineClock(&pccore);
+    UpdateTime();
+}
+
+/**
+ * @brief Update pccore.time and the blink phase from the machine clock
+ */
+void UpdateTime(void) {
+    long long now = updateMachineClock(&pccore);
+    pccore.blink = (int)(((now - g_startTime) / BLINK_HALF_CYCLE_MS) & 1);
+}
+
+/**
+ * @brief Render the current screen into g_imageBuffer
+ *
+ * Called from the timer loop and from the script thread, so it is
+ * serialized with a lock.
+ */
+void RenderFrame(void) {
+    pthread_mutex_lock(&g_renderLock);
+    takeSnapshot(&pccore);
+    unsigned int traceId = traceSnapshot(&pccore.snapshot);
+    renderSnapshot(&g_imageBuffer, &pccore.snapshot);
+    traceStage(traceId, TRACE_RENDER);
+    captureFrame(g_capture, &g_imageBuffer);
+    traceStage(traceId, TRACE_PRESENT);
+    pthread_mutex_unlock(&g_renderLock);
+}
+
+/**
+ * @brief Render the current screen and write it to a PPM file
+ */
+int SaveFrame(const char *path) {
+    int result;
+
+    pthread_mutex_lock(&g_renderLock);
+    takeSnapshot(&pccore);
+    unsigned int traceId = traceSnapshot(&pccore.snapshot);
+    renderSnapshot(&g_imageBuffer, &pccore.snapshot);
+    traceStage(traceId, TRACE_RENDER);
+    result = writePPM(path, &g_imageBuffer);
+    traceStage(traceId, TRACE_PRESENT);
+    pthread_mutex_unlock(&g_renderLock);
+
+    if (result != 0) {
+        fprintf(stderr, "Cannot write frame %s\n", path);
+    }
+    return result;
+}
+
+/**
+ * @brief Append the pages changed since the last checkpoint to the log
+ */
+void Checkpoint(void) {
+    pthread_mutex_lock(&g_checkpointLock);
+    if (g_checkpoint != NULL) {
+        writeCheckpoint(g_checkpoint);
+    }
+    pthread_mutex_unlock(&g_checkpointLock);
+}
+
+/**
+ * @brief Store a key press in pccore.key (traced)
+ */
+void PressKey(int key) {
+    unsigned int traceId = traceKeyPress();
+    pccore.key = key;
+    traceKeyStore(traceId);
+}
+
+/**
+ * @brief Press and release each character, waiting for the program to read it
+ */
+void TypeText(const char *text) {
+    for (; *text != '\0'; text++) {
+        int key = asciiToScancode((unsigned char)*text);
+        long waited = 0;
+
+        if (key == 0) {
+            fprintf(stderr, "No scan code for character 0x%02x\n", (unsigned char)*text);
+            continue;
+        }
+
+        PressKey(key);
+        while (pccore.key == key && waited < KEY_CONSUME_TIMEOUT_MS) {
+            SleepMillis(1);
+            waited++;
+        }
+        pccore.key = 0;
+    }
+}
+
+/**
+ * @brief Script thread: executes the input script
+ */
+void* ScriptThreadFunction(void *arg) {
+    char line[SCRIPT_LINE_SIZE];
+    SCRIPTCMD cmd;
+    int lineNumber = 0;
+
+    while (fgets(line, sizeof(line), g_script) != NULL) {
+        lineNumber++;
+
+        switch (parseScriptLine(line, &cmd)) {
+            case SCRIPT_NONE:
+                break;
+
+            case SCRIPT_WAIT:
+                SleepMillis(cmd.value);
+                break;
+
+            case SCRIPT_KEY:
+                PressKey((int)cmd.value);
+                break;
+
+            case SCRIPT_RELEASE:
+                pccore.key = 0;
+                break;
+
+            case SCRIPT_TYPE:
+                TypeText(cmd.arg);
+                break;
+
+            case SCRIPT_MOUSE:
+                scriptMouse(&pccore, &cmd);
+                break;
+
+            case SCRIPT_FRAME:
+                SaveFrame(cmd.arg);
+                break;
+
+            case SCRIPT_RATE:
+                __atomic_store_n(&g_renderRate, (int)cmd.value, __ATOMIC_RELAXED);
+                break;
+
+            case SCRIPT_CHECKPOINT:
+                if (g_checkpoint == NULL) {
+                    fprintf(stderr, "Script line %d: no checkpoint log (use -c)\n", lineNumber);
+                }
+                Checkpoint();
+                break;
+
+            case SCRIPT_SAVE:
+                if (saveMachine(&pccore) != 0) {
+                    fprintf(stderr, "Script line %d: no machine image (set PCCORE_IMAGE)\n", lineNumber);
+                }
+                break;
+
+            case SCRIPT_QUIT:
+                __atomic_store_n(&g_running, 0, __ATOMIC_RELEASE);
+                return NULL;
+
+            case SCRIPT_ERROR:
+                fprintf(stderr, "Script line %d: cannot parse: %s", lineNumber, line);
+                break;
+        }
+    }
+
+    __atomic_store_n(&g_scriptDone, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/**
+ * @brief Main application entry point
+ */
+int main(int argc, char **argv) {
+    const char *scriptPath = NULL;
+    const char *videoPath = NULL;
+    const char *audioPath = NULL;
+    const char *checkpointPath = NULL;
+    long checkpointInterval = 0;
+    int option;
+
+    while ((option = getopt(argc, argv, "s:r:v:a:c:k:")) != -1) {
+        switch (option) {
+            case 's':
+                scriptPath = optarg;
+                break;
+            case 'r':
+                g_renderRate = atoi(optarg);
+                break;
+            case 'v':
+                videoPath = optarg;
+                break;
+            case 'a':
+                audioPath = optarg;
+                break;
+            case 'c':
+                checkpointPath = optarg;
+                break;
+            case 'k':
+                checkpointInterval = atol(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-s script] [-r fps] [-v video] [-a audio.wav] [-c log [-k ms]] [-- dos arguments]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    g_script = stdin;
+    if (scriptPath != NULL && strcmp(scriptPath, "-") != 0) {
+        g_script = fopen(scriptPath, "r");
+        if (g_script == NULL) {
+            fprintf(stderr, "Cannot open script %s\n", scriptPath);
+            return 2;
+        }
+    }
+
+    if (videoPath != NULL) {
+        size_t length = strlen(videoPath);
+        CAPTUREFORMAT format = (length > 4 && strcmp(videoPath + length - 4, ".rgb") == 0)
+                               ? CAPTURE_RGB : CAPTURE_Y4M;
+        // A video needs a frame rate; use the emulated refresh rate
+        if (g_renderRate <= 0) {
+            g_renderRate = 60;
+        }
+        g_capture = openCapture(videoPath, format, g_renderRate);
+        if (g_capture == NULL) {
+            return 2;
+        }
+    }
+
+    if (getenv("PCCORE_TRACE") != NULL) {
+        enableTrace(1);
+    }
+
+    // Initialize PCCORE
+    g_startTime = GetCurrentTimeMillis();
+    InitializePCCore();
+
+    if (checkpointPath != NULL) {
+        if (access(checkpointPath, F_OK) == 0) {
+            int applied = restoreCheckpointLog(&pccore, checkpointPath);
+            if (applied < 0) {
+                return 2;
+            }
+            // The ports were replaced: decode the CGA registers again
+            attachCga(&pccore);
+            printf("Restored %d checkpoints from %s\n", applied, checkpointPath);
+        }
+        g_checkpoint = openCheckpointLog(&pccore, checkpointPath);
+        if (g_checkpoint == NULL) {
+            return 2;
+        }
+    }
+
+    if (audioPath != NULL) {
+        g_speaker = openSpeaker(&pccore, audioPath);
+        if (g_speaker == NULL) {
+            return 2;
+        }
+    }
+
+    // dos_main gets the program name and whatever follows the options
+    argv[optind - 1] = argv[0];
+    g_dosData.argc = argc - optind + 1;
+    g_dosData.argv = &argv[optind - 1];
+
+    if (pthread_create(&g_dosThread, NULL, DOSThreadFunction, &g_dosData) != 0 ||
+        pthread_create(&g_scriptThread, NULL, ScriptThreadFunction, NULL) != 0) {
+        fprintf(stderr, "Failed to create threads\n");
+        return 1;
+    }
+
+    // Timer loop: keeps pccore.time moving and renders at the chosen rate
+    long long nextRender = GetCurrentTimeMicros();
+    long long nextCheckpoint = GetCurrentTimeMillis() + checkpointInterval;
+
+    while (__atomic_load_n(&g_running, __ATOMIC_ACQUIRE)) {
+        UpdateTime();
+        advanceSpeaker(g_speaker, pccore.time);
+
+        int rate = __atomic_load_n(&g_renderRate, __ATOMIC_RELAXED);
+        long long now = GetCurrentTimeMicros();
+        if (rate > 0 && now >= nextRender) {
+            RenderFrame();
+            nextRender += 1000000 / rate;
+            if (nextRender < now) {
+                nextRender = now;
+            }
+        }
+
+        if (g_checkpoint != NULL && checkpointInterval > 0 &&
+            GetCurrentTimeMillis() >= nextCheckpoint) {
+            Checkpoint();
+            nextCheckpoint += checkpointInterval;
+        }
+
+        // Done when the program returned and the script has nothing left
+        if (__atomic_load_n(&g_dosData.finished, __ATOMIC_ACQUIRE) &&
+            __atomic_load_n(&g_scriptDone, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+
+        usleep(TIMER_PERIOD_US);
+    }
+
+    printSnapshotStats(&pccore);
+    printTraceStats(stdout);
+    saveMachine(&pccore);
+    closeCapture(g_capture);
+
+    pthread_mutex_lock(&g_checkpointLock);
+    closeCheckpointLog(g_checkpoint);
+    g_checkpoint = NULL;
+    pthread_mutex_unlock(&g_checkpointLock);
+
+    if (!__atomic_load_n(&g_dosData.finished, __ATOMIC_ACQUIRE)) {
+        // 'quit' while dos_main is still running: there is no way to
+        // stop it cleanly, so leave the process. The DOS thread may be
+        // in a speaker port write: detach the speaker and finish the
+        // WAV, but keep it allocated.
+        if (g_speaker != NULL) {
+            detachSpeaker(&pccore);
+            finishSpeaker(g_speaker, pccore.time, stdout);
+        }
+        fprintf(stderr, "Stopped before dos_main returned\n");
+        return 1;
+    }
+
+    pthread_join(g_dosThread, NULL);
+    closeSpeaker(&pccore, g_speaker, pccore.time, stdout);
+    return g_dosData.result;
+}
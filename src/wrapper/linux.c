@@ -1,15 +1,29 @@
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/keysym.h>
+#include <X11/extensions/XShm.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <signal.h>
 #include <unistd.h>
+#include <poll.h>
+#include <stdint.h>
 #include <sys/time.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
 
 #include "../pccore/pccore.h"
 #include "../pccore/cga.h"
+#include "../pccore/memory.h"
+#include "../pccore/iobus.h"
+#include "../pccore/capture.h"
+#include "../pccore/speaker.h"
+#include "../pccore/mouse.h"
+#include "../pccore/trace.h"
 #include "linux_keyboard.h"
 #include "../dosapp.h"
 
@@ -18,18 +32,105 @@
 #define TARGET_FPS 60
 #define FRAME_TIME_US (1000000 / TARGET_FPS)
 
+// Triple buffer: slot index in the low bits, FRAME_FRESH marks a frame
+// the X11 thread has not picked up yet
+#define FRAME_COUNT 3
+#define FRAME_INDEX_MASK 3
+#define FRAME_FRESH 4
+
+// Every slot is allocated once for the largest frame, so the XImages
+// (shared memory or not) never have to be recreated on a mode switch
+#define FRAME_MAX_WIDTH 704
+#define FRAME_MAX_HEIGHT 480
+#define FRAME_STRIDE (FRAME_MAX_WIDTH * 4)
+#define FRAME_PIXELS_SIZE (FRAME_STRIDE * FRAME_MAX_HEIGHT)
+
+// Blink half cycle in frames, see macos.m
+#define FRAMES_PER_BLINK_HALF_CYCLE 8
+
 // --- Global Variables ---
+PCCORE pccore; // The machine this wrapper runs
 Display *g_display = NULL;
 Window g_window = 0;
 GC g_gc = 0;
-XImage *g_ximage = NULL;
 IMAGE g_imageBuffer = {0};
 Atom g_wmDeleteWindow;
 
 int g_baseWidth = 0;
 int g_baseHeight = 0;
+int g_windowWidth = 0;
+int g_windowHeight = 0;
 int g_running = 1;
 
+// One slot of the triple buffer
+typedef struct {
+    unsigned char *pixels;  // BGRA pixels, written by the render thread
+    int width;
+    int height;
+    long long completed;    // Time the frame was finished (us)
+    long long changed;      // Time of the DOS-side change it shows (us), 0 = none
+    unsigned int traceId;   // Input event it responds to (trace.h), 0 = none
+    XImage *ximage;         // Wraps 'pixels', owned by the X11 thread
+    XShmSegmentInfo shm;    // Shared memory segment when using MIT-SHM
+    int inFlight;           // XShmPutImage sent, ShmCompletion not yet seen
+} FRAME;
+
+// Latency counter for one pipeline stage
+typedef struct {
+    unsigned long count;
+    long long totalMicros;
+    long long maxMicros;
+} StageStats;
+
+FRAME g_frames[FRAME_COUNT];
+int g_renderSlot = 0;   // Owned by the render thread
+int g_readySlot = 1;    // Shared, swapped atomically
+int g_presentSlot = 2;  // Owned by the X11 thread
+
+// MIT-SHM presentation state (X11 thread)
+int g_useShm = 0;
+int g_shmCompletionEvent = 0;
+int g_shmAttachFailed = 0;
+int g_presentPending = 0;
+unsigned long g_presentDeferred = 0;
+
+// Optional video stream of every produced frame (PCCORE_CAPTURE=file)
+CAPTURE *g_capture = NULL;
+
+// Optional PC speaker recording (PCCORE_AUDIO=file.wav)
+SPEAKER *g_speaker = NULL;
+
+pthread_t g_renderThread;
+int g_blinkFrameCounter = 0;
+
+// Wakeup sources. The render thread sleeps on the frame timer and on
+// g_videoEventFd (written by the DOS thread, see notifyVideoChange);
+// the X11 thread sleeps on the X connection and on g_frameEventFd
+// (written by the render thread when a frame is published).
+int g_frameTimerFd = -1;
+int g_videoEventFd = -1;
+int g_frameEventFd = -1;
+long long g_videoChangeTime = 0;    // First unconsumed DOS-side change (us)
+
+// Render thread counters
+StageStats g_renderStats;
+StageStats g_convertStats;
+unsigned long g_framesDropped = 0;
+unsigned long g_framesSkipped = 0;  // Ticks with nothing new to show
+unsigned long g_timerWakeups = 0;
+unsigned long g_videoWakeups = 0;
+
+// X11 thread counters
+StageStats g_presentStats;
+StageStats g_latencyStats;
+StageStats g_changeStats;           // DOS-side change to screen
+unsigned long g_xWakeups = 0;
+unsigned long g_frameWakeups = 0;
+long long g_startTime = 0;
+
+// Set by SIGUSR2: print the input latency histograms
+volatile sig_atomic_t g_traceDumpRequested = 0;
+
 // DOS Thread Data
 typedef struct {
     int argc;
@@ -44,7 +145,24 @@ DOSThreadData *g_pDOSData = NULL;
 // --- Forward Declarations ---
 void InitializePCCore(void);
 void CreateAppWindow(int argc, char **argv);
-void RenderAndUpdate(void);
+void ProduceFrame(long long changed);
+void PresentFrame(int force);
+void* RenderThreadFunction(void *arg);
+void StartRenderThread(void);
+void CreateFrameBuffers(void);
+int CreateShmFrame(FRAME *frame);
+void RecordStage(StageStats *stage, long long micros);
+void PrintStage(const char *name, const StageStats *stage);
+void PrintFrameStats(void);
+void OnVideoChange(PCCORE* machine);
+int FrameNeeded(int changed);
+void SignalEventFd(int fd);
+void DrainFd(int fd);
+void HandleTraceSignal(int sig);
+void HandleShmCompletion(XShmCompletionEvent *event);
+int ShmErrorHandler(Display *display, XErrorEvent *error);
+void DestroyFrame(FRAME *frame);
+void MovePointer(int x, int y);
 void HandleEvents(void);
 void CleanupResources(void);
 void* DOSThreadFunction(void *arg);
@@ -69,7 +187,10 @@ void* DOSThreadFunction(void *arg) {
     printf("DOS thread started with %d arguments\n", data->argc);
     
     // Call the DOS main function
+    bindPCCore(&pccore);
+    beginVideoUpdate(&pccore);
     data->result = dos_main(data->argc, data->argv);
+    endVideoUpdate(&pccore);
     
     printf("DOS thread finished with result: %d\n", data->result);
     
@@ -123,17 +244,32 @@ void InitializePCCore(void) {
     // Zero out the entire pccore state
     memset(&pccore, 0, sizeof(PCCORE));
     
-    // Set the requested video mode
-    pccore.mode = CGA320x200x2;
+    // Map guest memory and ports (PCCORE_IMAGE / PCCORE_RESUME, see memory.h)
+    int resumed = initMachineFromEnv(&pccore);
+    if (resumed < 0) {
+        fprintf(stderr, "Cannot set up guest memory\n");
+        exit(1);
+    }
+    
+    // Decode the CGA registers on every write (and now, for a resumed image)
+    attachCga(&pccore);
+    
+    if (!resumed) {
+        // Set the requested video mode (Port 0x3D8)
+        writePort(&pccore, CGA_MODE_CONTROL_PORT, 0x0A); // 320x200x2
+        
+        // Set the CGA Color Register (Port 0x3D9)
+        writePort(&pccore, CGA_COLOR_REGISTER_PORT, 0x20 | 0x10 | 0x01); // 0x31
+    }
+
+    // Wall clock anchor for pccore.time
+    startMachineClock(&pccore);
     
     // Initialize key to 0 (meaning "no key pressed")
     pccore.key = 0;
     
-    // Set the CGA Color Register (Port 0x3D9)
-    pccore.port[CGA_COLOR_REGISTER_PORT] = 0x20 | 0x10 | 0x01; // 0x31
-    
     // Run one initial render to get image dimensions
-    render(&g_imageBuffer, pccore);
+    render(&g_imageBuffer, &pccore);
     
     g_baseWidth = g_imageBuffer.width;
     g_baseHeight = g_imageBuffer.height;
@@ -157,11 +293,14 @@ void CreateAppWindow(int argc, char **argv) {
     int defaultScale = 2;
     int windowWidth = g_baseWidth * defaultScale;
     int windowHeight = g_baseHeight * defaultScale;
+    g_windowWidth = windowWidth;
+    g_windowHeight = windowHeight;
     
     // Set up window attributes
     XSetWindowAttributes attrs;
     attrs.background_pixel = BlackPixel(g_display, screen);
-    attrs.event_mask = ExposureMask | KeyPressMask | KeyReleaseMask | 
+    attrs.event_mask = ExposureMask | KeyPressMask | KeyReleaseMask |
+                       PointerMotionMask | ButtonPressMask | ButtonReleaseMask |
                        StructureNotifyMask | FocusChangeMask;
     
     // Create the window
@@ -214,112 +353,585 @@ void CreateAppWindow(int argc, char **argv) {
 }
 
 /**
- * @brief Render and update the display
+ * @brief Record one measurement for a pipeline stage
  */
-void RenderAndUpdate(void) {
-    // Call the C render function
-    render(&g_imageBuffer, pccore);
-    
+void RecordStage(StageStats *stage, long long micros) {
+    stage->count++;
+    stage->totalMicros += micros;
+    if (micros > stage->maxMicros) {
+        stage->maxMicros = micros;
+    }
+}
+
+/**
+ * @brief Print one pipeline stage counter
+ */
+void PrintStage(const char *name, const StageStats *stage) {
+    if (stage->count == 0) {
+        return;
+    }
+    printf("  %-8s %8lu frames, avg %6.1f us, max %6lld us\n",
+           name, stage->count,
+           (double)stage->totalMicros / stage->count, stage->maxMicros);
+}
+
+/**
+ * @brief Print the render pipeline counters
+ */
+void PrintFrameStats(void) {
+    long long elapsed = GetCurrentTimeMicros() - g_startTime;
+
+    printf("Frame pipeline:\n");
+    PrintStage("render", &g_renderStats);
+    PrintStage("convert", &g_convertStats);
+    PrintStage("present", &g_presentStats);
+    PrintStage("latency", &g_latencyStats);
+    PrintStage("change", &g_changeStats);
+
+    if (elapsed > 0) {
+        printf("  produced %.1f fps, presented %.1f fps, dropped %lu, deferred %lu (%s)\n",
+               g_renderStats.count * 1000000.0 / elapsed,
+               g_presentStats.count * 1000000.0 / elapsed,
+               g_framesDropped, g_presentDeferred,
+               g_useShm ? "MIT-SHM" : "XPutImage");
+        printf("  wakeups: render %.1f/s (timer %lu, video %lu, skipped %lu), "
+               "x11 %.1f/s (events %lu, frames %lu)\n",
+               (g_timerWakeups + g_videoWakeups) * 1000000.0 / elapsed,
+               g_timerWakeups, g_videoWakeups, g_framesSkipped,
+               (g_xWakeups + g_frameWakeups) * 1000000.0 / elapsed,
+               g_xWakeups, g_frameWakeups);
+    }
+}
+
+/**
+ * @brief Add one to an eventfd counter (wakes whoever polls it)
+ */
+void SignalEventFd(int fd) {
+    uint64_t one = 1;
+    if (write(fd, &one, sizeof(one)) < 0) {
+        // Counter saturated: the reader is already due to wake up
+    }
+}
+
+/**
+ * @brief Reset an eventfd or timerfd after poll() reported it readable
+ */
+void DrainFd(int fd) {
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) < 0) {
+        // Nothing pending (spurious wakeup)
+    }
+}
+
+/**
+ * @brief SIGUSR2 handler: ask the X11 thread to print the latency histograms
+ */
+void HandleTraceSignal(int sig) {
+    g_traceDumpRequested = 1;
+    SignalEventFd(g_frameEventFd);
+}
+
+/**
+ * @brief Video listener: runs on the DOS thread, once per unconsumed change
+ */
+void OnVideoChange(PCCORE* machine) {
+    __atomic_store_n(&g_videoChangeTime, (long long)GetCurrentTimeMicros(), __ATOMIC_RELAXED);
+    SignalEventFd(g_videoEventFd);
+}
+
+/**
+ * @brief Render one frame into the render slot and publish it
+ *
+ * 'changed' is the time of the DOS-side change the frame shows, 0 if
+ * the frame was rendered for another reason.
+ *
+ * Runs on the render thread. The finished slot is swapped with the
+ * ready slot, so the X11 thread always finds the newest complete frame.
+ */
+void ProduceFrame(long long changed) {
+    FRAME *frame = &g_frames[g_renderSlot];
+
+    long long start = GetCurrentTimeMicros();
+    takeSnapshot(&pccore);
+    unsigned int traceId = traceSnapshot(&pccore.snapshot);
+    renderSnapshot(&g_imageBuffer, &pccore.snapshot);
+    traceStage(traceId, TRACE_RENDER);
+    long long rendered = GetCurrentTimeMicros();
+    RecordStage(&g_renderStats, rendered - start);
+
     if (g_imageBuffer.width == 0 || g_imageBuffer.height == 0) {
         return;
     }
-    
-    // Get current window size
-    XWindowAttributes windowAttrs;
-    XGetWindowAttributes(g_display, g_window, &windowAttrs);
-    int windowWidth = windowAttrs.width;
-    int windowHeight = windowAttrs.height;
-    
-    // Create or recreate XImage if needed
-    if (!g_ximage || 
-        g_ximage->width != g_imageBuffer.width || 
-        g_ximage->height != g_imageBuffer.height) {
-        
-        if (g_ximage) {
-            XDestroyImage(g_ximage);
+
+    if (g_imageBuffer.width > FRAME_MAX_WIDTH || g_imageBuffer.height > FRAME_MAX_HEIGHT) {
+        return;
+    }
+
+    captureFrame(g_capture, &g_imageBuffer);
+
+    // Convert RGB to BGRA format for X11, straight into the slot
+    // (which is the shared memory segment when MIT-SHM is in use)
+    unsigned char *src = g_imageBuffer.raw;
+
+    for (int y = 0; y < g_imageBuffer.height; y++) {
+        unsigned char *dst = frame->pixels + y * FRAME_STRIDE;
+        for (int x = 0; x < g_imageBuffer.width; x++) {
+            dst[x * 4 + 0] = src[2]; // B
+            dst[x * 4 + 1] = src[1]; // G
+            dst[x * 4 + 2] = src[0]; // R
+            dst[x * 4 + 3] = 0xFF;   // A
+            src += 3;
         }
-        
-        // Create XImage
-        // Note: XImage will use the raw buffer directly
-        // We need to convert RGB to BGR for X11
-        int screen = DefaultScreen(g_display);
-        Visual *visual = DefaultVisual(g_display, screen);
-        int depth = DefaultDepth(g_display, screen);
-        
-        // Allocate buffer for BGR format
-        char *imageData = (char *)malloc(g_imageBuffer.width * g_imageBuffer.height * 4);
-        
-        g_ximage = XCreateImage(
+    }
+
+    frame->width = g_imageBuffer.width;
+    frame->height = g_imageBuffer.height;
+    frame->completed = GetCurrentTimeMicros();
+    frame->changed = changed;
+    frame->traceId = traceId;
+    RecordStage(&g_convertStats, frame->completed - rendered);
+
+    // Publish: the old ready slot becomes the next render slot
+    int previous = __atomic_exchange_n(&g_readySlot, g_renderSlot | FRAME_FRESH,
+                                       __ATOMIC_ACQ_REL);
+    if (previous & FRAME_FRESH) {
+        // The X11 thread never saw that frame
+        g_framesDropped++;
+    }
+    g_renderSlot = previous & FRAME_INDEX_MASK;
+
+    SignalEventFd(g_frameEventFd);
+}
+
+/**
+ * @brief Decide whether a frame tick has anything new to show
+ *
+ * A frame is rendered when the DOS thread reported a change, when it is
+ * running outside delay() (it may be writing VRAM at any time), when the
+ * blink phase flipped or the mouse cursor moved, or when every frame is
+ * being captured.
+ */
+int FrameNeeded(int changed) {
+    static unsigned int lastSeq = 1;
+    static int lastBlink = -1;
+    static int lastMouse = 0, lastMouseX = -1, lastMouseY = -1;
+    int mouseX = -1, mouseY = -1;
+
+    unsigned int seq = __atomic_load_n(&pccore.seq, __ATOMIC_ACQUIRE);
+    int needed = changed;
+
+    // The cursor is drawn over the picture: moving it changes no VRAM
+    int mouse = mouseCursor(&pccore, &mouseX, &mouseY);
+    needed |= mouse != lastMouse || mouseX != lastMouseX || mouseY != lastMouseY;
+
+    needed |= (seq & 1) || seq != lastSeq;
+    needed |= pccore.blink != lastBlink;
+    needed |= g_capture != NULL;
+
+    lastSeq = seq;
+    lastBlink = pccore.blink;
+    lastMouse = mouse;
+    lastMouseX = mouseX;
+    lastMouseY = mouseY;
+    return needed;
+}
+
+/**
+ * @brief Render thread: produces frames at the target frame rate
+ *
+ * Sleeps in poll() on the frame timer and the DOS thread's video
+ * eventfd. The timer keeps pccore.time and the blink phase moving; a
+ * frame is only rendered when FrameNeeded() finds something new. A
+ * change reported between ticks is shown right away if the previous
+ * frame is at least a frame time old, otherwise on the next tick.
+ */
+void* RenderThreadFunction(void *arg) {
+    struct pollfd fds[2] = {
+        { g_frameTimerFd, POLLIN, 0 },
+        { g_videoEventFd, POLLIN, 0 }
+    };
+    long lastFrame = 0;
+
+    while (__atomic_load_n(&g_running, __ATOMIC_ACQUIRE)) {
+        if (poll(fds, 2, -1) < 0) {
+            continue;
+        }
+
+        int tick = 0;
+        if (fds[0].revents & POLLIN) {
+            uint64_t expirations = 0;
+            if (read(g_frameTimerFd, &expirations, sizeof(expirations)) < 0) {
+                expirations = 0;
+            }
+            g_timerWakeups++;
+            tick = 1;
+
+            // --- UPDATE PCCORE.TIME FROM THE MACHINE CLOCK ---
+            advanceSpeaker(g_speaker, updateMachineClock(&pccore));
+
+            // BLINK IMPLEMENTATION (same rate as the macOS wrapper);
+            // ticks missed while the thread was late still count
+            g_blinkFrameCounter += (int)expirations;
+            while (g_blinkFrameCounter >= FRAMES_PER_BLINK_HALF_CYCLE) {
+                pccore.blink = 1 - pccore.blink;
+                g_blinkFrameCounter -= FRAMES_PER_BLINK_HALF_CYCLE;
+            }
+        }
+        if (fds[1].revents & POLLIN) {
+            DrainFd(g_videoEventFd);
+            g_videoWakeups++;
+        }
+
+        long now = GetCurrentTimeMicros();
+        if (!tick && now - lastFrame < FRAME_TIME_US) {
+            // Too soon after the last frame: the next tick picks it up
+            continue;
+        }
+
+        // Consume before the snapshot: a change after this point is
+        // reported again and shows up in the next frame
+        long long changed = 0;
+        if (consumeVideoChange(&pccore)) {
+            changed = __atomic_load_n(&g_videoChangeTime, __ATOMIC_RELAXED);
+        }
+
+        if (FrameNeeded(changed != 0)) {
+            ProduceFrame(changed);
+            lastFrame = now;
+        } else if (tick) {
+            g_framesSkipped++;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Present the newest completed frame
+ *
+ * Runs on the X11 thread. Takes the ready slot if the render thread
+ * published a new frame since the last call. With 'force' set, the
+ * current frame is presented again (for Expose and resize).
+ *
+ * With MIT-SHM, a slot stays with the X11 thread until its
+ * ShmCompletion arrives, so the render thread never overwrites pixels
+ * the server is still reading.
+ */
+void PresentFrame(int force) {
+    FRAME *frame = &g_frames[g_presentSlot];
+
+    int ready = __atomic_load_n(&g_readySlot, __ATOMIC_ACQUIRE);
+
+    if (frame->inFlight) {
+        // Try again when the completion event arrives
+        if (force || (ready & FRAME_FRESH)) {
+            g_presentDeferred += !g_presentPending;
+            g_presentPending |= force ? 2 : 1;
+        }
+        return;
+    }
+
+    if (ready & FRAME_FRESH) {
+        int previous = __atomic_exchange_n(&g_readySlot, g_presentSlot, __ATOMIC_ACQ_REL);
+        g_presentSlot = previous & FRAME_INDEX_MASK;
+        frame = &g_frames[g_presentSlot];
+    } else if (!force) {
+        return;
+    }
+
+    if (frame->width == 0 || frame->height == 0) {
+        return;
+    }
+
+    long long start = GetCurrentTimeMicros();
+
+    // Center the image in the window (XPutImage does not scale)
+    int offsetX = (g_windowWidth - frame->width) / 2;
+    int offsetY = (g_windowHeight - frame->height) / 2;
+
+    // Clear only the margins around the image to avoid flicker
+    XRectangle margins[4];
+    int count = 0;
+    if (offsetY > 0) {
+        margins[count++] = (XRectangle){0, 0, g_windowWidth, offsetY};
+        margins[count++] = (XRectangle){0, offsetY + frame->height, g_windowWidth,
+                                        g_windowHeight - offsetY - frame->height};
+    }
+    if (offsetX > 0) {
+        margins[count++] = (XRectangle){0, offsetY, offsetX, frame->height};
+        margins[count++] = (XRectangle){offsetX + frame->width, offsetY,
+                                        g_windowWidth - offsetX - frame->width, frame->height};
+    }
+    if (count > 0) {
+        XSetForeground(g_display, g_gc, BlackPixel(g_display, DefaultScreen(g_display)));
+        XFillRectangles(g_display, g_window, g_gc, margins, count);
+    }
+
+    if (g_useShm) {
+        // Zero copy: the server reads the segment, completion is reported
+        XShmPutImage(g_display, g_window, g_gc, frame->ximage,
+                     0, 0, offsetX, offsetY,
+                     frame->width, frame->height, True);
+        frame->inFlight = 1;
+    } else {
+        XPutImage(g_display, g_window, g_gc, frame->ximage,
+                  0, 0, offsetX, offsetY,
+                  frame->width, frame->height);
+    }
+
+    XFlush(g_display);
+
+    if (ready & FRAME_FRESH) {
+        traceStage(frame->traceId, TRACE_PRESENT);
+    }
+
+    long long end = GetCurrentTimeMicros();
+    RecordStage(&g_presentStats, end - start);
+    if (ready & FRAME_FRESH) {
+        RecordStage(&g_latencyStats, end - frame->completed);
+        if (frame->changed != 0) {
+            RecordStage(&g_changeStats, end - frame->changed);
+        }
+    }
+}
+
+/**
+ * @brief Handle a ShmCompletion event: the slot may be reused
+ */
+void HandleShmCompletion(XShmCompletionEvent *event) {
+    for (int i = 0; i < FRAME_COUNT; i++) {
+        if (g_frames[i].shm.shmseg == event->shmseg) {
+            g_frames[i].inFlight = 0;
+        }
+    }
+
+    // Present what was held back while the slot was busy
+    if (g_presentPending) {
+        int force = (g_presentPending & 2) != 0;
+        g_presentPending = 0;
+        PresentFrame(force);
+    }
+}
+
+/**
+ * @brief X error handler used while probing XShmAttach
+ */
+int ShmErrorHandler(Display *display, XErrorEvent *error) {
+    g_shmAttachFailed = 1;
+    return 0;
+}
+
+/**
+ * @brief Create a shared memory XImage for one slot
+ *
+ * @return 1 on success, 0 if MIT-SHM cannot be used (for example,
+ *         the X server is on another machine).
+ */
+int CreateShmFrame(FRAME *frame) {
+    int screen = DefaultScreen(g_display);
+
+    frame->ximage = XShmCreateImage(
+        g_display,
+        DefaultVisual(g_display, screen),
+        DefaultDepth(g_display, screen),
+        ZPixmap,
+        NULL,
+        &frame->shm,
+        FRAME_MAX_WIDTH,
+        FRAME_MAX_HEIGHT
+    );
+    if (!frame->ximage) {
+        return 0;
+    }
+
+    if (frame->ximage->bytes_per_line != FRAME_STRIDE) {
+        // Not a 32 bpp visual, the BGRA conversion would not match
+        XDestroyImage(frame->ximage);
+        frame->ximage = NULL;
+        return 0;
+    }
+
+    frame->shm.shmid = shmget(IPC_PRIVATE, FRAME_PIXELS_SIZE, IPC_CREAT | 0600);
+    if (frame->shm.shmid < 0) {
+        XDestroyImage(frame->ximage);
+        frame->ximage = NULL;
+        return 0;
+    }
+
+    frame->shm.shmaddr = shmat(frame->shm.shmid, NULL, 0);
+    if (frame->shm.shmaddr == (char *)-1) {
+        shmctl(frame->shm.shmid, IPC_RMID, NULL);
+        XDestroyImage(frame->ximage);
+        frame->ximage = NULL;
+        return 0;
+    }
+    frame->shm.readOnly = True;
+    frame->ximage->data = frame->shm.shmaddr;
+
+    // XShmAttach fails asynchronously, so trap the error and sync
+    g_shmAttachFailed = 0;
+    XErrorHandler oldHandler = XSetErrorHandler(ShmErrorHandler);
+    XShmAttach(g_display, &frame->shm);
+    XSync(g_display, False);
+    XSetErrorHandler(oldHandler);
+
+    // Removed now, freed when both sides have detached
+    shmctl(frame->shm.shmid, IPC_RMID, NULL);
+
+    if (g_shmAttachFailed) {
+        shmdt(frame->shm.shmaddr);
+        frame->ximage->data = NULL;
+        XDestroyImage(frame->ximage);
+        frame->ximage = NULL;
+        frame->shm.shmaddr = NULL;
+        return 0;
+    }
+
+    frame->pixels = (unsigned char *)frame->shm.shmaddr;
+    return 1;
+}
+
+/**
+ * @brief Free the XImage and pixels of one slot
+ */
+void DestroyFrame(FRAME *frame) {
+    if (frame->shm.shmaddr) {
+        XShmDetach(g_display, &frame->shm);
+        frame->ximage->data = NULL;
+        XDestroyImage(frame->ximage);
+        shmdt(frame->shm.shmaddr);
+        frame->shm.shmaddr = NULL;
+    } else if (frame->ximage) {
+        frame->ximage->data = NULL; // Freed below
+        XDestroyImage(frame->ximage);
+        free(frame->pixels);
+    }
+    frame->ximage = NULL;
+    frame->pixels = NULL;
+}
+
+/**
+ * @brief Create the XImages for all frame slots
+ *
+ * Uses MIT-SHM when the server supports it and can attach our
+ * segments, otherwise falls back to plain XPutImage. Setting
+ * PCCORE_NO_SHM forces the fallback for comparison.
+ */
+void CreateFrameBuffers(void) {
+    int major, minor;
+    Bool pixmaps;
+
+    g_useShm = getenv("PCCORE_NO_SHM") == NULL &&
+               XShmQueryVersion(g_display, &major, &minor, &pixmaps);
+
+    if (g_useShm) {
+        for (int i = 0; i < FRAME_COUNT; i++) {
+            if (!CreateShmFrame(&g_frames[i])) {
+                // Undo the slots created so far
+                for (int j = 0; j < i; j++) {
+                    DestroyFrame(&g_frames[j]);
+                }
+                g_useShm = 0;
+                break;
+            }
+        }
+    }
+
+    if (g_useShm) {
+        g_shmCompletionEvent = XShmGetEventBase(g_display) + ShmCompletion;
+        printf("Presentation: MIT-SHM %d.%d\n", major, minor);
+        return;
+    }
+
+    printf("Presentation: XPutImage\n");
+
+    int screen = DefaultScreen(g_display);
+    for (int i = 0; i < FRAME_COUNT; i++) {
+        FRAME *frame = &g_frames[i];
+        frame->pixels = (unsigned char *)malloc(FRAME_PIXELS_SIZE);
+        if (!frame->pixels) {
+            fprintf(stderr, "Failed to allocate frame buffer\n");
+            exit(1);
+        }
+        frame->ximage = XCreateImage(
             g_display,
-            visual,
-            depth,
+            DefaultVisual(g_display, screen),
+            DefaultDepth(g_display, screen),
             ZPixmap,
             0,
-            imageData,
-            g_imageBuffer.width,
-            g_imageBuffer.height,
+            (char *)frame->pixels,
+            FRAME_MAX_WIDTH,
+            FRAME_MAX_HEIGHT,
             32,
-            0
+            FRAME_STRIDE
         );
-        
-        if (!g_ximage) {
+        if (!frame->ximage) {
             fprintf(stderr, "Failed to create XImage\n");
-            free(imageData);
-            return;
+            exit(1);
         }
     }
-    
-    // Convert RGB to BGRA format for X11
-    unsigned char *src = g_imageBuffer.raw;
-    unsigned char *dst = (unsigned char *)g_ximage->data;
-    
-    for (int i = 0; i < g_imageBuffer.width * g_imageBuffer.height; i++) {
-        dst[i * 4 + 0] = src[i * 3 + 2]; // B
-        dst[i * 4 + 1] = src[i * 3 + 1]; // G
-        dst[i * 4 + 2] = src[i * 3 + 0]; // R
-        dst[i * 4 + 3] = 0xFF;            // A
+}
+
+/**
+ * @brief Allocate the frame slots and start the render thread
+ */
+void StartRenderThread(void) {
+    CreateFrameBuffers();
+
+    const char *capturePath = getenv("PCCORE_CAPTURE");
+    if (capturePath != NULL) {
+        g_capture = openCapture(capturePath, CAPTURE_Y4M, TARGET_FPS);
     }
-    
-    // Scale and draw the image to fill the window
-    // Using XPutImage with scaling via server-side scaling if available,
-    // otherwise we need to scale manually or use extension
-    
-    // For simplicity, we'll use XPutImage and let the X server handle it
-    // For better performance, consider using XRender or similar extensions
-    
-    // Calculate scaling to maintain aspect ratio
-    float scaleX = (float)windowWidth / g_imageBuffer.width;
-    float scaleY = (float)windowHeight / g_imageBuffer.height;
-    float scale = (scaleX < scaleY) ? scaleX : scaleY;
-    
-    int scaledWidth = (int)(g_imageBuffer.width * scale);
-    int scaledHeight = (int)(g_imageBuffer.height * scale);
-    
-    // Center the image
-    int offsetX = (windowWidth - scaledWidth) / 2;
-    int offsetY = (windowHeight - scaledHeight) / 2;
-    
-    // Clear background
-    XSetForeground(g_display, g_gc, BlackPixel(g_display, DefaultScreen(g_display)));
-    XFillRectangle(g_display, g_window, g_gc, 0, 0, windowWidth, windowHeight);
-    
-    // Draw scaled image
-    // Note: Basic XPutImage doesn't support scaling, so we use it at original size
-    // For production, you'd want to use XRender or do software scaling
-    if (scaledWidth == g_imageBuffer.width && scaledHeight == g_imageBuffer.height) {
-        // No scaling needed
-        XPutImage(g_display, g_window, g_gc, g_ximage,
-                  0, 0, offsetX, offsetY,
-                  g_imageBuffer.width, g_imageBuffer.height);
-    } else {
-        // Simple nearest-neighbor scaling
-        // For better quality, consider using XRender extension
-        XPutImage(g_display, g_window, g_gc, g_ximage,
-                  0, 0, offsetX, offsetY,
-                  g_imageBuffer.width, g_imageBuffer.height);
+
+    const char *audioPath = getenv("PCCORE_AUDIO");
+    if (audioPath != NULL) {
+        g_speaker = openSpeaker(&pccore, audioPath);
+    }
+
+    g_startTime = GetCurrentTimeMicros();
+
+    // Periodic frame timer, and the eventfds both threads sleep on
+    g_frameTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    g_videoEventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    g_frameEventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (g_frameTimerFd < 0 || g_videoEventFd < 0 || g_frameEventFd < 0) {
+        perror("Failed to create the frame timer or eventfds");
+        exit(1);
+    }
+
+    struct itimerspec period = {
+        { 0, FRAME_TIME_US * 1000L },
+        { 0, FRAME_TIME_US * 1000L }
+    };
+    timerfd_settime(g_frameTimerFd, 0, &period, NULL);
+
+    setVideoListener(&pccore, OnVideoChange);
+
+    // PCCORE_TRACE=1 traces key presses to the screen; kill -USR2 prints
+    if (getenv("PCCORE_TRACE") != NULL) {
+        enableTrace(1);
+        signal(SIGUSR2, HandleTraceSignal);
+    }
+
+    int result = pthread_create(&g_renderThread, NULL, RenderThreadFunction, NULL);
+    if (result != 0) {
+        fprintf(stderr, "Failed to create render thread: %d\n", result);
+        exit(1);
     }
-    
-    XFlush(g_display);
+}
+
+/**
+ * @brief Move the mouse to a window position: the frame on screen is
+ * centered, unscaled (see PresentFrame)
+ */
+void MovePointer(int x, int y) {
+    FRAME *frame = &g_frames[g_presentSlot];
+
+    if (frame->width == 0 || frame->height == 0) {
+        return;
+    }
+    moveMouseOnImage(&pccore, x - (g_windowWidth - frame->width) / 2,
+                     y - (g_windowHeight - frame->height) / 2, frame->width, frame->height);
 }
 
 /**
@@ -334,7 +946,7 @@ void HandleEvents(void) {
         switch (event.type) {
             case Expose:
                 if (event.xexpose.count == 0) {
-                    RenderAndUpdate();
+                    PresentFrame(1);
                 }
                 break;
                 
@@ -342,7 +954,9 @@ void HandleEvents(void) {
                 KeySym keysym = XLookupKeysym(&event.xkey, 0);
                 unsigned char scancode = get_scancode(keysym);
                 if (scancode != 0) {
+                    unsigned int traceId = traceKeyPress();
                     pccore.key = scancode;
+                    traceKeyStore(traceId);
                     printf("Key pressed: 0x%x (keysym: 0x%lx)\n", scancode, keysym);
                 }
                 break;
@@ -371,14 +985,36 @@ void HandleEvents(void) {
                 break;
             }
             
+            case MotionNotify: {
+                // Only the newest position matters
+                while (XCheckTypedWindowEvent(g_display, g_window, MotionNotify, &event)) {
+                }
+                MovePointer(event.xmotion.x, event.xmotion.y);
+                break;
+            }
+
+            case ButtonPress:
+            case ButtonRelease: {
+                // X11 buttons 1-3 are left, middle, right; 4 and up are the wheel
+                static const int buttons[4] = { -1, 0, 2, 1 };
+                if (event.xbutton.button <= 3) {
+                    MovePointer(event.xbutton.x, event.xbutton.y);
+                    setMouseButton(&pccore, buttons[event.xbutton.button],
+                                   event.type == ButtonPress);
+                }
+                break;
+            }
+
             case ConfigureNotify:
                 // Window was resized
-                RenderAndUpdate();
+                g_windowWidth = event.xconfigure.width;
+                g_windowHeight = event.xconfigure.height;
+                PresentFrame(1);
                 break;
                 
             case ClientMessage:
                 if ((Atom)event.xclient.data.l[0] == g_wmDeleteWindow) {
-                    g_running = 0;
+                    __atomic_store_n(&g_running, 0, __ATOMIC_RELEASE);
                 }
                 break;
                 
@@ -390,6 +1026,12 @@ void HandleEvents(void) {
                 // Window lost focus - release all keys
                 pccore.key = 0;
                 break;
+                
+            default:
+                if (g_useShm && event.type == g_shmCompletionEvent) {
+                    HandleShmCompletion((XShmCompletionEvent *)&event);
+                }
+                break;
         }
     }
 }
@@ -398,6 +1040,15 @@ void HandleEvents(void) {
  * @brief Cleanup resources
  */
 void CleanupResources(void) {
+    // Stop the render thread
+    __atomic_store_n(&g_running, 0, __ATOMIC_RELEASE);
+    pthread_join(g_renderThread, NULL);
+    setVideoListener(&pccore, NULL);
+    PrintFrameStats();
+    printTraceStats(stdout);
+    closeCapture(g_capture);
+    g_capture = NULL;
+
     // Wait for DOS thread to finish
     if (g_pDOSData) {
         int finished = __atomic_load_n(&g_pDOSData->finished, __ATOMIC_SEQ_CST);
@@ -415,20 +1066,24 @@ void CleanupResources(void) {
         free(g_pDOSData->argv);
         
         printf("DOS execution completed with code: %d\n", g_pDOSData->result);
+        printSnapshotStats(&pccore);
+        saveMachine(&pccore);
         
         free(g_pDOSData);
         g_pDOSData = NULL;
     }
+
+    // Only now: the DOS thread writes to the speaker ports
+    closeSpeaker(&pccore, g_speaker, pccore.time, stdout);
+    g_speaker = NULL;
     
+    close(g_frameTimerFd);
+    close(g_videoEventFd);
+    close(g_frameEventFd);
+
     // Free X11 resources
-    if (g_ximage) {
-        // Free the image data before destroying
-        if (g_ximage->data) {
-            free(g_ximage->data);
-            g_ximage->data = NULL;
-        }
-        XDestroyImage(g_ximage);
-        g_ximage = NULL;
+    for (int i = 0; i < FRAME_COUNT; i++) {
+        DestroyFrame(&g_frames[i]);
     }
     
     if (g_gc) {
@@ -462,30 +1117,45 @@ int main(int argc, char **argv) {
     // Start DOS thread
     StartDOSThread(argc, argv);
     
-    // Main render loop
-    long lastFrameTime = GetCurrentTimeMicros();
+    // Start the render thread; this thread only handles X11
+    StartRenderThread();
     
-    while (g_running) {
-        long currentTime = GetCurrentTimeMicros();
-        long deltaTime = currentTime - lastFrameTime;
-        
-        // Handle events
+    // Main event loop: input and presentation only. Sleeps until the
+    // X server sends something or the render thread publishes a frame.
+    struct pollfd fds[2] = {
+        { ConnectionNumber(g_display), POLLIN, 0 },
+        { g_frameEventFd, POLLIN, 0 }
+    };
+
+    while (__atomic_load_n(&g_running, __ATOMIC_ACQUIRE)) {
+        // Handle events (including those Xlib already queued)
         HandleEvents();
-        
-        // Render at target FPS
-        if (deltaTime >= FRAME_TIME_US) {
-            RenderAndUpdate();
-            lastFrameTime = currentTime;
-        } else {
-            // Sleep for remaining frame time
-            long sleepTime = FRAME_TIME_US - deltaTime;
-            if (sleepTime > 1000) {
-                usleep(sleepTime);
+        if (!__atomic_load_n(&g_running, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+
+        // Send buffered requests before sleeping
+        XFlush(g_display);
+        if (poll(fds, 2, -1) < 0) {
+            continue;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            g_xWakeups++;
+        }
+        if (fds[1].revents & POLLIN) {
+            DrainFd(g_frameEventFd);
+            g_frameWakeups++;
+
+            if (g_traceDumpRequested) {
+                g_traceDumpRequested = 0;
+                printTraceStats(stdout);
+                fflush(stdout);
             }
+
+            // Show the newest frame
+            PresentFrame(0);
         }
-        
-        // Small yield to prevent 100% CPU usage
-        usleep(100);
     }
     
     // Cleanup
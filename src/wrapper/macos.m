@@ -2,6 +2,8 @@
 
 #include "../pccore/pccore.h"
 #include "../pccore/cga.h"
+#include "../pccore/memory.h"
+#include "../pccore/iobus.h"
 #include "macos_keyboard.h"
 #include <string.h> // For memset
 #include <pthread.h> // For threading
@@ -20,6 +22,9 @@ typedef struct {
     BOOL finished;
 } DOSThreadData;
 
+// The machine this app runs
+PCCORE pccore;
+
 // --- Global/File-scope state for blinking ---
 // Target frequency is 3.745 Hz (0.267 seconds per cycle)
 // Period for state change is 0.267 / 2 = 0.1337 seconds
@@ -245,7 +250,10 @@ void* dosThreadFunction(void *arg) {
     printf("DOS thread started with %d arguments\n", data->argc);
     
     // Call the DOS main function
+    bindPCCore(&pccore);
+    beginVideoUpdate(&pccore);
     data->result = dos_main(data->argc, data->argv);
+    endVideoUpdate(&pccore);
     
     printf("DOS thread finished with result: %d\n", data->result);
     
@@ -501,6 +509,8 @@ void* dosThreadFunction(void *arg) {
         dosData = NULL;
         
         NSLog(@"DOS execution completed with code: %d", finalResult);
+        printSnapshotStats(&pccore);
+        saveMachine(&pccore);
     }
 }
 
@@ -511,17 +521,32 @@ void* dosThreadFunction(void *arg) {
     // Zero out the entire pccore state
     memset(&pccore, 0, sizeof(PCCORE));
 
-    // Set the requested video mode
-    pccore.mode = CGA320x200x2;
+    // Map guest memory and ports (PCCORE_IMAGE / PCCORE_RESUME, see memory.h)
+    int resumed = initMachineFromEnv(&pccore);
+    if (resumed < 0) {
+        fprintf(stderr, "Cannot set up guest memory\n");
+        exit(1);
+    }
+
+    // Decode the CGA registers on every write (and now, for a resumed image)
+    attachCga(&pccore);
+
+    if (!resumed) {
+        // Set the requested video mode (Port 0x3D8)
+        writePort(&pccore, CGA_MODE_CONTROL_PORT, 0x0A); // 320x200x2
+
+        // Set the CGA Color Register (Port 0x3D9)
+        writePort(&pccore, CGA_COLOR_REGISTER_PORT, 0x20 | 0x10 | 0x01); // 0x31
+    }
+
+    // Wall clock anchor for pccore.time
+    startMachineClock(&pccore);
 
     // Initialize key to 0 (meaning "no key pressed")
     pccore.key = 0;
 
-    // Set the CGA Color Register (Port 0x3D9)
-    pccore.port[CGA_COLOR_REGISTER_PORT] = 0x20 | 0x10 | 0x01; // 0x31
-
     // Run one initial render to get image dimensions
-    render(&imageBuffer, pccore);
+    render(&imageBuffer, &pccore);
 }
 
 /**
@@ -585,12 +610,8 @@ void* dosThreadFunction(void *arg) {
     const int oldWidth = imageBuffer.width;
     const int oldHeight = imageBuffer.height;
 
-    // --- UPDATE PCCORE.TIME WITH SYSTEM MILLISECONDS ---
-    struct timeval te; 
-    gettimeofday(&te, NULL); // get current time
-    // Calculate milliseconds:
-    // (seconds * 1000) + (microseconds / 1000)
-    pccore.time = (long long)te.tv_sec * 1000LL + te.tv_usec / 1000;
+    // --- UPDATE PCCORE.TIME FROM THE MACHINE CLOCK ---
+    updateMachineClock(&pccore);
 
     // BLINK IMPLEMENTATION
     blinkFrameCounter++;
@@ -605,7 +626,7 @@ void* dosThreadFunction(void *arg) {
     }
 
     // Call your C render function
-    render(&imageBuffer, pccore);
+    render(&imageBuffer, &pccore);
 
     if (imageBuffer.width != oldWidth || imageBuffer.height != oldHeight) {
         printf("Detected mode change: %dx%d -> %dx%d\n", 
@@ -0,0 +1,565 @@
+/**
+ * @file runner.c
+ * @brief Parallel batch runner for regression scenarios
+ *
+ * Runs dos_main once per scenario script (see script.h), each in its own
+ * forked worker. The machine is set up once in the parent: guest memory
+ * (optionally resumed from a saved image with -i), the CGA registers and
+ * one rendered frame, so the font and palette tables are paged in. Every
+ * worker starts from that state and shares its pages copy-on-write until
+ * it writes them.
+ *
+ * A worker runs the DOS program and the timer on their own threads and
+ * executes its script on the main thread. 'frame <label>' renders the
+ * screen and reports its hash (see hashImage) instead of writing a file;
+ * 'checkpoint' and 'save' are not available. The blink phase is held at
+ * 0 so the same scenario always produces the same hashes. 'quit' ends the
+ * scenario successfully even if dos_main has not returned.
+ *
+ * Workers report over a pipe; at most -j run at once, and a worker still
+ * running after -t milliseconds is killed. For each scenario the status,
+ * wall time and frame hashes are printed, then the totals.
+ *
+ * Usage: pccore_runner [-j jobs] [-t ms] [-i image] scenario... [-- dos arguments]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+
+#include "../pccore/pccore.h"
+#include "../pccore/cga.h"
+#include "../pccore/memory.h"
+#include "../pccore/iobus.h"
+#include "../dosapp.h"
+#include "script.h"
+
+// --- Constants ---
+#define TIMER_PERIOD_US 1000        // pccore.time resolution
+#define KEY_CONSUME_TIMEOUT_MS 1000 // 'type' gives up on a key after this
+#define DEFAULT_TIMEOUT_MS 60000    // Per scenario
+
+// --- Types ---
+
+/**
+ * @brief One scenario, as seen by the parent
+ */
+typedef struct {
+    const char *script;
+    pid_t pid;
+    int fd;                 // Read end of the report pipe, -1 when closed
+    char *report;           // Everything the worker wrote
+    size_t reportSize;
+    long long start;        // Microseconds
+    long long wall;         // Microseconds, once finished
+    int status;             // waitpid() status
+    int timedOut;
+} SCENARIO;
+
+// --- Global Variables ---
+PCCORE pccore;                  // The machine; each worker has its own copy
+IMAGE g_imageBuffer = {0};
+
+int g_running = 1;              // Worker: timer thread keeps going
+int g_frames = 0;               // Worker: frames reported
+FILE *g_report = NULL;          // Worker: write end of the report pipe
+
+// DOS Thread Data
+typedef struct {
+    int argc;
+    char **argv;
+    int result;
+    int finished;
+} DOSThreadData;
+
+DOSThreadData g_dosData;
+
+// --- Forward Declarations ---
+long long GetCurrentTimeMillis(void);
+long long GetCurrentTimeMicros(void);
+void SleepMillis(long ms);
+void InitializePCCore(const char *image);
+void* DOSThreadFunction(void *arg);
+void* TimerThreadFunction(void *arg);
+void PressKey(int key);
+void TypeText(const char *text);
+int RunScenario(const char *path);
+int StartScenario(SCENARIO *scenario);
+void FinishScenario(SCENARIO *scenario);
+void PrintScenario(const SCENARIO *scenario);
+
+/**
+ * @brief Get current time in milliseconds
+ */
+long long GetCurrentTimeMillis(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000LL + tv.tv_usec / 1000;
+}
+
+/**
+ * @brief Get current time in microseconds
+ */
+long long GetCurrentTimeMicros(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+/**
+ * @brief Sleep for a number of milliseconds
+ */
+void SleepMillis(long ms) {
+    while (ms > 0) {
+        long chunk = ms > 1000 ? 1000 : ms;
+        usleep(chunk * 1000);
+        ms -= chunk;
+    }
+}
+
+/**
+ * @brief Set up the machine every worker starts from
+ */
+void InitializePCCore(const char *image) {
+    memset(&pccore, 0, sizeof(PCCORE));
+    int resumed = image != NULL ? initMachine(&pccore, MACHINE_PRIVATE, image)
+                                : initMachine(&pccore, MACHINE_ANONYMOUS, NULL);
+    if (resumed < 0) {
+        fprintf(stderr, "Cannot set up guest memory\n");
+        exit(2);
+    }
+    attachCga(&pccore);
+    if (!resumed) {
+        writePort(&pccore, CGA_MODE_CONTROL_PORT, 0x0A); // 320x200x2
+        writePort(&pccore, CGA_COLOR_REGISTER_PORT, 0x20 | 0x10 | 0x01); // 0x31
+    }
+    pccore.key = 0;
+    pccore.blink = 0;
+    startMachineClock(&pccore);
+
+    // Page in the font, the palettes and the image buffer before forking
+    render(&g_imageBuffer, &pccore);
+}
+
+/**
+ * @brief DOS Thread Function (worker)
+ */
+void* DOSThreadFunction(void *arg) {
+    DOSThreadData *data = (DOSThreadData *)arg;
+
+    bindPCCore(&pccore);
+    beginVideoUpdate(&pccore);
+    data->result = dos_main(data->argc, data->argv);
+    endVideoUpdate(&pccore);
+
+    __atomic_store_n(&data->finished, 1, __ATOMIC_SEQ_CST);
+    return NULL;
+}
+
+/**
+ * @brief Timer thread (worker): keeps pccore.time moving
+ */
+void* TimerThreadFunction(void *arg) {
+    while (__atomic_load_n(&g_running, __ATOMIC_ACQUIRE)) {
+        updateMachineClock(&pccore);
+        usleep(TIMER_PERIOD_US);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Store a key press in pccore.key
+ */
+void PressKey(int key) {
+    __atomic_store_n(&pccore.key, key, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Press and release each character, waiting for the program to read it
+ */
+void TypeText(const char *text) {
+    for (; *text != '\0'; text++) {
+        int key = asciiToScancode((unsigned char)*text);
+        long waited = 0;
+
+        if (key == 0) {
+            fprintf(stderr, "No scan code for character 0x%02x\n", (unsigned char)*text);
+            continue;
+        }
+
+        PressKey(key);
+        while (__atomic_load_n(&pccore.key, __ATOMIC_ACQUIRE) == key &&
+               waited < KEY_CONSUME_TIMEOUT_MS) {
+            SleepMillis(1);
+            waited++;
+        }
+        PressKey(0);
+    }
+}
+
+/**
+ * @brief Worker: runs one scenario and reports it on g_report
+ *
+ * @return The exit status of the worker.
+ */
+int RunScenario(const char *path) {
+    char line[SCRIPT_LINE_SIZE];
+    SCRIPTCMD cmd;
+    int lineNumber = 0;
+    int quit = 0;
+    pthread_t dosThread, timerThread;
+    FILE *script = fopen(path, "r");
+
+    if (script == NULL) {
+        fprintf(g_report, "error 0 cannot open script\n");
+        return 2;
+    }
+
+    if (pthread_create(&timerThread, NULL, TimerThreadFunction, NULL) != 0 ||
+        pthread_create(&dosThread, NULL, DOSThreadFunction, &g_dosData) != 0) {
+        fprintf(g_report, "error 0 cannot create threads\n");
+        return 2;
+    }
+
+    while (!quit && fgets(line, sizeof(line), script) != NULL) {
+        lineNumber++;
+
+        switch (parseScriptLine(line, &cmd)) {
+            case SCRIPT_NONE:
+            case SCRIPT_RATE:
+                break;
+
+            case SCRIPT_WAIT:
+                SleepMillis(cmd.value);
+                break;
+
+            case SCRIPT_KEY:
+                PressKey((int)cmd.value);
+                break;
+
+            case SCRIPT_RELEASE:
+                PressKey(0);
+                break;
+
+            case SCRIPT_TYPE:
+                TypeText(cmd.arg);
+                break;
+
+            case SCRIPT_MOUSE:
+                scriptMouse(&pccore, &cmd);
+                break;
+
+            case SCRIPT_FRAME:
+                render(&g_imageBuffer, &pccore);
+                fprintf(g_report, "frame %s %016llx\n", cmd.arg, hashImage(&g_imageBuffer));
+                g_frames++;
+                break;
+
+            case SCRIPT_QUIT:
+                quit = 1;
+                break;
+
+            case SCRIPT_CHECKPOINT:
+            case SCRIPT_SAVE:
+            case SCRIPT_ERROR:
+                fprintf(g_report, "error %d cannot run: %s", lineNumber, line);
+                break;
+        }
+    }
+    fclose(script);
+
+    if (quit) {
+        // dos_main may be waiting for input forever; the process ends it
+        fprintf(g_report, "done quit\n");
+        return 0;
+    }
+
+    // The parent kills the worker if this never happens
+    while (!__atomic_load_n(&g_dosData.finished, __ATOMIC_ACQUIRE)) {
+        SleepMillis(1);
+    }
+    __atomic_store_n(&g_running, 0, __ATOMIC_RELEASE);
+    pthread_join(timerThread, NULL);
+    pthread_join(dosThread, NULL);
+
+    fprintf(g_report, "done %d\n", g_dosData.result);
+    return g_dosData.result == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Forks the worker for a scenario
+ *
+ * @return 0 on success, -1 if it could not be started.
+ */
+int StartScenario(SCENARIO *scenario) {
+    int pipeFds[2];
+
+    if (pipe(pipeFds) != 0) {
+        perror("pipe");
+        return -1;
+    }
+
+    scenario->start = GetCurrentTimeMicros();
+    scenario->pid = fork();
+    if (scenario->pid < 0) {
+        perror("fork");
+        close(pipeFds[0]);
+        close(pipeFds[1]);
+        return -1;
+    }
+
+    if (scenario->pid == 0) {
+        // Worker: the DOS program's own output is not part of the report
+        int devNull = open("/dev/null", O_WRONLY);
+        if (devNull >= 0) {
+            dup2(devNull, STDOUT_FILENO);
+            close(devNull);
+        }
+        close(pipeFds[0]);
+        g_report = fdopen(pipeFds[1], "w");
+        if (g_report == NULL) {
+            _exit(2);
+        }
+        setvbuf(g_report, NULL, _IOLBF, 0);
+
+        int status = RunScenario(scenario->script);
+        fflush(g_report);
+        // Skip atexit handlers and stdio of the parent's copy
+        _exit(status);
+    }
+
+    close(pipeFds[1]);
+    scenario->fd = pipeFds[0];
+    return 0;
+}
+
+/**
+ * @brief Reads whatever the worker has written; closes the pipe at EOF
+ */
+static void ReadReport(SCENARIO *scenario) {
+    char buffer[4096];
+    ssize_t count = read(scenario->fd, buffer, sizeof(buffer));
+
+    if (count < 0 && (errno == EINTR || errno == EAGAIN)) {
+        return;
+    }
+    if (count <= 0) {
+        close(scenario->fd);
+        scenario->fd = -1;
+        return;
+    }
+
+    char *grown = (char *)realloc(scenario->report, scenario->reportSize + count + 1);
+    if (grown == NULL) {
+        return;
+    }
+    scenario->report = grown;
+    memcpy(scenario->report + scenario->reportSize, buffer, (size_t)count);
+    scenario->reportSize += (size_t)count;
+    scenario->report[scenario->reportSize] = '\0';
+}
+
+/**
+ * @brief Reaps a worker whose pipe is closed
+ */
+void FinishScenario(SCENARIO *scenario) {
+    while (waitpid(scenario->pid, &scenario->status, 0) < 0 && errno == EINTR) {
+    }
+    scenario->wall = GetCurrentTimeMicros() - scenario->start;
+}
+
+/**
+ * @brief Prints a scenario's result line and its frame hashes
+ */
+void PrintScenario(const SCENARIO *scenario) {
+    const char *status;
+    int frames = 0;
+    const char *line;
+
+    if (scenario->timedOut) {
+        status = "timeout";
+    } else if (WIFSIGNALED(scenario->status)) {
+        status = "crashed";
+    } else if (WEXITSTATUS(scenario->status) != 0) {
+        status = "failed";
+    } else {
+        status = "ok";
+    }
+
+    for (line = scenario->report; line != NULL && *line != '\0'; line = strchr(line, '\n')) {
+        if (*line == '\n') {
+            line++;
+        }
+        if (strncmp(line, "frame ", 6) == 0) {
+            frames++;
+        }
+    }
+
+    printf("%-40s %-8s %10.1f %6d\n", scenario->script, status, scenario->wall / 1000.0, frames);
+
+    // Indent the worker's own lines
+    for (line = scenario->report; line != NULL && *line != '\0'; ) {
+        const char *end = strchr(line, '\n');
+        int length = end != NULL ? (int)(end - line) : (int)strlen(line);
+        if (length > 0) {
+            printf("    %.*s\n", length, line);
+        }
+        line = end != NULL ? end + 1 : NULL;
+    }
+}
+
+/**
+ * @brief Main application entry point
+ */
+int main(int argc, char **argv) {
+    const char *image = NULL;
+    int jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    long timeout = DEFAULT_TIMEOUT_MS;
+    int option;
+
+    while ((option = getopt(argc, argv, "j:t:i:")) != -1) {
+        switch (option) {
+            case 'j':
+                jobs = atoi(optarg);
+                break;
+            case 't':
+                timeout = atol(optarg);
+                break;
+            case 'i':
+                image = optarg;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-j jobs] [-t ms] [-i image] scenario... [-- dos arguments]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (jobs < 1) {
+        jobs = 1;
+    }
+
+    // Scenarios run up to '--'; dos_main gets the program name and the rest
+    int first = optind;
+    int last = first;
+    while (last < argc && strcmp(argv[last], "--") != 0) {
+        last++;
+    }
+    int count = last - first;
+    if (count == 0) {
+        fprintf(stderr, "No scenarios\n");
+        return 2;
+    }
+    if (last < argc) {
+        argv[last] = argv[0];
+        g_dosData.argc = argc - last;
+        g_dosData.argv = &argv[last];
+    } else {
+        g_dosData.argc = 1;
+        g_dosData.argv = argv;
+    }
+
+    SCENARIO *scenarios = (SCENARIO *)calloc((size_t)count, sizeof(SCENARIO));
+    struct pollfd *fds = (struct pollfd *)calloc((size_t)jobs, sizeof(struct pollfd));
+    int *slots = (int *)calloc((size_t)jobs, sizeof(int));
+    if (scenarios == NULL || fds == NULL || slots == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 2;
+    }
+
+    InitializePCCore(image);
+    fflush(stdout);
+
+    long long start = GetCurrentTimeMicros();
+    int next = 0, running = 0, done = 0;
+    int i;
+
+    while (done < count) {
+        // Start workers up to the limit
+        while (running < jobs && next < count) {
+            scenarios[next].script = argv[first + next];
+            scenarios[next].fd = -1;
+            if (StartScenario(&scenarios[next]) != 0) {
+                scenarios[next].status = 2 << 8;
+                done++;
+            } else {
+                running++;
+            }
+            next++;
+        }
+
+        // Wait for reports from the running workers
+        int polled = 0;
+        long long now = GetCurrentTimeMicros();
+        long long wait = timeout;
+        for (i = 0; i < next; i++) {
+            if (scenarios[i].fd >= 0) {
+                long long left = (scenarios[i].start + timeout * 1000 - now) / 1000;
+                if (left < wait) {
+                    wait = left < 0 ? 0 : left;
+                }
+                fds[polled].fd = scenarios[i].fd;
+                fds[polled].events = POLLIN;
+                slots[polled] = i;
+                polled++;
+            }
+        }
+        if (polled == 0) {
+            continue;
+        }
+
+        if (poll(fds, (nfds_t)polled, (int)wait + 1) < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+
+        now = GetCurrentTimeMicros();
+        for (i = 0; i < polled; i++) {
+            SCENARIO *scenario = &scenarios[slots[i]];
+
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                ReadReport(scenario);
+            }
+            if (scenario->fd >= 0 && !scenario->timedOut &&
+                now - scenario->start >= timeout * 1000) {
+                scenario->timedOut = 1;
+                kill(scenario->pid, SIGKILL);
+            }
+            if (scenario->fd < 0) {
+                FinishScenario(scenario);
+                running--;
+                done++;
+            }
+        }
+    }
+
+    double seconds = (GetCurrentTimeMicros() - start) / 1e6;
+    double busy = 0;
+    int passed = 0;
+
+    printf("%-40s %-8s %10s %6s\n", "scenario", "status", "wall ms", "frames");
+    for (i = 0; i < count; i++) {
+        PrintScenario(&scenarios[i]);
+        busy += scenarios[i].wall / 1e6;
+        if (!scenarios[i].timedOut && WIFEXITED(scenarios[i].status) &&
+            WEXITSTATUS(scenarios[i].status) == 0) {
+            passed++;
+        }
+        free(scenarios[i].report);
+    }
+    printf("%d scenarios, %d ok, %d failed in %.2f s: %.1f scenarios/s, %d jobs (x%.1f parallel)\n",
+           count, passed, count - passed, seconds, count / seconds, jobs,
+           seconds > 0 ? busy / seconds : 0.0);
+
+    free(scenarios);
+    free(fds);
+    free(slots);
+    freeMachine(&pccore);
+    return passed == count ? 0 : 1;
+}
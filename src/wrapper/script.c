@@ -0,0 +1,181 @@
+/**
+ * @file script.c
+ * @brief Scripted input for the display-less wrappers
+ */
+
+#include "script.h"
+#include "../pccore/mouse.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+// Scan codes of the unshifted US keyboard, indexed by ASCII (0 = unmapped)
+static const unsigned char g_scancodes[128] = {
+    ['\b'] = 0x0E, ['\t'] = 0x0F, ['\r'] = 0x1C, ['\n'] = 0x1C, [0x1B] = 0x01,
+    [' '] = 0x39,
+    ['1'] = 0x02, ['2'] = 0x03, ['3'] = 0x04, ['4'] = 0x05, ['5'] = 0x06,
+    ['6'] = 0x07, ['7'] = 0x08, ['8'] = 0x09, ['9'] = 0x0A, ['0'] = 0x0B,
+    ['-'] = 0x0C, ['='] = 0x0D, ['['] = 0x1A, [']'] = 0x1B, [';'] = 0x27,
+    ['\''] = 0x28, ['`'] = 0x29, ['\\'] = 0x2B, [','] = 0x33, ['.'] = 0x34,
+    ['/'] = 0x35,
+    ['a'] = 0x1E, ['b'] = 0x30, ['c'] = 0x2E, ['d'] = 0x20, ['e'] = 0x12,
+    ['f'] = 0x21, ['g'] = 0x22, ['h'] = 0x23, ['i'] = 0x17, ['j'] = 0x24,
+    ['k'] = 0x25, ['l'] = 0x26, ['m'] = 0x32, ['n'] = 0x31, ['o'] = 0x18,
+    ['p'] = 0x19, ['q'] = 0x10, ['r'] = 0x13, ['s'] = 0x1F, ['t'] = 0x14,
+    ['u'] = 0x16, ['v'] = 0x2F, ['w'] = 0x11, ['x'] = 0x2D, ['y'] = 0x15,
+    ['z'] = 0x2C,
+};
+
+// Shifted symbols and the key they are on
+static const char g_shifted[] = "!@#$%^&*()_+{}:\"~|<>?";
+static const char g_unshifted[] = "1234567890-=[];'`\\,./";
+
+int asciiToScancode(int c) {
+    int base = c;
+
+    if (c < 0 || c > 127) {
+        return 0;
+    }
+
+    if (isupper(c)) {
+        base = tolower(c);
+    } else {
+        const char *shifted = strchr(g_shifted, c);
+        if (shifted != NULL && c != 0) {
+            base = g_unshifted[shifted - g_shifted];
+        }
+    }
+
+    if (g_scancodes[base] == 0) {
+        return 0;
+    }
+
+    // Enter always reports CR, like the BIOS
+    if (c == '\n') {
+        c = '\r';
+    }
+
+    return (g_scancodes[base] << 8) | c;
+}
+
+SCRIPTOP parseScriptLine(const char *line, SCRIPTCMD *cmd) {
+    char word[16];
+    const char *rest;
+    int length = 0;
+
+    memset(cmd, 0, sizeof(SCRIPTCMD));
+
+    // Skip leading blanks and read the command word
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+    while (isalpha((unsigned char)line[length]) && length < (int)sizeof(word) - 1) {
+        word[length] = line[length];
+        length++;
+    }
+    word[length] = '\0';
+
+    if (length == 0) {
+        cmd->op = (*line == '\0' || *line == '\n' || *line == '\r' || *line == '#')
+                  ? SCRIPT_NONE : SCRIPT_ERROR;
+        return cmd->op;
+    }
+
+    // The argument is the rest of the line without the newline
+    rest = line + length;
+    while (*rest == ' ' || *rest == '\t') {
+        rest++;
+    }
+    strncpy(cmd->arg, rest, SCRIPT_LINE_SIZE - 1);
+    cmd->arg[strcspn(cmd->arg, "\r\n")] = '\0';
+
+    if (strcmp(word, "wait") == 0) {
+        cmd->op = SCRIPT_WAIT;
+    } else if (strcmp(word, "key") == 0) {
+        cmd->op = SCRIPT_KEY;
+    } else if (strcmp(word, "release") == 0) {
+        cmd->op = SCRIPT_RELEASE;
+    } else if (strcmp(word, "type") == 0) {
+        cmd->op = SCRIPT_TYPE;
+    } else if (strcmp(word, "mouse") == 0) {
+        cmd->op = SCRIPT_MOUSE;
+    } else if (strcmp(word, "frame") == 0) {
+        cmd->op = SCRIPT_FRAME;
+    } else if (strcmp(word, "rate") == 0) {
+        cmd->op = SCRIPT_RATE;
+    } else if (strcmp(word, "checkpoint") == 0) {
+        cmd->op = SCRIPT_CHECKPOINT;
+    } else if (strcmp(word, "save") == 0) {
+        cmd->op = SCRIPT_SAVE;
+    } else if (strcmp(word, "quit") == 0) {
+        cmd->op = SCRIPT_QUIT;
+    } else {
+        cmd->op = SCRIPT_ERROR;
+        return cmd->op;
+    }
+
+    // Numeric arguments accept decimal or 0x-prefixed hex
+    if (cmd->op == SCRIPT_WAIT || cmd->op == SCRIPT_KEY || cmd->op == SCRIPT_RATE) {
+        char *end;
+        cmd->value = strtol(cmd->arg, &end, 0);
+        if (end == cmd->arg || cmd->value < 0) {
+            cmd->op = SCRIPT_ERROR;
+        }
+    } else if (cmd->op == SCRIPT_MOUSE) {
+        cmd->value = 0;
+        if (sscanf(cmd->arg, "%d %d %li", &cmd->x, &cmd->y, &cmd->value) < 2) {
+            cmd->op = SCRIPT_ERROR;
+        }
+    } else if ((cmd->op == SCRIPT_TYPE || cmd->op == SCRIPT_FRAME) && cmd->arg[0] == '\0') {
+        cmd->op = SCRIPT_ERROR;
+    }
+
+    return cmd->op;
+}
+
+void scriptMouse(PCCORE *pccore, const SCRIPTCMD *cmd) {
+    int button;
+
+    moveMouse(pccore, cmd->x, cmd->y);
+    for (button = 0; button < MOUSE_BUTTONS; button++) {
+        setMouseButton(pccore, button, (cmd->value >> button) & 1);
+    }
+}
+
+int writePPM(const char *path, const IMAGE *image) {
+    FILE *file = fopen(path, "wb");
+    size_t size = (size_t)image->width * image->height * 3;
+
+    if (file == NULL) {
+        return -1;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", image->width, image->height);
+    if (fwrite(image->raw, 1, size, file) != size) {
+        fclose(file);
+        return -1;
+    }
+
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+unsigned long long hashImage(const IMAGE *image) {
+    size_t size = (size_t)image->width * image->height * 3;
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    int dimensions[2];
+    const unsigned char *bytes;
+    size_t i;
+
+    dimensions[0] = image->width;
+    dimensions[1] = image->height;
+    bytes = (const unsigned char *)dimensions;
+    for (i = 0; i < sizeof(dimensions); i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    for (i = 0; i < size; i++) {
+        hash = (hash ^ image->raw[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file script.h
+ * @brief Scripted input for the display-less wrappers
+ *
+ * A script is a text file with one command per line. '#' starts a comment.
+ *
+ *   wait <ms>        Let the DOS program run for <ms> milliseconds
+ *   key <code>       Press a key, given as a 16-bit IBM PC scan code
+ *                    (high byte = scan code, low byte = ASCII), e.g. 0x011b
+ *   release          Release the pressed key
+ *   type <text>      Press and release each character of <text>
+ *   mouse <x> <y> [<buttons>]
+ *                    Move the mouse to (x, y) in 640x200 mouse coordinates
+ *                    and set the buttons (bit 0 left, 1 right, 2 middle)
+ *   frame <file>     Render the screen now and write it as a binary PPM
+ *   rate <fps>       Render periodically at <fps> (0 = only on 'frame')
+ *   checkpoint       Append changed pages to the checkpoint log (-c)
+ *   save             Flush the machine image (PCCORE_IMAGE, see memory.h)
+ *   quit             Stop immediately, even if dos_main has not returned
+ */
+
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include "../pccore/pccore.h"
+
+// Longest script line / argument
+#define SCRIPT_LINE_SIZE 256
+
+typedef enum {
+    SCRIPT_NONE,    // Empty line or comment
+    SCRIPT_WAIT,
+    SCRIPT_KEY,
+    SCRIPT_RELEASE,
+    SCRIPT_TYPE,
+    SCRIPT_MOUSE,
+    SCRIPT_FRAME,
+    SCRIPT_RATE,
+    SCRIPT_CHECKPOINT,
+    SCRIPT_SAVE,
+    SCRIPT_QUIT,
+    SCRIPT_ERROR    // Unknown command or bad argument
+} SCRIPTOP;
+
+/**
+ * @brief One parsed script command
+ */
+typedef struct {
+    SCRIPTOP op;
+    long value;                     // wait, key, rate; mouse buttons
+    int x, y;                       // mouse
+    char arg[SCRIPT_LINE_SIZE];     // type, frame
+} SCRIPTCMD;
+
+/**
+ * @brief Parses one script line.
+ *
+ * @param line The line, with or without the trailing newline.
+ * @param cmd  Receives the command.
+ * @return The parsed operation (also stored in cmd->op).
+ */
+SCRIPTOP parseScriptLine(const char *line, SCRIPTCMD *cmd);
+
+/**
+ * @brief Carries out a 'mouse' command on 'pccore' (see mouse.h).
+ */
+void scriptMouse(PCCORE *pccore, const SCRIPTCMD *cmd);
+
+/**
+ * @brief Converts an ASCII character to a 16-bit IBM PC scan code (US layout).
+ *
+ * @return High byte = scan code, low byte = ASCII, or 0 if not mapped.
+ */
+int asciiToScancode(int c);
+
+/**
+ * @brief Writes an image as a binary PPM (P6) file.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int writePPM(const char *path, const IMAGE *image);
+
+/**
+ * @brief 64-bit FNV-1a hash of an image's size and pixels, for comparing
+ * frames between runs without keeping them.
+ */
+unsigned long long hashImage(const IMAGE *image);
+
+#endif // SCRIPT_H
@@ -0,0 +1,326 @@
+/**
+ * @file terminal.c
+ * @brief Terminal wrapper for running CGA text-mode programs over ssh
+ *
+ * Runs dos_main on its own thread like the other wrappers and shows the
+ * text modes (CGA80x25, CGA40x25) in the terminal with ANSI sequences
+ * (see ansi.h). Only the cells that changed since the last frame are
+ * written, so an idle screen costs nothing.
+ *
+ * Terminals only report key presses, so a key stays pressed until the
+ * program reads it or KEY_HOLD_MS passes. Ctrl+C stops the wrapper.
+ *
+ * Usage: pccore_term [-c 16|24] [-r fps] [-- dos arguments]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <termios.h>
+
+#include "../pccore/pccore.h"
+#include "../pccore/cga.h"
+#include "../pccore/memory.h"
+#include "../pccore/iobus.h"
+#include "../pccore/ansi.h"
+#include "../pccore/trace.h"
+#include "../dosapp.h"
+#include "script.h"
+
+// --- Constants ---
+#define DEFAULT_FRAME_RATE 30       // Terminal refreshes per second
+#define BLINK_HALF_CYCLE_MS 133     // ~3.75 Hz, same as the windowed wrappers
+#define KEY_HOLD_MS 100             // Release a key the program did not read
+
+// --- Global Variables ---
+PCCORE pccore;                      // The machine this wrapper runs
+ANSISCREEN g_screen;
+struct termios g_savedTermios;
+int g_termiosSaved = 0;
+
+volatile sig_atomic_t g_running = 1;
+long long g_startTime = 0;
+long long g_keyTime = 0;            // When pccore.key was set, 0 = no key
+
+// DOS Thread Data
+typedef struct {
+    int argc;
+    char **argv;
+    int result;
+    int finished;
+} DOSThreadData;
+
+pthread_t g_dosThread;
+DOSThreadData g_dosData;
+
+// --- Forward Declarations ---
+void InitializePCCore(void);
+void UpdateTime(void);
+void* DOSThreadFunction(void *arg);
+int SetupTerminal(void);
+void RestoreTerminal(void);
+void HandleSignal(int sig);
+void HandleInput(void);
+void PressKey(int key);
+
+/**
+ * @brief DOS Thread Function
+ */
+void* DOSThreadFunction(void *arg) {
+    DOSThreadData *data = (DOSThreadData *)arg;
+
+    // Call the DOS main function
+    bindPCCore(&pccore);
+    beginVideoUpdate(&pccore);
+    data->result = dos_main(data->argc, data->argv);
+    endVideoUpdate(&pccore);
+
+    // Mark as finished
+    __atomic_store_n(&data->finished, 1, __ATOMIC_SEQ_CST);
+
+    return NULL;
+}
+
+/**
+ * @brief Initialize PCCORE struct (same defaults as the windowed wrappers)
+ */
+void InitializePCCore(void) {
+    memset(&pccore, 0, sizeof(PCCORE));
+    int resumed = initMachineFromEnv(&pccore);
+    if (resumed < 0) {
+        fprintf(stderr, "Cannot set up guest memory\n");
+        exit(1);
+    }
+    attachCga(&pccore);
+    if (!resumed) {
+        writePort(&pccore, CGA_MODE_CONTROL_PORT, 0x0A); // 320x200x2
+        writePort(&pccore, CGA_COLOR_REGISTER_PORT, 0x20 | 0x10 | 0x01); // 0x31
+    }
+    pccore.key = 0;
+    startMachineClock(&pccore);
+    g_startTime = pccore.time;
+    UpdateTime();
+}
+
+/**
+ * @brief Update pccore.time and the blink phase from the machine clock
+ */
+void UpdateTime(void) {
+    long long now = updateMachineClock(&pccore);
+    pccore.blink = (int)(((now - g_startTime) / BLINK_HALF_CYCLE_MS) & 1);
+}
+
+/**
+ * @brief Signal handler: stop the main loop (the terminal is restored there)
+ */
+void HandleSignal(int sig) {
+    (void)sig;
+    g_running = 0;
+}
+
+/**
+ * @brief Switch the terminal to unbuffered input and the alternate screen
+ */
+int SetupTerminal(void) {
+    struct termios raw;
+
+    if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &g_savedTermios) != 0) {
+        fprintf(stderr, "stdin is not a terminal\n");
+        return -1;
+    }
+    g_termiosSaved = 1;
+
+    // Byte-at-a-time input without echo; keep ISIG so Ctrl+C still works
+    raw = g_savedTermios;
+    raw.c_lflag &= ~(ICANON | ECHO | IEXTEN);
+    raw.c_iflag &= ~(IXON | ICRNL);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+
+    // Alternate screen, hidden cursor, no line wrap
+    fputs("\x1b[?1049h\x1b[?25l\x1b[?7l", stdout);
+    fflush(stdout);
+    return 0;
+}
+
+/**
+ * @brief Put the terminal back the way it was
+ */
+void RestoreTerminal(void) {
+    if (!g_termiosSaved) {
+        return;
+    }
+    fputs("\x1b[0m\x1b[?7h\x1b[?25h\x1b[?1049l", stdout);
+    fflush(stdout);
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &g_savedTermios);
+    g_termiosSaved = 0;
+}
+
+/**
+ * @brief Press a key; it is released when read or after KEY_HOLD_MS
+ */
+void PressKey(int key) {
+    unsigned int traceId = traceKeyPress();
+    pccore.key = key;
+    traceKeyStore(traceId);
+    g_keyTime = updateMachineClock(&pccore);
+}
+
+/**
+ * @brief Read everything waiting on stdin and turn it into key presses
+ *
+ * Cursor keys arrive as ESC [ A..D; a lone ESC is the Escape key.
+ */
+void HandleInput(void) {
+    unsigned char input[64];
+    ssize_t count = read(STDIN_FILENO, input, sizeof(input));
+    ssize_t i;
+
+    for (i = 0; i < count; i++) {
+        int key;
+
+        if (input[i] == 0x1b && i + 2 < count && (input[i + 1] == '[' || input[i + 1] == 'O')) {
+            switch (input[i + 2]) {
+                case 'A': key = 0x4800; break; // Up
+                case 'B': key = 0x5000; break; // Down
+                case 'C': key = 0x4D00; break; // Right
+                case 'D': key = 0x4B00; break; // Left
+                case 'H': key = 0x4700; break; // Home
+                case 'F': key = 0x4F00; break; // End
+                default:  key = 0;      break;
+            }
+            i += 2;
+        } else if (input[i] == 0x7f) {
+            key = 0x0E08; // Backspace
+        } else {
+            key = asciiToScancode(input[i]);
+        }
+
+        if (key != 0) {
+            PressKey(key);
+        }
+    }
+}
+
+/**
+ * @brief Main application entry point
+ */
+int main(int argc, char **argv) {
+    const char *colorterm = getenv("COLORTERM");
+    ANSICOLORS colors = (colorterm != NULL &&
+                         (strcmp(colorterm, "truecolor") == 0 || strcmp(colorterm, "24bit") == 0))
+                        ? ANSI_TRUECOLOR : ANSI_16COLOR;
+    int frameRate = DEFAULT_FRAME_RATE;
+    int option;
+
+    while ((option = getopt(argc, argv, "c:r:")) != -1) {
+        switch (option) {
+            case 'c':
+                colors = atoi(optarg) == 16 ? ANSI_16COLOR : ANSI_TRUECOLOR;
+                break;
+            case 'r':
+                frameRate = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-c 16|24] [-r fps] [-- dos arguments]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (frameRate <= 0) {
+        frameRate = DEFAULT_FRAME_RATE;
+    }
+
+    if (SetupTerminal() != 0) {
+        return 2;
+    }
+    signal(SIGINT, HandleSignal);
+    signal(SIGTERM, HandleSignal);
+    signal(SIGHUP, HandleSignal);
+
+    // Initialize PCCORE
+    InitializePCCore();
+    initAnsiScreen(&g_screen, colors);
+    if (getenv("PCCORE_TRACE") != NULL) {
+        enableTrace(1);
+    }
+
+    // dos_main gets the program name and whatever follows the options
+    argv[optind - 1] = argv[0];
+    g_dosData.argc = argc - optind + 1;
+    g_dosData.argv = &argv[optind - 1];
+
+    if (pthread_create(&g_dosThread, NULL, DOSThreadFunction, &g_dosData) != 0) {
+        RestoreTerminal();
+        fprintf(stderr, "Failed to create DOS thread\n");
+        return 1;
+    }
+
+    // Main loop: poll() wakes up for input or at the next frame. Frames,
+    // key holds and delay() all run on the machine clock.
+    long long frameTime = 1000 / frameRate;
+    long long nextFrame = pccore.time;
+
+    while (g_running) {
+        struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+        long long now = updateMachineClock(&pccore);
+        int timeout = nextFrame > now ? (int)(nextFrame - now) : 0;
+
+        // Keep pccore.time fine-grained for delay() while waiting
+        if (timeout > 1) {
+            timeout = 1;
+        }
+
+        if (poll(&pfd, 1, timeout) > 0 && (pfd.revents & POLLIN)) {
+            HandleInput();
+        }
+
+        UpdateTime();
+        now = pccore.time;
+
+        if (g_keyTime != 0 && now - g_keyTime >= KEY_HOLD_MS) {
+            pccore.key = 0;
+            g_keyTime = 0;
+        }
+
+        if (now >= nextFrame) {
+            takeSnapshot(&pccore);
+            unsigned int traceId = traceSnapshot(&pccore.snapshot);
+            if (emitAnsiFrame(&g_screen, &pccore.snapshot, STDOUT_FILENO) < 0) {
+                break;
+            }
+            traceStage(traceId, TRACE_RENDER);
+            traceStage(traceId, TRACE_PRESENT);
+            nextFrame += frameTime;
+            if (nextFrame < now) {
+                nextFrame = now;
+            }
+        }
+
+        if (__atomic_load_n(&g_dosData.finished, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+    }
+
+    RestoreTerminal();
+
+    printf("Terminal: %lu frames, %lu cells, %lu bytes (%.1f bytes/frame)\n",
+           g_screen.frames, g_screen.changed, g_screen.bytes,
+           g_screen.frames ? (double)g_screen.bytes / g_screen.frames : 0.0);
+    printSnapshotStats(&pccore);
+    saveMachine(&pccore);
+    printTraceStats(stdout);
+
+    if (!__atomic_load_n(&g_dosData.finished, __ATOMIC_ACQUIRE)) {
+        // Interrupted while dos_main is still running: there is no way to
+        // stop it cleanly, so leave the process
+        return 1;
+    }
+
+    pthread_join(g_dosThread, NULL);
+    return g_dosData.result;
+}
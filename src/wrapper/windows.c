@@ -1,9 +1,12 @@
 #include <windows.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "../pccore/pccore.h"
 #include "../pccore/cga.h"
+#include "../pccore/memory.h"
+#include "../pccore/iobus.h"
 #include "windows_keyboard.h"
 #include "../dosapp.h"
 
@@ -14,6 +17,7 @@
 #define TIMER_INTERVAL 16  // ~60 FPS (16ms)
 
 // --- Global Variables ---
+PCCORE pccore; // The machine this wrapper runs
 HWND g_hWnd = NULL;
 IMAGE g_imageBuffer = {0};
 HBITMAP g_hBitmap = NULL;
@@ -47,7 +51,10 @@ DWORD WINAPI DOSThreadFunction(LPVOID lpParam) {
     printf("DOS thread started with %d arguments\n", data->argc);
     
     // Call the DOS main function
+    bindPCCore(&pccore);
+    beginVideoUpdate(&pccore);
     data->result = dos_main(data->argc, data->argv);
+    endVideoUpdate(&pccore);
     
     printf("DOS thread finished with result: %d\n", data->result);
     
@@ -123,17 +130,32 @@ void InitializePCCore(void) {
     // Zero out the entire pccore state
     memset(&pccore, 0, sizeof(PCCORE));
     
-    // Set the requested video mode
-    pccore.mode = CGA320x200x2;
+    // Map guest memory and ports (PCCORE_IMAGE / PCCORE_RESUME, see memory.h)
+    int resumed = initMachineFromEnv(&pccore);
+    if (resumed < 0) {
+        fprintf(stderr, "Cannot set up guest memory\n");
+        exit(1);
+    }
+    
+    // Decode the CGA registers on every write (and now, for a resumed image)
+    attachCga(&pccore);
+    
+    if (!resumed) {
+        // Set the requested video mode (Port 0x3D8)
+        writePort(&pccore, CGA_MODE_CONTROL_PORT, 0x0A); // 320x200x2
+        
+        // Set the CGA Color Register (Port 0x3D9)
+        writePort(&pccore, CGA_COLOR_REGISTER_PORT, 0x20 | 0x10 | 0x01); // 0x31
+    }
+
+    // Wall clock anchor for pccore.time
+    startMachineClock(&pccore);
     
     // Initialize key to 0 (meaning "no key pressed")
     pccore.key = 0;
     
-    // Set the CGA Color Register (Port 0x3D9)
-    pccore.port[CGA_COLOR_REGISTER_PORT] = 0x20 | 0x10 | 0x01; // 0x31
-    
     // Run one initial render to get image dimensions
-    render(&g_imageBuffer, pccore);
+    render(&g_imageBuffer, &pccore);
 }
 
 /**
@@ -201,8 +223,10 @@ void CreateAppWindow(HINSTANCE hInstance) {
  * @brief Render and update the display
  */
 void RenderAndUpdate(void) {
+    updateMachineClock(&pccore);
+
     // Call the C render function
-    render(&g_imageBuffer, pccore);
+    render(&g_imageBuffer, &pccore);
     
     if (g_imageBuffer.width == 0 || g_imageBuffer.height == 0) {
         return;
@@ -321,6 +345,8 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 g_pDOSData = NULL;
                 
                 printf("DOS execution completed with code: %d\n", finalResult);
+                printSnapshotStats(&pccore);
+                saveMachine(&pccore);
             }
             return 0;
             